@@ -29,9 +29,11 @@ extern "C"
 #include "include/VideoFilter.h"
 #include "include/AudioFilter.h"
 #include "include/VideoEncoder.h"
+#include "include/ParallelVideoEncoder.h"
 #include "include/AudioEncoder.h"
 #include "include/Muxer.h"
 #include "include/queue.h"
+#include "include/MediaPool.h"
 
 // 全局变量
 std::atomic<bool> g_running(true);
@@ -48,6 +50,74 @@ void signalHandler(int signum)
     g_running = false;
 }
 
+// 等待某个处理阶段的线程完成，收到中断信号时返回false
+template <typename Stage>
+bool waitForStage(Stage &stage, const char *name)
+{
+    while (!stage.waitForCompletion(std::chrono::milliseconds(100)))
+    {
+        if (!g_running)
+        {
+            std::cout << "等待" << name << "时收到中断信号，停止等待" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// 流复制方式：不复制、满足条件时自动复制、强制复制
+enum StreamCopyMode
+{
+    STREAM_COPY_OFF,
+    STREAM_COPY_AUTO,
+    STREAM_COPY_FORCE
+};
+
+/**
+ * 决定一路流是否直接复制（不解码不编码）
+ * blocker：要求了哪些必须解码才能做的处理（滤镜、倍速等），为空表示没有
+ * 自动模式只在没有这类处理、且输出容器明确支持源编码格式时复制；强制模式下条件不满足返回false（致命错误）
+ */
+bool decideStreamCopy(StreamCopyMode mode, const AVCodecParameters *par, const char *streamName,
+                      const std::string &outputFile, const std::string &blocker, bool &copy)
+{
+    copy = false;
+    if (mode == STREAM_COPY_OFF || !par)
+    {
+        return true;
+    }
+
+    bool forced = (mode == STREAM_COPY_FORCE);
+    if (outputFile.empty() || !blocker.empty())
+    {
+        if (forced)
+        {
+            std::cerr << "错误: " << streamName << "流不能直接复制: "
+                      << (outputFile.empty() ? "没有输出文件" : blocker + "需要重新编码") << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // 1表示容器支持该编码格式，0表示不支持，负数表示容器没有声明（强制复制时照常尝试）
+    const AVOutputFormat *outputFormat = av_guess_format(nullptr, outputFile.c_str(), nullptr);
+    int supported = outputFormat ? avformat_query_codec(outputFormat, par->codec_id, FF_COMPLIANCE_NORMAL) : -1;
+    if (supported == 0 || (!forced && supported < 0))
+    {
+        if (forced)
+        {
+            std::cerr << "错误: 输出容器不支持" << streamName << "编码格式 " << avcodec_get_name(par->codec_id)
+                      << "，不能直接复制" << std::endl;
+            return false;
+        }
+        std::cout << streamName << "流: 输出容器不支持 " << avcodec_get_name(par->codec_id) << "，重新编码" << std::endl;
+        return true;
+    }
+
+    copy = true;
+    return true;
+}
+
 // 视频帧回调函数
 void handleVideoFrame(AVFrame *frame)
 {
@@ -163,6 +233,29 @@ void printUsage(const char *programName)
     std::cout << "  -d, --debug         启用调试模式" << std::endl;
     std::cout << "  --direct-video      使用直接YUV输出模式" << std::endl;
     std::cout << "  --direct-audio      使用直接PCM输出模式" << std::endl;
+    std::cout << "  --queue-packets <N> 每路流解复用队列的高水位包数 (默认512，低水位为其一半)" << std::endl;
+    std::cout << "  --queue-bytes <MB>  每路流解复用队列的高水位字节数 (默认64MB，低水位为其一半)" << std::endl;
+    std::cout << "  --copy <none|auto|video|audio|all> 流直接复制不重新编码 (auto=无滤镜等处理且容器支持时复制，默认none)" << std::endl;
+    std::cout << "  --start <秒>        从输入的该时间点开始处理 (定位到之前最近的关键帧，之前的帧解码后丢弃)" << std::endl;
+    std::cout << "  --end <秒>          处理到输入的该时间点为止，之后的部分不再读取" << std::endl;
+    std::cout << "  --keyframe-index    建立视频关键帧索引并保存为旁路文件，输入未变化时直接复用" << std::endl;
+    std::cout << "  --index-file <path> 关键帧索引文件路径 (默认 输入文件名.kfindex，隐含--keyframe-index)" << std::endl;
+    std::cout << "  --input-read <default|auto|mmap|prefetch> 输入读取方式 (auto=普通文件mmap、管道用预读线程，默认default)" << std::endl;
+    std::cout << "  --read-ahead <MB>   输入预读窗口 (默认16MB，未指定读取方式时隐含auto)" << std::endl;
+    std::cout << "  --no-frame-pool     视频解码器不使用自有帧缓冲池，改用FFmpeg默认分配" << std::endl;
+    std::cout << "  --huge-pages        视频帧缓冲使用透明大页 (适合4K等大分辨率)" << std::endl;
+    std::cout << "  --dec-threads <N>   视频解码线程数 (auto=按CPU核数，默认auto)" << std::endl;
+    std::cout << "  --dec-thread-type <frame|slice|auto> 视频解码多线程方式 (默认auto)" << std::endl;
+    std::cout << "  --low-delay         低延迟解码 (只用片级多线程，适合直播)" << std::endl;
+    std::cout << "  --enc-opt <k=v>     视频编码器选项，可重复 (threads, slices, preset, tune, crf, gop, bframes, lookahead 及编码器私有选项)" << std::endl;
+    std::cout << "  --parallel-encode <N> 分段并行视频编码，同时编码N个分段 (N>1时启用)" << std::endl;
+    std::cout << "  --segment-frames <N>  并行编码时每个分段的最少帧数 (默认2秒的帧数，遇到源关键帧切分)" << std::endl;
+    std::cout << "  --frag-mp4          输出分片MP4 (边写边可播放，无需faststart重写，崩溃后已写分片仍可播放)" << std::endl;
+    std::cout << "  --frag-duration <ms> 分片最短时长，在其后第一个关键帧处切分 (默认2000，隐含--frag-mp4)" << std::endl;
+    std::cout << "  --write-behind      输出文件由后台线程合并成大块写入，复用不再同步等待磁盘" << std::endl;
+    std::cout << "  --write-buffer <MB> 后台写入的缓冲块大小 (默认4MB，共4块，隐含--write-behind)" << std::endl;
+    std::cout << "  --direct-io         后台写入对齐的整块数据时使用O_DIRECT (隐含--write-behind)" << std::endl;
+    std::cout << "  --fdatasync <close|MB> 关闭时或每写入MB兆字节执行fdatasync (隐含--write-behind)" << std::endl;
     std::cout << "  -h, --help          显示此帮助信息" << std::endl;
     std::cout << std::endl;
     std::cout << "示例:" << std::endl;
@@ -172,6 +265,11 @@ void printUsage(const char *programName)
     std::cout << "  " << programName << " input.mp4 -f \"eq=brightness=0.1:contrast=1.2\"" << std::endl;
     std::cout << "  " << programName << " input.mp4 -af \"volume=2.0\"" << std::endl;
     std::cout << "  " << programName << " input.mp4 -s 2.0" << std::endl;
+    std::cout << "  " << programName << " input.mp4 --enc-opt preset=fast --enc-opt crf=20 --enc-opt bframes=2" << std::endl;
+    std::cout << "  " << programName << " input.mp4 -o output.mp4 --parallel-encode 4" << std::endl;
+    std::cout << "  " << programName << " input.mp4 -o output.mp4 --frag-mp4 --frag-duration 1000" << std::endl;
+    std::cout << "  " << programName << " input.ts -o output.mp4 --copy auto" << std::endl;
+    std::cout << "  " << programName << " input.mp4 -o clip.mp4 --start 60 --end 90 --keyframe-index" << std::endl;
 }
 
 int main(int argc, char *argv[])
@@ -200,6 +298,21 @@ int main(int argc, char *argv[])
     double playbackSpeed = 1.0; // 默认播放速度为1.0（正常速度）
     bool useDirectVideo = false;
     bool useDirectAudio = false;
+    DemuxBufferLimits bufferLimits;
+    bool useFrameBufferPool = true;
+    bool useHugePages = false;
+    DecoderThreadOptions decoderThreads;
+    EncoderOptions encoderOptions;
+    ParallelEncodeOptions parallelEncode;
+    bool useParallelEncoder = false;
+    MuxerOptions muxerOptions;
+    InputReadOptions inputReadOptions;
+    StreamCopyMode videoCopyMode = STREAM_COPY_OFF;
+    StreamCopyMode audioCopyMode = STREAM_COPY_OFF;
+    bool useKeyframeIndex = false;
+    std::string keyframeIndexFile;
+    double rangeStart = 0.0;
+    double rangeEnd = 0.0;
 
     for (int i = 1; i < argc; i++)
     {
@@ -260,6 +373,252 @@ int main(int argc, char *argv[])
         {
             useDirectAudio = true;
         }
+        else if (strcmp(argv[i], "--queue-packets") == 0 && i + 1 < argc)
+        {
+            bufferLimits.highPackets = std::stoi(argv[++i]);
+            if (bufferLimits.highPackets <= 0)
+            {
+                std::cerr << "错误: 队列包数必须大于0" << std::endl;
+                return 1;
+            }
+            bufferLimits.lowPackets = bufferLimits.highPackets / 2;
+        }
+        else if (strcmp(argv[i], "--queue-bytes") == 0 && i + 1 < argc)
+        {
+            double megabytes = std::stod(argv[++i]);
+            if (megabytes <= 0)
+            {
+                std::cerr << "错误: 队列字节数必须大于0" << std::endl;
+                return 1;
+            }
+            bufferLimits.highBytes = static_cast<int64_t>(megabytes * 1024 * 1024);
+            bufferLimits.lowBytes = bufferLimits.highBytes / 2;
+        }
+        else if (strcmp(argv[i], "--no-frame-pool") == 0)
+        {
+            useFrameBufferPool = false;
+        }
+        else if (strcmp(argv[i], "--huge-pages") == 0)
+        {
+            useHugePages = true;
+        }
+        else if (strcmp(argv[i], "--dec-threads") == 0 && i + 1 < argc)
+        {
+            std::string value = argv[++i];
+            decoderThreads.threadCount = (value == "auto") ? 0 : std::stoi(value);
+            if (decoderThreads.threadCount < 0)
+            {
+                std::cerr << "错误: 解码线程数不能为负数" << std::endl;
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--dec-thread-type") == 0 && i + 1 < argc)
+        {
+            std::string value = argv[++i];
+            if (value == "frame")
+            {
+                decoderThreads.threadType = DECODER_THREAD_FRAME;
+            }
+            else if (value == "slice")
+            {
+                decoderThreads.threadType = DECODER_THREAD_SLICE;
+            }
+            else if (value == "auto")
+            {
+                decoderThreads.threadType = DECODER_THREAD_AUTO;
+            }
+            else
+            {
+                std::cerr << "错误: 解码线程类型必须是 frame, slice 或 auto" << std::endl;
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--enc-opt") == 0 && i + 1 < argc)
+        {
+            std::string option = argv[++i];
+            size_t pos = option.find('=');
+            if (pos == std::string::npos || pos == 0)
+            {
+                std::cerr << "错误: 编码器选项格式必须是 key=value: " << option << std::endl;
+                return 1;
+            }
+            encoderOptions[option.substr(0, pos)] = option.substr(pos + 1);
+        }
+        else if (strcmp(argv[i], "--low-delay") == 0)
+        {
+            decoderThreads.lowDelay = true;
+        }
+        else if (strcmp(argv[i], "--parallel-encode") == 0 && i + 1 < argc)
+        {
+            parallelEncode.workers = std::stoi(argv[++i]);
+            if (parallelEncode.workers <= 0)
+            {
+                std::cerr << "错误: 并行编码分段数必须大于0" << std::endl;
+                return 1;
+            }
+            useParallelEncoder = parallelEncode.workers > 1;
+        }
+        else if (strcmp(argv[i], "--segment-frames") == 0 && i + 1 < argc)
+        {
+            parallelEncode.segmentFrames = std::stoi(argv[++i]);
+            if (parallelEncode.segmentFrames <= 0)
+            {
+                std::cerr << "错误: 分段帧数必须大于0" << std::endl;
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--frag-mp4") == 0)
+        {
+            muxerOptions.fragmented = true;
+        }
+        else if (strcmp(argv[i], "--frag-duration") == 0 && i + 1 < argc)
+        {
+            muxerOptions.fragmentDurationMs = std::stoi(argv[++i]);
+            if (muxerOptions.fragmentDurationMs <= 0)
+            {
+                std::cerr << "错误: 分片时长必须大于0" << std::endl;
+                return 1;
+            }
+            muxerOptions.fragmented = true;
+        }
+        else if (strcmp(argv[i], "--copy") == 0 && i + 1 < argc)
+        {
+            std::string value = argv[++i];
+            if (value == "none")
+            {
+                videoCopyMode = STREAM_COPY_OFF;
+                audioCopyMode = STREAM_COPY_OFF;
+            }
+            else if (value == "auto")
+            {
+                videoCopyMode = STREAM_COPY_AUTO;
+                audioCopyMode = STREAM_COPY_AUTO;
+            }
+            else if (value == "video")
+            {
+                videoCopyMode = STREAM_COPY_FORCE;
+            }
+            else if (value == "audio")
+            {
+                audioCopyMode = STREAM_COPY_FORCE;
+            }
+            else if (value == "all")
+            {
+                videoCopyMode = STREAM_COPY_FORCE;
+                audioCopyMode = STREAM_COPY_FORCE;
+            }
+            else
+            {
+                std::cerr << "错误: 流复制方式必须是 none, auto, video, audio 或 all" << std::endl;
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--start") == 0 && i + 1 < argc)
+        {
+            rangeStart = std::stod(argv[++i]);
+            if (rangeStart < 0)
+            {
+                std::cerr << "错误: 起始时间不能为负数" << std::endl;
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--end") == 0 && i + 1 < argc)
+        {
+            rangeEnd = std::stod(argv[++i]);
+            if (rangeEnd <= 0)
+            {
+                std::cerr << "错误: 结束时间必须大于0" << std::endl;
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--keyframe-index") == 0)
+        {
+            useKeyframeIndex = true;
+        }
+        else if (strcmp(argv[i], "--index-file") == 0 && i + 1 < argc)
+        {
+            keyframeIndexFile = argv[++i];
+            useKeyframeIndex = true;
+        }
+        else if (strcmp(argv[i], "--input-read") == 0 && i + 1 < argc)
+        {
+            std::string value = argv[++i];
+            if (value == "default")
+            {
+                inputReadOptions.mode = INPUT_READ_DEFAULT;
+            }
+            else if (value == "auto")
+            {
+                inputReadOptions.mode = INPUT_READ_AUTO;
+            }
+            else if (value == "mmap")
+            {
+                inputReadOptions.mode = INPUT_READ_MMAP;
+            }
+            else if (value == "prefetch")
+            {
+                inputReadOptions.mode = INPUT_READ_PREFETCH;
+            }
+            else
+            {
+                std::cerr << "错误: 输入读取方式必须是 default, auto, mmap 或 prefetch" << std::endl;
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--read-ahead") == 0 && i + 1 < argc)
+        {
+            double megabytes = std::stod(argv[++i]);
+            if (megabytes <= 0)
+            {
+                std::cerr << "错误: 预读窗口必须大于0" << std::endl;
+                return 1;
+            }
+            inputReadOptions.readAheadBytes = static_cast<size_t>(megabytes * 1024 * 1024);
+            if (inputReadOptions.mode == INPUT_READ_DEFAULT)
+            {
+                inputReadOptions.mode = INPUT_READ_AUTO;
+            }
+        }
+        else if (strcmp(argv[i], "--write-behind") == 0)
+        {
+            muxerOptions.writeBehind = true;
+        }
+        else if (strcmp(argv[i], "--write-buffer") == 0 && i + 1 < argc)
+        {
+            double megabytes = std::stod(argv[++i]);
+            if (megabytes <= 0)
+            {
+                std::cerr << "错误: 写缓冲块大小必须大于0" << std::endl;
+                return 1;
+            }
+            muxerOptions.writeOptions.blockSize = static_cast<size_t>(megabytes * 1024 * 1024);
+            muxerOptions.writeBehind = true;
+        }
+        else if (strcmp(argv[i], "--direct-io") == 0)
+        {
+            muxerOptions.writeOptions.directIO = true;
+            muxerOptions.writeBehind = true;
+        }
+        else if (strcmp(argv[i], "--fdatasync") == 0 && i + 1 < argc)
+        {
+            std::string value = argv[++i];
+            if (value == "close")
+            {
+                muxerOptions.writeOptions.syncOnClose = true;
+            }
+            else
+            {
+                double megabytes = std::stod(value);
+                if (megabytes <= 0)
+                {
+                    std::cerr << "错误: fdatasync间隔必须是close或大于0的MB数" << std::endl;
+                    return 1;
+                }
+                muxerOptions.writeOptions.syncIntervalBytes = static_cast<int64_t>(megabytes * 1024 * 1024);
+                muxerOptions.writeOptions.syncOnClose = true;
+            }
+            muxerOptions.writeBehind = true;
+        }
         else if (inputFile.empty())
         {
             inputFile = argv[i];
@@ -293,9 +652,12 @@ int main(int argc, char *argv[])
         std::cout << "转码输出文件: " << outputFile << std::endl;
     }
 
-    // 创建队列
-    VideoPacketQueue videoQueue;
-    AudioPacketQueue audioQueue;
+    // 创建队列（解复用包队列的容量必须大于高水位，否则解复用线程会先被队列满阻塞，水位控制不起作用；
+    // 队列容量会向上取整为2的幂）
+    size_t packetQueueCapacity = std::max(static_cast<size_t>(DEFAULT_PACKET_QUEUE_CAPACITY),
+                                          static_cast<size_t>(bufferLimits.highPackets) + 1);
+    VideoPacketQueue videoQueue(packetQueueCapacity);
+    AudioPacketQueue audioQueue(packetQueueCapacity);
     VideoFrameQueue videoFrameQueue;
     AudioFrameQueue audioFrameQueue;
     VideoPacketQueue encodedVideoQueue;
@@ -303,6 +665,8 @@ int main(int argc, char *argv[])
 
     // 创建解复用器
     Demux demux(inputFile, videoQueue, audioQueue);
+    demux.setBufferLimits(bufferLimits, bufferLimits);
+    demux.setInputReadOptions(inputReadOptions);
 
     // 初始化解复用器
     if (!demux.init())
@@ -327,6 +691,92 @@ int main(int argc, char *argv[])
         std::cout << "音频流: " << mediaInfo.sampleRate << " Hz, " << mediaInfo.channels << " 通道" << std::endl;
     }
 
+    // 建立（或从缓存加载）关键帧索引
+    KeyframeIndex keyframeIndex;
+    bool hasKeyframeIndex = false;
+    if (useKeyframeIndex)
+    {
+        hasKeyframeIndex = demux.buildKeyframeIndex(keyframeIndex, keyframeIndexFile);
+        if (hasKeyframeIndex)
+        {
+            keyframeIndex.printSummary();
+        }
+        else
+        {
+            std::cerr << "建立关键帧索引失败，继续处理" << std::endl;
+        }
+    }
+
+    // 按时间段处理：定位到起点之前的关键帧（有索引时按索引定位），读到终点后停止
+    bool hasTimeRange = rangeStart > 0 || rangeEnd > 0;
+    if (hasTimeRange)
+    {
+        if (rangeEnd > 0 && rangeEnd <= rangeStart)
+        {
+            std::cerr << "错误: 结束时间必须大于起始时间" << std::endl;
+            return 1;
+        }
+        if (!demux.setTimeRange(rangeStart, rangeEnd, hasKeyframeIndex ? &keyframeIndex : nullptr))
+        {
+            std::cerr << "设置处理时间段失败" << std::endl;
+            return 1;
+        }
+
+        // 进度按时间段的长度计算
+        double rangeDuration = (rangeEnd > 0 ? std::min(rangeEnd, mediaInfo.duration) : mediaInfo.duration) - rangeStart;
+        g_totalFrames = rangeDuration > 0 ? static_cast<int>(mediaInfo.fps * rangeDuration) : 0;
+    }
+
+    // 决定各路流是直接复制还是重新编码（复制的流由解复用器的包队列直接送给复用器）
+    std::string videoCopyBlocker;
+    if (rotationAngle != 0)
+    {
+        videoCopyBlocker = "旋转";
+    }
+    else if (!customVideoFilter.empty())
+    {
+        videoCopyBlocker = "视频滤镜";
+    }
+    else if (playbackSpeed != 1.0)
+    {
+        videoCopyBlocker = "倍速";
+    }
+    else if (!videoOutputFile.empty())
+    {
+        videoCopyBlocker = "YUV输出";
+    }
+    else if (!encoderOptions.empty() || useParallelEncoder)
+    {
+        videoCopyBlocker = "编码器选项";
+    }
+
+    std::string audioCopyBlocker;
+    if (!customAudioFilter.empty())
+    {
+        audioCopyBlocker = "音频滤镜";
+    }
+    else if (playbackSpeed != 1.0)
+    {
+        audioCopyBlocker = "倍速";
+    }
+    else if (!audioOutputFile.empty())
+    {
+        audioCopyBlocker = "PCM输出";
+    }
+
+    bool copyVideo = false;
+    bool copyAudio = false;
+    if (!decideStreamCopy(videoCopyMode, mediaInfo.videoCodecPar, "视频", outputFile, videoCopyBlocker, copyVideo) ||
+        !decideStreamCopy(audioCopyMode, mediaInfo.audioCodecPar, "音频", outputFile, audioCopyBlocker, copyAudio))
+    {
+        return 1;
+    }
+    if (copyVideo || copyAudio)
+    {
+        std::cout << "流复制: 视频" << (copyVideo ? "直接复制" : "重新编码") << "，音频"
+                  << (copyAudio ? "直接复制" : "重新编码") << std::endl;
+    }
+
     // 记录开始时间
     g_startTime = std::chrono::steady_clock::now();
 
@@ -335,12 +785,17 @@ int main(int argc, char *argv[])
 
     // 如果有视频流，初始化视频解码器
     bool hasVideo = false;
-    if (mediaInfo.videoStreamIndex >= 0)
+    if (mediaInfo.videoStreamIndex >= 0 && !copyVideo)
     {
-        if (videoDecoder.init(mediaInfo.videoCodecPar))
+        videoDecoder.setFrameBufferPool(useFrameBufferPool, useHugePages);
+        if (videoDecoder.init(mediaInfo.videoCodecPar, decoderThreads))
         {
             hasVideo = true;
             videoDecoder.setFrameCallback(handleVideoFrame);
+            if (hasTimeRange)
+            {
+                videoDecoder.setTimeRange(demux.getRangeStartPts(true), demux.getRangeEndPts(true));
+            }
 
             // 设置YUV输出
             if (!videoOutputFile.empty())
@@ -361,7 +816,8 @@ int main(int argc, char *argv[])
                 }
             }
 
-            std::cout << "视频解码器: " << videoDecoder.getCodecName() << std::endl;
+            std::cout << "视频解码器: " << videoDecoder.getCodecName() << ", 解码线程: "
+                      << videoDecoder.getThreadCount() << " (" << videoDecoder.getThreadTypeName() << ")" << std::endl;
         }
         else
         {
@@ -428,8 +884,9 @@ int main(int argc, char *argv[])
         }
     }
 
-    // 创建视频编码器
+    // 创建视频编码器（--parallel-encode 时改用分段并行编码器，两者读写同样的队列）
     VideoEncoder videoEncoder(videoFrameQueue, encodedVideoQueue);
+    ParallelVideoEncoder parallelVideoEncoder(videoFrameQueue, encodedVideoQueue);
     bool hasEncoder = false;
 
     // 如果有视频滤镜，初始化视频编码器
@@ -441,7 +898,26 @@ int main(int argc, char *argv[])
 
         for (const auto &encoder : encoders)
         {
-            if (videoEncoder.init(mediaInfo.width, mediaInfo.height, mediaInfo.fps, 2000000, encoder))
+            if (useParallelEncoder)
+            {
+                if (parallelVideoEncoder.init(mediaInfo.width, mediaInfo.height, mediaInfo.fps, 2000000, encoder,
+                                              encoderOptions, parallelEncode))
+                {
+                    encoderInitialized = true;
+                    hasEncoder = true;
+
+                    // 滤镜在分发线程中按顺序应用
+                    parallelVideoEncoder.setVideoFilter(videoFilter);
+                    parallelVideoEncoder.setEncodeCallback(handleEncodedVideoPacket);
+                    std::cout << "并行视频编码器: 已初始化，编码器: " << parallelVideoEncoder.getCodecName()
+                              << ", 并行分段: " << parallelVideoEncoder.getWorkers()
+                              << ", 分段帧数: " << parallelVideoEncoder.getSegmentFrames()
+                              << ", 每段编码线程: " << parallelVideoEncoder.getThreadCount() << std::endl;
+                    break;
+                }
+                std::cerr << "使用 " << encoder << " 初始化并行视频编码器失败，尝试下一个编码器" << std::endl;
+            }
+            else if (videoEncoder.init(mediaInfo.width, mediaInfo.height, mediaInfo.fps, 2000000, encoder, encoderOptions))
             {
                 encoderInitialized = true;
                 hasEncoder = true;
@@ -460,7 +936,10 @@ int main(int argc, char *argv[])
                 }
 
                 videoEncoder.setEncodeCallback(handleEncodedVideoPacket);
-                std::cout << "视频编码器: 已初始化，编码器: " << videoEncoder.getCodecName() << std::endl;
+                std::cout << "视频编码器: 已初始化，编码器: " << videoEncoder.getCodecName()
+                          << ", 编码线程: " << videoEncoder.getThreadCount()
+                          << ", GOP: " << videoEncoder.getGopSize()
+                          << ", B帧: " << videoEncoder.getMaxBFrames() << std::endl;
                 break;
             }
             else
@@ -482,7 +961,7 @@ int main(int argc, char *argv[])
 
     // 如果有音频流，初始化音频解码器
     bool hasAudio = false;
-    if (mediaInfo.audioStreamIndex >= 0)
+    if (mediaInfo.audioStreamIndex >= 0 && !copyAudio)
     {
         if (audioDecoder.init(mediaInfo.audioCodecPar))
         {
@@ -490,6 +969,11 @@ int main(int argc, char *argv[])
 
             // 仍然保留回调函数用于显示进度，但主要数据流通过队列
             audioDecoder.setFrameCallback(handleAudioFrame);
+            if (hasTimeRange)
+            {
+                audioDecoder.setTimeRange(demux.getRangeStartPts(false), demux.getRangeEndPts(false),
+                                          mediaInfo.audioTimeBaseNum, mediaInfo.audioTimeBaseDen);
+            }
 
             // 设置PCM输出
             if (!audioOutputFile.empty())
@@ -518,14 +1002,50 @@ int main(int argc, char *argv[])
         }
     }
 
-    // 创建音频滤镜
-    AudioFilter *audioFilter = nullptr;
+    // 创建音频编码器
+    AudioEncoder audioEncoder(audioFrameQueue, encodedAudioQueue);
+    bool hasAudioEncoder = false;
+
+    // 如果有音频，初始化音频编码器
     if (hasAudio)
+    {
+        // 初始化音频编码器，使用AC3格式（采样率和采样格式由编码器按自身支持的范围协商）
+        if (audioEncoder.init(audioDecoder.getSampleRate(),
+                              audioDecoder.getChannels(),
+                              av_get_default_channel_layout(audioDecoder.getChannels()),
+                              192000, // 比特率
+                              "ac3")) // 编码器名称
+        {
+            hasAudioEncoder = true;
+
+            // 解码器直接输出编码器需要的采样格式、采样率和通道布局，整条音频链路最多转换一次
+            audioDecoder.setOutputFormat(audioEncoder.getSampleRate(),
+                                         audioEncoder.getChannelLayout(),
+                                         audioEncoder.getSampleFormat());
+
+            // 解码器按编码器实际的帧大小输出帧（可变帧大小的编码器frame_size为0，保持默认值）
+            if (audioEncoder.getFrameSize() > 0)
+            {
+                audioDecoder.setOutputFrameSize(audioEncoder.getFrameSize());
+            }
+
+            audioEncoder.setEncodeCallback(handleEncodedAudioPacket);
+            std::cout << "音频编码器: 已初始化，编码器: " << audioEncoder.getCodecName() << std::endl;
+        }
+        else
+        {
+            std::cerr << "初始化音频编码器失败，无法进行音频转码" << std::endl;
+        }
+    }
+
+    // 创建音频滤镜（输入输出都是编码器的格式，滤镜本身不做格式转换）
+    AudioFilter *audioFilter = nullptr;
+    if (hasAudioEncoder)
     {
         audioFilter = new AudioFilter();
-        if (!audioFilter->init(mediaInfo.sampleRate, mediaInfo.channels,
-                               av_get_default_channel_layout(mediaInfo.channels),
-                               AV_SAMPLE_FMT_FLTP,
+        if (!audioFilter->init(audioEncoder.getSampleRate(), audioEncoder.getChannels(),
+                               audioEncoder.getChannelLayout(),
+                               audioEncoder.getSampleFormat(),
                                customAudioFilter.empty() ? "anull" : customAudioFilter))
         {
             std::cerr << "初始化音频滤镜失败" << std::endl;
@@ -550,65 +1070,46 @@ int main(int argc, char *argv[])
             // 设置滤镜回调
             audioFilter->setFrameCallback(handleFilteredAudioFrame);
             std::cout << "音频滤镜: 已初始化，滤镜: " << audioFilter->getFilterDescription() << std::endl;
-        }
-    }
-
-    // 创建音频编码器
-    AudioEncoder audioEncoder(audioFrameQueue, encodedAudioQueue);
-    bool hasAudioEncoder = false;
-
-    // 如果有音频，初始化音频编码器
-    if (hasAudio)
-    {
-        // 初始化音频编码器，使用AC3格式
-        if (audioEncoder.init(audioDecoder.getSampleRate(),
-                              audioDecoder.getChannels(),
-                              av_get_default_channel_layout(audioDecoder.getChannels()),
-                              192000, // 比特率
-                              "ac3")) // 编码器名称
-        {
-            hasAudioEncoder = true;
 
             // 设置音频滤镜
-            if (audioFilter)
+            if (audioEncoder.setAudioFilter(audioFilter))
             {
-                if (audioEncoder.setAudioFilter(audioFilter))
-                {
-                    std::cout << "音频编码器: 已设置音频滤镜" << std::endl;
-                }
-                else
-                {
-                    std::cerr << "音频编码器: 设置音频滤镜失败" << std::endl;
-                }
+                std::cout << "音频编码器: 已设置音频滤镜" << std::endl;
             }
-
-            audioEncoder.setEncodeCallback(handleEncodedAudioPacket);
-            std::cout << "音频编码器: 已初始化，编码器: " << audioEncoder.getCodecName() << std::endl;
-        }
-        else
-        {
-            std::cerr << "初始化音频编码器失败，无法进行音频转码" << std::endl;
-            if (audioFilter)
+            else
             {
-                delete audioFilter;
-                audioFilter = nullptr;
+                std::cerr << "音频编码器: 设置音频滤镜失败" << std::endl;
             }
         }
     }
 
     // 如果没有视频也没有音频，退出
-    if (!hasVideo && !hasAudio)
+    if (!hasVideo && !hasAudio && !copyVideo && !copyAudio)
     {
         std::cerr << "没有可解码的媒体流" << std::endl;
         return 1;
     }
 
-    // 创建复用器
-    Muxer muxer(encodedVideoQueue, encodedAudioQueue);
+    // 创建复用器（直接复制的流读取解复用器的包队列；按时间段处理时以起点为零点，复制的视频从起点之前的关键帧开始）
+    Muxer muxer(copyVideo ? videoQueue : encodedVideoQueue, copyAudio ? audioQueue : encodedAudioQueue);
     bool hasMuxer = false;
-    if ((hasEncoder || hasAudioEncoder) && !outputFile.empty())
+    if (copyVideo)
+    {
+        copyVideo = muxer.setStreamCopy(true, mediaInfo.videoCodecPar, mediaInfo.videoTimeBaseNum,
+                                        mediaInfo.videoTimeBaseDen, demux.getOutputStartTime());
+    }
+    if (copyAudio)
     {
-        AVCodecContext *videoCodecCtx = hasEncoder ? videoEncoder.getCodecContext() : nullptr;
+        copyAudio = muxer.setStreamCopy(false, mediaInfo.audioCodecPar, mediaInfo.audioTimeBaseNum,
+                                        mediaInfo.audioTimeBaseDen, demux.getOutputStartTime());
+    }
+    if ((hasEncoder || hasAudioEncoder || copyVideo || copyAudio) && !outputFile.empty())
+    {
+        AVCodecContext *videoCodecCtx = nullptr;
+        if (hasEncoder)
+        {
+            videoCodecCtx = useParallelEncoder ? parallelVideoEncoder.getCodecContext() : videoEncoder.getCodecContext();
+        }
         AVCodecContext *audioCodecCtx = hasAudioEncoder ? audioEncoder.getCodecContext() : nullptr;
 
         // 保持原始输出文件名
@@ -627,7 +1128,7 @@ int main(int argc, char *argv[])
         for (int attempt = 1; attempt <= 3 && !muxerInitialized; attempt++)
         {
             std::cout << "【调试】复用器: 尝试初始化 (第" << attempt << "次), 输出文件: " << outputFile << std::endl;
-            if (muxer.init(outputFile, videoCodecCtx, audioCodecCtx))
+            if (muxer.init(outputFile, videoCodecCtx, audioCodecCtx, muxerOptions))
             {
                 muxerInitialized = true;
                 hasMuxer = true;
@@ -659,6 +1160,29 @@ int main(int argc, char *argv[])
         }
     }
 
+    // 没有消费者的队列提前关闭，上游入队时直接丢弃而不会因队列写满阻塞
+    if (!hasVideo && !(copyVideo && hasMuxer))
+    {
+        videoQueue.close();
+    }
+    if (!hasAudio && !(copyAudio && hasMuxer))
+    {
+        audioQueue.close();
+    }
+    if (!hasEncoder)
+    {
+        videoFrameQueue.close();
+    }
+    if (!hasAudioEncoder)
+    {
+        audioFrameQueue.close();
+    }
+    if (!hasMuxer)
+    {
+        encodedVideoQueue.close();
+        encodedAudioQueue.close();
+    }
+
     // 开始解复用-解码模块
     // 启动解复用
     demux.start();
@@ -677,7 +1201,14 @@ int main(int argc, char *argv[])
     // 启动编码器
     if (hasEncoder)
     {
-        videoEncoder.start();
+        if (useParallelEncoder)
+        {
+            parallelVideoEncoder.start();
+        }
+        else
+        {
+            videoEncoder.start();
+        }
     }
 
     if (hasAudioEncoder)
@@ -692,7 +1223,6 @@ int main(int argc, char *argv[])
         muxer.start();
 
         // 验证复用器是否成功启动
-        std::this_thread::sleep_for(std::chrono::milliseconds(500));
         if (!muxer.isActive())
         {
             std::cerr << "【警告】复用器启动失败，可能无法正确写入输出文件" << std::endl;
@@ -704,27 +1234,58 @@ int main(int argc, char *argv[])
     }
 
     // 等待处理完成
+    // 各阶段处理完所有输入后关闭输出队列并发布完成信号，按流水线顺序依次等待，不再依赖固定时长的休眠
     std::cout << "开始处理媒体文件..." << std::endl;
 
-    // 等待解复用完成
-    while (g_running && !demux.isFinished())
+    bool completed = waitForStage(demux, "解复用");
+    if (completed)
     {
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        std::cout << "\n解复用完成" << std::endl;
     }
 
-    std::cout << "\n解复用完成" << std::endl;
+    if (completed && hasVideo)
+    {
+        completed = waitForStage(videoDecoder, "视频解码");
+    }
+    if (completed && hasAudio)
+    {
+        completed = waitForStage(audioDecoder, "音频解码");
+    }
+    if (completed)
+    {
+        std::cout << "解码完成" << std::endl;
+    }
+
+    // 编码线程在帧队列排空后自行刷新编码器并发送EOF标记
+    if (completed && (hasEncoder || hasAudioEncoder))
+    {
+        std::cout << "等待编码完成..." << std::endl;
+        if (hasEncoder)
+        {
+            completed = useParallelEncoder ? waitForStage(parallelVideoEncoder, "并行视频编码")
+                                           : waitForStage(videoEncoder, "视频编码");
+        }
+        if (completed && hasAudioEncoder)
+        {
+            completed = waitForStage(audioEncoder, "音频编码");
+        }
+    }
+
+    // 复用线程在两个包队列都结束后写入文件尾
+    if (completed && hasMuxer)
+    {
+        std::cout << "【调试】等待复用完成..." << std::endl;
+        completed = waitForStage(muxer, "复用");
+    }
 
-    // 等待解码器队列清空
-    while (g_running &&
-           ((hasVideo && (!videoDecoder.isQueueEmpty() || !videoFrameQueue.isEmpty())) ||
-            (hasAudio && (!audioDecoder.isQueueEmpty() || !audioFrameQueue.isEmpty()))))
+    if (!completed)
     {
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        std::cout << "处理被中断，正在停止所有模块..." << std::endl;
     }
 
-    std::cout << "解码完成" << std::endl;
+    // 按流水线顺序停止各模块并回收线程（正常完成时线程均已退出，这里只做join）
+    demux.stop();
 
-    // 停止解码器
     if (hasVideo)
     {
         videoDecoder.stop();
@@ -735,32 +1296,20 @@ int main(int argc, char *argv[])
         audioDecoder.stop();
     }
 
-    // 等待编码器队列清空
-    if (hasEncoder || hasAudioEncoder)
+    if (hasEncoder)
     {
-        std::cout << "等待编码完成..." << std::endl;
-
-        // 等待编码器队列清空
-        while (g_running &&
-               ((hasEncoder && !encodedVideoQueue.isEmpty()) ||
-                (hasAudioEncoder && !encodedAudioQueue.isEmpty())))
+        if (useParallelEncoder)
         {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            parallelVideoEncoder.stop();
+        }
+        else
+        {
+            videoEncoder.stop();
         }
-
-        std::this_thread::sleep_for(std::chrono::seconds(1)); // 给编码器一些额外时间处理剩余帧
-    }
-
-    // 停止编码器
-    if (hasEncoder)
-    {
-        videoEncoder.flush();
-        videoEncoder.stop();
     }
 
     if (hasAudioEncoder)
     {
-        audioEncoder.flush();
         audioEncoder.stop();
     }
 
@@ -795,32 +1344,13 @@ int main(int argc, char *argv[])
         std::cout << "处理音频帧: " << g_audioFrameCount << " 帧" << std::endl;
     }
 
-    // 等待复用器完成
+    // 打印AVPacket/AVFrame对象池命中情况
+    MediaPool::printStats();
+
+    // 停止复用器并验证输出文件
     if (hasMuxer)
     {
-        std::cout << "【调试】等待复用完成..." << std::endl;
-
-        // 等待一段时间，确保所有数据包都被处理
-        std::this_thread::sleep_for(std::chrono::seconds(2));
-
-        // 检查队列是否为空
-        int waitCount = 0;
-        while ((!encodedVideoQueue.isEmpty() || !encodedAudioQueue.isEmpty()) && waitCount < 10)
-        {
-            std::cout << "【调试】警告: 编码队列仍有数据包未处理，等待额外时间... ("
-                      << (waitCount + 1) << "/10)" << std::endl;
-            std::this_thread::sleep_for(std::chrono::seconds(1));
-            waitCount++;
-        }
-
-        // 检查复用器是否仍在运行
-        if (muxer.isActive())
-        {
-            std::cout << "【调试】复用器仍在运行，等待额外时间..." << std::endl;
-            std::this_thread::sleep_for(std::chrono::seconds(3));
-        }
-
-        // 停止复用器
+        // 停止复用器，中断时由这里补写文件尾
         std::cout << "【调试】正在停止复用器..." << std::endl;
         muxer.stop();
 
@@ -873,9 +1403,6 @@ int main(int argc, char *argv[])
     // 确保所有资源都被释放
     std::cout << "【调试】清理资源..." << std::endl;
 
-    // 等待所有线程结束
-    std::this_thread::sleep_for(std::chrono::seconds(1));
-
     std::cout << "【调试】程序正常退出" << std::endl;
     return 0;
 }
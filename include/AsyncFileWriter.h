@@ -0,0 +1,147 @@
+#ifndef ASYNC_FILE_WRITER_H
+#define ASYNC_FILE_WRITER_H
+
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// 前向声明
+struct AVIOContext;
+
+// 默认写缓冲块大小和块数
+#define ASYNC_WRITER_DEFAULT_BLOCK_SIZE (4 * 1024 * 1024)
+#define ASYNC_WRITER_DEFAULT_BLOCK_COUNT 4
+// 写缓冲块的对齐字节数（满足O_DIRECT对地址、偏移和长度的要求）
+#define ASYNC_WRITER_ALIGN 4096
+
+// 后台写文件参数
+struct AsyncWriteOptions
+{
+    // 每个写缓冲块的字节数（向上取整到ASYNC_WRITER_ALIGN）和块数，复用线程最多领先磁盘 blockSize*blockCount 字节
+    size_t blockSize;
+    int blockCount;
+    // 对齐的整块数据用O_DIRECT写入，绕过页缓存（文件系统不支持时自动回退为普通写入）
+    bool directIO;
+    // 每写入这么多字节执行一次fdatasync，0表示运行期间不同步
+    int64_t syncIntervalBytes;
+    // 关闭文件前执行一次fdatasync
+    bool syncOnClose;
+
+    AsyncWriteOptions()
+        : blockSize(ASYNC_WRITER_DEFAULT_BLOCK_SIZE), blockCount(ASYNC_WRITER_DEFAULT_BLOCK_COUNT),
+          directIO(false), syncIntervalBytes(0), syncOnClose(false) {}
+};
+
+/**
+ * 带后台写线程的输出文件（以自定义 AVIOContext 的形式交给复用器）
+ *
+ * avio_open 打开的文件每次刷新缓冲都在复用线程中同步 write，磁盘或网络存储一抖动整条流水线就停下来。
+ * 这里 AVIOContext 的写回调只把数据拷进大块的对齐缓冲，块写满后交给写线程：
+ *  写线程把文件偏移连续的多个块合并成一次 pwritev，复用线程只在所有块都在排队时才等待；
+ *  每个块记录自己的文件偏移，seek 只是提交当前块并改写位置，MP4 写文件尾时回填头部也能正确处理；
+ *  可选 O_DIRECT（只用于偏移和长度都对齐的块，其余走普通文件描述符）和按字节数/关闭时 fdatasync。
+ *
+ * 只支持普通文件（需要 pwrite），管道等输出应继续使用 avio_open。
+ */
+class AsyncFileWriter
+{
+private:
+    // 一个写缓冲块
+    struct WriteBlock
+    {
+        unsigned char *data;
+        size_t size;
+        int64_t offset;
+    };
+
+    AVIOContext *ioContext;
+    std::string path;
+    AsyncWriteOptions options;
+
+    // 普通文件描述符和O_DIRECT文件描述符（未启用或不支持时为-1）
+    int fd;
+    int directFd;
+
+    // 写缓冲块：空闲块、待写块（按提交顺序）和复用线程正在填充的块
+    std::vector<WriteBlock> blocks;
+    std::deque<int> freeBlocks;
+    std::deque<int> pendingBlocks;
+    int currentBlock;
+    int inflightBlocks;
+
+    // 写位置（包括尚未写入文件的数据）和逻辑文件大小，只在复用线程中访问
+    int64_t position;
+    int64_t logicalSize;
+
+    // 写线程
+    std::thread writerThread;
+    std::mutex mutex;
+    std::condition_variable pendingCond;
+    std::condition_variable freeCond;
+    bool stopping;
+
+    // 写线程遇到的第一个错误（AVERROR），之后的写入直接返回该错误
+    std::atomic<int> writeError;
+
+    // 统计
+    std::atomic<uint64_t> bytesWritten;
+    std::atomic<uint64_t> writeCalls;
+    std::atomic<uint64_t> directWrites;
+    std::atomic<uint64_t> syncCalls;
+    uint64_t stallCount;
+    int64_t stallMicros;
+    int64_t bytesSinceSync;
+
+    // AVIOContext回调
+    static int writePacket(void *opaque, uint8_t *buf, int bufSize);
+    static int64_t seekPacket(void *opaque, int64_t offset, int whence);
+    int write(const uint8_t *buf, int size);
+    int64_t seek(int64_t offset, int whence);
+
+    // 取一个空闲块作为当前块（没有时等待写线程归还），把当前块交给写线程
+    bool acquireBlock();
+    void submitCurrentBlock();
+
+    // 写线程：取出偏移连续的一组待写块，合并写入
+    void writerThreadFunc();
+    bool writeBlocks(const std::vector<int> &run);
+    bool writeFully(int targetFd, const std::vector<int> &run, size_t total);
+
+    void releaseResources();
+
+public:
+    AsyncFileWriter();
+    ~AsyncFileWriter();
+
+    // 禁止拷贝和赋值
+    AsyncFileWriter(const AsyncFileWriter &) = delete;
+    AsyncFileWriter &operator=(const AsyncFileWriter &) = delete;
+
+    // 创建（截断）输出文件并启动写线程，失败时不修改任何文件以外的状态
+    bool open(const std::string &path, const AsyncWriteOptions &options = AsyncWriteOptions());
+
+    // 交给复用器使用的AVIOContext（需要同时设置AVFMT_FLAG_CUSTOM_IO）
+    AVIOContext *getIOContext() const;
+
+    // 刷新AVIO缓冲并等待已提交的数据全部写入文件，之后从文件读取能看到完整内容
+    bool drain();
+
+    // 写完所有数据，按策略同步，关闭文件并释放AVIOContext
+    bool close();
+
+    bool isOpen() const;
+
+    // 获取统计信息
+    uint64_t getBytesWritten() const;
+    uint64_t getWriteCalls() const;
+    uint64_t getStallCount() const;
+    void printStats() const;
+};
+
+#endif // ASYNC_FILE_WRITER_H
@@ -4,6 +4,7 @@
 #include <string>
 #include <thread>
 #include <atomic>
+#include <chrono>
 #include <functional>
 #include <fstream>
 #include "queue.h"
@@ -16,7 +17,10 @@ struct AVCodec;
 struct SwrContext;
 struct AVAudioFifo;
 
-// 音频帧回调函数类型
+// 默认输出帧样本数（AC3编码器的帧大小），可通过 setOutputFrameSize 改为编码器实际的 frame_size
+#define AUDIO_DECODER_DEFAULT_FRAME_SIZE 1536
+
+// 音频帧回调函数类型（data为输出格式的第一个平面，size为所有平面的总字节数）
 typedef std::function<void(const uint8_t *data, int size, int sampleRate, int channels)> AudioFrameCallback;
 
 // 音频解码器类
@@ -29,12 +33,42 @@ private:
     // 解码器
     const AVCodec *codec;
 
-    // 重采样上下文
+    // 重采样上下文：解码输出与目标格式一致时为空（直接使用解码帧），否则按帧的实际格式惰性创建
     SwrContext *swrContext;
+    int resamplerInFormat;
+    int resamplerInRate;
+    uint64_t resamplerInLayout;
+
+    // 重采样输出缓冲区，只在样本数变大时重新分配
+    uint8_t **convertedData;
+    int convertedCapacity;
 
-    // 音频FIFO
+    // 输出帧累积器：转换后的样本按输出格式暂存，凑满outputFrameSize个样本输出一帧
     AVAudioFifo *audioFifo;
 
+    // 输出格式（通常由编码器协商得到）和每帧样本数
+    int outputSampleRate;
+    int outputChannels;
+    uint64_t outputChannelLayout;
+    int outputSampleFormat;
+    int outputFrameSize;
+
+    // 下一个输出帧的时间戳（以样本数计）
+    int64_t nextFramePts;
+
+    // 时间段（流时间基，AV_NOPTS_VALUE表示不限）：跨越起点/终点的帧按样本裁剪，范围外的样本直接丢弃
+    int64_t rangeStartPts;
+    int64_t rangeEndPts;
+    int rangeTimeBaseNum;
+    int rangeTimeBaseDen;
+    int64_t rangeDiscardedSamples;
+
+    // PCM文件输出固定为S16交错格式，输出格式不是S16时单独转换（不影响送往编码器的帧）；
+    // 缓冲区用av_malloc分配，保证swresample可以走SIMD转换路径
+    SwrContext *pcmSwrContext;
+    uint8_t *pcmBuffer;
+    int pcmBufferSize;
+
     // 输入队列引用
     AudioPacketQueue &packetQueue;
 
@@ -46,6 +80,9 @@ private:
     std::atomic<bool> isRunning;
     std::atomic<bool> isPaused;
 
+    // 完成信号：线程刷新完所有输出并关闭输出队列后发布
+    CompletionLatch completion;
+
     // 帧回调函数
     AudioFrameCallback frameCallback;
 
@@ -63,7 +100,16 @@ private:
     void decodeThreadFunc();
     void savePCMData(const uint8_t *data, int size);
     void writePCMToFile(const uint8_t *data, int size, FILE *file);
-    void processAudioSamples(const uint8_t *data, int samplesCount, int64_t pts);
+    bool allocateAccumulator();
+    bool configureResampler(int inFormat, int inRate, uint64_t inLayout);
+    bool ensureConvertedCapacity(int samplesCount);
+    bool clipFrameToRange(const AVFrame *frame, int &skipSamples, int &keepSamples);
+    bool processDecodedFrame(AVFrame *frame, FILE *directPcmFile);
+    void flushResampler(FILE *directPcmFile);
+    void writePCMOutputs(const uint8_t **samples, int samplesCount, FILE *directPcmFile);
+    void processAudioSamples(const uint8_t **samples, int samplesCount);
+    bool emitAudioFrame(int samplesCount);
+    void flushAudioSamples();
 
 public:
     // 构造函数和析构函数
@@ -80,6 +126,10 @@ public:
     void stop();
     void pause(bool pause);
 
+    // 等待音频解码线程完成，超时返回false
+    bool waitForCompletion(std::chrono::milliseconds timeout);
+    bool isCompleted() const;
+
     // 设置帧回调
     void setFrameCallback(AudioFrameCallback callback);
 
@@ -90,6 +140,23 @@ public:
     // 直接PCM输出方法
     bool setDirectPCMOutput(const std::string &filePath);
 
+    // 设置输出格式（通常为音频编码器的采样率、通道布局和采样格式），必须在解码线程启动前调用；
+    // 解码器输出已是该格式时不做任何转换，否则每帧只重采样一次
+    bool setOutputFormat(int sampleRate, uint64_t channelLayout, int sampleFormat);
+
+    // 设置输出帧的样本数（通常为音频编码器的 frame_size），必须在解码线程启动前调用
+    bool setOutputFrameSize(int frameSize);
+    int getOutputFrameSize() const;
+
+    // 设置时间段（流时间基），只输出[startPts, endPts)之内的样本，必须在解码线程启动前调用
+    bool setTimeRange(int64_t startPts, int64_t endPts, int timeBaseNum, int timeBaseDen);
+
+    // 获取输出格式
+    int getOutputSampleRate() const;
+    int getOutputChannels() const;
+    uint64_t getOutputChannelLayout() const;
+    int getOutputSampleFormat() const;
+
     // 获取解码器信息
     int getSampleRate() const;
     int getChannels() const;
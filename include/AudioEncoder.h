@@ -4,6 +4,7 @@
 #include <string>
 #include <thread>
 #include <atomic>
+#include <chrono>
 #include <functional>
 #include "queue.h"
 #include "../include/AudioFilter.h"
@@ -13,7 +14,7 @@ struct AVCodecContext;
 struct AVFrame;
 struct AVPacket;
 struct AVCodec;
-struct SwrContext;
+struct AVAudioFifo;
 
 // 音频编码回调函数类型
 typedef std::function<void(AVPacket *)> AudioEncodeCallback;
@@ -28,9 +29,6 @@ private:
     // 编码器
     const AVCodec *codec;
 
-    // 重采样上下文
-    SwrContext *swrContext;
-
     // 输入帧队列引用
     AudioFrameQueue &frameQueue;
 
@@ -42,6 +40,9 @@ private:
     std::atomic<bool> isRunning;
     std::atomic<bool> isPaused;
 
+    // 完成信号：线程刷新完所有输出并关闭输出队列后发布
+    CompletionLatch completion;
+
     // 帧计数
     int frameCount;
 
@@ -59,14 +60,26 @@ private:
     bool useFilter;
     AudioFilter *audioFilter;
 
-    // 时间戳跟踪
+    // 时间戳跟踪（以样本数计，第一帧确定起点后按编码的样本数连续递增）
     int64_t nextPts;
+    bool ptsInitialized;
+
+    // 样本FIFO：固定帧大小的编码器（AC3、AAC、MP3等）接受任意长度的输入帧，
+    // 每凑满frame_size个样本用复用的fifoFrame编码一帧；可变帧大小的编码器为空
+    AVAudioFifo *sampleFifo;
+    AVFrame *fifoFrame;
+
+    // 滤镜输出帧（复用）
+    AVFrame *filteredFrame;
 
     // 私有方法
     bool initEncoder();
     void closeEncoder();
     void encodeThreadFunc();
     bool encodeFrame(AVFrame *frame);
+    bool drainSampleFifo(bool final);
+    bool sendFrame(AVFrame *frame);
+    bool receivePackets();
     void sendEOF();
 
 public:
@@ -92,6 +105,10 @@ public:
     void stop();
     void pause(bool pause);
 
+    // 等待音频编码线程完成，超时返回false
+    bool waitForCompletion(std::chrono::milliseconds timeout);
+    bool isCompleted() const;
+
     // 设置编码回调
     void setEncodeCallback(AudioEncodeCallback callback);
 
@@ -99,6 +116,8 @@ public:
     int getSampleRate() const;
     int getChannels() const;
     uint64_t getChannelLayout() const;
+    int getSampleFormat() const;
+    int getFrameSize() const;
     int getBitRate() const;
     const char *getCodecName() const;
 
@@ -4,7 +4,11 @@
 #include <string>
 #include <thread>
 #include <atomic>
+#include <chrono>
+#include <cstdint>
 #include "queue.h"
+#include "ReadAheadInput.h"
+#include "KeyframeIndex.h"
 
 // 前向声明
 struct AVFormatContext;
@@ -26,6 +30,7 @@ struct AVCodecParameters;
  *     音频通道数
  *     音频编解码器参数
  *     总时长（秒）
+ *  流时间基（num/den）和输入起始时间（AV_TIME_BASE单位），流复制时用于时间戳换算
  */
 struct MediaInfo
 {
@@ -45,9 +50,37 @@ struct MediaInfo
     // 总时长（秒）
     double duration;
 
+    // 流时间基和输入起始时间
+    int videoTimeBaseNum;
+    int videoTimeBaseDen;
+    int audioTimeBaseNum;
+    int audioTimeBaseDen;
+    int64_t startTime;
+
     MediaInfo() : videoStreamIndex(-1), width(0), height(0), fps(0), videoCodecPar(nullptr),
                   audioStreamIndex(-1), sampleRate(0), channels(0), audioCodecPar(nullptr),
-                  duration(0.0) {}
+                  duration(0.0), videoTimeBaseNum(0), videoTimeBaseDen(1), audioTimeBaseNum(0),
+                  audioTimeBaseDen(1), startTime(INT64_MIN) {}
+};
+
+/**
+ * 解复用缓冲水位（每路流独立）：
+ *  highPackets / highBytes：队列包数或负载字节数任一达到高水位时，解复用线程阻塞
+ *  lowPackets / lowBytes：阻塞后需要包数和字节数都降到低水位以下才恢复读取
+ *  stallTimeoutMs：阻塞期间若另一路流的队列已经空了（饥饿），且本路在该时长内没有任何消耗，
+ *                  说明下游可能正在等待另一路的数据（例如复用器交织），此时放行继续读取，避免死锁
+ */
+struct DemuxBufferLimits
+{
+    int highPackets;
+    int lowPackets;
+    int64_t highBytes;
+    int64_t lowBytes;
+    int stallTimeoutMs;
+
+    DemuxBufferLimits() : highPackets(512), lowPackets(256),
+                          highBytes(64LL * 1024 * 1024), lowBytes(32LL * 1024 * 1024),
+                          stallTimeoutMs(200) {}
 };
 
 /**
@@ -64,6 +97,9 @@ struct MediaInfo
  *  isRunning：是否运行
  *  isPaused：是否暂停
  *  isEOF：是否到达文件末尾
+ *  videoLimits/audioLimits：视频/音频队列的缓冲水位
+ *  readOptions/inputReader：输入读取方式和带预读的输入
+ *  rangeStartTime/rangeEndTime：按时间段处理时的起点和终点（输入时间线，AV_TIME_BASE单位）
  */
 class Demux
 {
@@ -85,12 +121,43 @@ private:
     std::thread demuxThread;
     std::atomic<bool> isRunning;
     std::atomic<bool> isPaused;
+
+    // 完成信号：线程刷新完所有输出并关闭输出队列后发布
+    CompletionLatch completion;
     std::atomic<bool> isEOF;
 
+    // 反压控制
+    DemuxBufferLimits videoLimits;
+    DemuxBufferLimits audioLimits;
+    QueueNotifier bufferNotifier; // 下游取走数据时唤醒阻塞中的解复用线程
+    int backpressureWaits;        // 因超过高水位而阻塞的次数
+    int starvationOverrides;      // 因另一路饥饿而放行的次数
+    bool videoOverride;           // 视频路正处于饥饿放行状态（音频队列仍为空）
+    bool audioOverride;           // 音频路正处于饥饿放行状态（视频队列仍为空）
+
+    // 输入读取方式（非默认时用带预读的自定义AVIOContext代替file协议）
+    InputReadOptions readOptions;
+    ReadAheadInput inputReader;
+
+    // 时间段：起点和终点（AV_NOPTS_VALUE表示不限），以及换算到各路流时间基的值
+    int64_t rangeStartTime;
+    int64_t rangeEndTime;
+    int64_t videoRangeStart;
+    int64_t videoRangeEnd;
+    int64_t audioRangeStart;
+    int64_t audioRangeEnd;
+    // 各路流是否已经读到终点
+    bool videoRangeDone;
+    bool audioRangeDone;
+
     // 私有方法
     bool openInputFile();
     void closeInputFile();
     void demuxThreadFunc();
+    void waitForBufferSpace(bool isVideo);
+    bool pushPacket(PacketQueue &queue, AVPacketPtr &packet);
+    void sendEOFPackets();
+    bool isPastRangeEnd(const AVPacket *packet);
 
 public:
     // 构造函数和析构函数
@@ -107,6 +174,32 @@ public:
     void stop();
     void pause(bool pause);
 
+    // 等待解复用线程完成，超时返回false
+    bool waitForCompletion(std::chrono::milliseconds timeout);
+    bool isCompleted() const;
+
+    // 设置视频/音频队列的缓冲水位（需在start之前调用）
+    void setBufferLimits(const DemuxBufferLimits &videoLimits, const DemuxBufferLimits &audioLimits);
+
+    // 设置输入读取方式（mmap/预读线程，需在init之前调用）
+    void setInputReadOptions(const InputReadOptions &options);
+
+    // 为视频流建立关键帧索引（init之后调用）：输入未变化时复用旁路索引文件，否则扫描并保存；
+    // 扫描使用独立的格式上下文，不影响解复用读取位置。indexFile为空时使用默认路径
+    bool buildKeyframeIndex(KeyframeIndex &index, const std::string &indexFile = "") const;
+
+    // 只处理输入中[startSeconds, endSeconds)这一段（init之后、start之前调用，秒数相对于输入起始时间，
+    // endSeconds<=0表示直到文件结束）：定位到起点之前最近的关键帧（给出关键帧索引时直接按索引定位），
+    // 起点之前的帧由解码器解码后丢弃，所有流都读到终点后即发送EOF标记，不再读取文件剩余部分
+    bool setTimeRange(double startSeconds, double endSeconds, const KeyframeIndex *index = nullptr);
+
+    // 时间段的起点/终点（流时间基，供解码器丢弃范围外的帧），未设置时为AV_NOPTS_VALUE
+    int64_t getRangeStartPts(bool isVideo) const;
+    int64_t getRangeEndPts(bool isVideo) const;
+
+    // 输出的起始时间（AV_TIME_BASE单位）：设置了起点时为起点对应的输入时间，否则为输入起始时间
+    int64_t getOutputStartTime() const;
+
     // 获取媒体信息
     const MediaInfo &getMediaInfo() const;
 
@@ -0,0 +1,87 @@
+#ifndef FRAME_BUFFER_POOL_H
+#define FRAME_BUFFER_POOL_H
+
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+// 前向声明
+struct AVCodecContext;
+struct AVFrame;
+struct AVBufferPool;
+struct AVBufferRef;
+
+/**
+ * 视频解码器帧缓冲池（通过 get_buffer2 回调接管解码器的帧内存分配）
+ *
+ * 默认情况下解码出的帧引用 libavcodec 内部的缓冲池，该池按解码器自身需要的帧数设计，
+ * 帧在帧队列中排队时会不断触发新的 malloc。这里改为项目自己的 AVBufferPool：
+ *  每帧一整块内存，各平面起始地址和行宽都按64字节对齐；
+ *  创建时按队列深度预先分配并放回池中，稳态下不再 malloc；
+ *  可选用透明大页（madvise MADV_HUGEPAGE），降低4K帧的缺页开销。
+ *
+ * 分辨率或像素格式变化时重建缓冲池，旧池在其所有帧释放后自动销毁。
+ * 硬件帧、调色板格式以及不支持 AV_CODEC_CAP_DR1 的解码器回退到默认分配方式。
+ */
+class FrameBufferPool
+{
+private:
+    // 保护缓冲池重建（帧级多线程解码时回调可能来自不同线程）
+    std::mutex mutex;
+    AVBufferPool *pool;
+
+    // 当前缓冲池对应的帧格式
+    int poolWidth;
+    int poolHeight;
+    int poolFormat;
+
+    // 每个平面的行宽和在整块内存中的偏移
+    int linesizes[4];
+    size_t planeOffsets[4];
+    int planeCount;
+    size_t bufferSize;
+
+    // 预分配帧数和大页选项
+    int prefillFrames;
+    bool useHugePages;
+
+    // 统计
+    std::atomic<uint64_t> requests;
+    std::atomic<uint64_t> fallbacks;
+    std::atomic<int> allocatedBuffers;
+
+    // get_buffer2回调
+    static int getBuffer2(AVCodecContext *codecContext, AVFrame *frame, int flags);
+    int getBuffer(AVCodecContext *codecContext, AVFrame *frame, int flags);
+
+    // 按帧格式（重新）创建缓冲池，调用者需持有mutex
+    bool configure(AVCodecContext *codecContext, int width, int height, int format);
+    void releasePool();
+
+public:
+    FrameBufferPool();
+    ~FrameBufferPool();
+
+    // 禁止拷贝和赋值
+    FrameBufferPool(const FrameBufferPool &) = delete;
+    FrameBufferPool &operator=(const FrameBufferPool &) = delete;
+
+    // 挂接到解码器上下文，必须在avcodec_open2之前调用
+    // prefillFrames: 首次确定帧格式时预分配的帧数（通常为帧队列容量加上解码器参考帧余量）
+    bool attach(AVCodecContext *codecContext, int prefillFrames, bool useHugePages);
+
+    // 调整预分配帧数（例如解码器打开后得知帧线程数），在第一帧解码之前调用才有效
+    void setPrefillFrames(int prefillFrames);
+
+    // 获取统计信息
+    uint64_t getRequests() const;
+    uint64_t getFallbacks() const;
+    int getAllocatedBuffers() const;
+    void printStats() const;
+
+    // 缓冲池为空时分配一块新内存（64字节对齐，可选大页），由AVBufferPool的分配回调调用
+    AVBufferRef *allocBuffer(size_t size);
+};
+
+#endif // FRAME_BUFFER_POOL_H
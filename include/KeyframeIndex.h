@@ -0,0 +1,83 @@
+#ifndef KEYFRAME_INDEX_H
+#define KEYFRAME_INDEX_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// 旁路索引文件的默认后缀（输入文件路径 + 后缀）
+#define KEYFRAME_INDEX_SUFFIX ".kfindex"
+
+// 一个视频关键帧
+struct KeyframeEntry
+{
+    // 时间戳（流时间基，可能为AV_NOPTS_VALUE）
+    int64_t pts;
+    int64_t dts;
+    // 关键帧所在包在输入文件中的字节位置（未知时为-1）
+    int64_t pos;
+    // 从该关键帧到下一个关键帧之前的包数（GOP长度）
+    uint32_t gopLength;
+};
+
+/**
+ * 输入文件的视频关键帧索引
+ *
+ * 快速定位、按时间段处理和把输入切给多个并行任务都需要知道关键帧在哪里。
+ * 建立索引时单独打开一个格式上下文，只读取视频流（其他流设置 AVDISCARD_ALL），
+ * 记录每个关键帧的 pts/dts、字节位置和GOP长度，不影响解复用器自己的读取位置。
+ *
+ * 索引保存为输入文件旁边的紧凑二进制文件（默认 输入路径 + ".kfindex"），文件头记录
+ * 输入的大小和修改时间；同一个输入再次处理时，大小和修改时间都一致就直接加载，不再重新扫描。
+ * 数值按本机字节序存储，索引文件不跨平台共享。
+ */
+class KeyframeIndex
+{
+private:
+    std::vector<KeyframeEntry> entries;
+
+    // 被索引的视频流及其时间基
+    int streamIndex;
+    int timeBaseNum;
+    int timeBaseDen;
+
+    // 输入文件的大小和修改时间（纳秒），作为索引文件的键
+    int64_t inputSize;
+    int64_t inputMtime;
+
+    // 索引是否来自缓存
+    bool fromCache;
+
+    static bool statInput(const std::string &inputFile, int64_t &size, int64_t &mtime);
+
+public:
+    KeyframeIndex();
+
+    // 扫描输入文件建立索引，streamIndex<0时选择第一个视频流
+    bool build(const std::string &inputFile, int streamIndex = -1);
+
+    // 从索引文件加载，输入文件的大小、修改时间或流索引不一致时返回false
+    bool load(const std::string &inputFile, const std::string &indexFile, int streamIndex = -1);
+
+    // 保存到索引文件（先写临时文件再改名，写到一半中断不会留下损坏的索引）
+    bool save(const std::string &indexFile) const;
+
+    // 有可用的缓存就加载，否则扫描并保存；indexFile为空时使用默认路径
+    bool loadOrBuild(const std::string &inputFile, const std::string &indexFile = "", int streamIndex = -1);
+
+    // 查找pts不大于给定时间戳（流时间基）的最后一个关键帧，没有时返回-1
+    int findKeyframeBefore(int64_t pts) const;
+
+    const std::vector<KeyframeEntry> &getEntries() const;
+    int getStreamIndex() const;
+    int getTimeBaseNum() const;
+    int getTimeBaseDen() const;
+    bool isFromCache() const;
+
+    // 打印索引摘要（关键帧数、平均/最大GOP长度）
+    void printSummary() const;
+
+    static std::string defaultIndexPath(const std::string &inputFile);
+};
+
+#endif // KEYFRAME_INDEX_H
@@ -0,0 +1,66 @@
+#ifndef MEDIA_POOL_H
+#define MEDIA_POOL_H
+
+#include <cstdint>
+#include <cstddef>
+
+// 前向声明
+struct AVPacket;
+struct AVFrame;
+
+/**
+ * 对象池统计信息：
+ *  hits：从池中复用到的外壳数
+ *  misses：池为空、只能新分配的外壳数
+ *  pooled：当前全局池中空闲的外壳数（不含各线程本地缓存）
+ */
+struct MediaPoolStats
+{
+    uint64_t packetHits;
+    uint64_t packetMisses;
+    uint64_t frameHits;
+    uint64_t frameMisses;
+    size_t pooledPackets;
+    size_t pooledFrames;
+
+    MediaPoolStats() : packetHits(0), packetMisses(0), frameHits(0), frameMisses(0),
+                       pooledPackets(0), pooledFrames(0) {}
+};
+
+/**
+ * AVPacket / AVFrame 外壳对象池（全局，线程安全）
+ *
+ * 各阶段每处理一个单元都要 av_packet_alloc / av_frame_alloc 一个新外壳，
+ * 小音频包每秒上千个时分配器成为热点。对象池只缓存外壳本身：
+ *  release 时先 unref 掉引用的数据，再放回池中；acquire 得到的是干净的空外壳。
+ *
+ * 每个线程有一个本地缓存，acquire/release 通常不加锁；
+ * 本地缓存空了从全局池批量取，满了批量归还，线程退出时全部归还。
+ * 流水线中外壳总是由上游线程取出、下游线程归还，批量搬运摊薄了加锁开销。
+ */
+class MediaPool
+{
+public:
+    // 获取一个空的AVPacket，池为空时新分配
+    static AVPacket *acquirePacket();
+
+    // 归还AVPacket（会先unref），传入nullptr时忽略
+    static void releasePacket(AVPacket *packet);
+
+    // 获取一个空的AVFrame，池为空时新分配
+    static AVFrame *acquireFrame();
+
+    // 归还AVFrame（会先unref），传入nullptr时忽略
+    static void releaseFrame(AVFrame *frame);
+
+    // 获取命中/未命中统计
+    static MediaPoolStats getStats();
+
+    // 打印统计信息
+    static void printStats();
+
+private:
+    MediaPool() = delete;
+};
+
+#endif // MEDIA_POOL_H
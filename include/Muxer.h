@@ -4,8 +4,12 @@
 #include <string>
 #include <thread>
 #include <atomic>
+#include <chrono>
 #include <functional>
+#include <vector>
+#include <queue>
 #include "queue.h"
+#include "AsyncFileWriter.h"
 
 // 前向声明
 struct AVFormatContext;
@@ -13,11 +17,67 @@ struct AVCodecContext;
 struct AVStream;
 struct AVPacket;
 struct AVRational;
+struct AVIOContext;
+struct AVDictionary;
+struct AVCodecParameters;
+struct AVBSFContext;
+
+// 交织器每条输入流最多预读的包数，超过后不再等待最慢的流
+#define MUXER_MAX_LOOKAHEAD 64
+
+// 复用器参数
+struct MuxerOptions
+{
+    // MP4/MOV输出使用分片模式（fragmented MP4）：文件头只写空的moov，之后按分片写moof+mdat，
+    // 边写边可播放，结束时不需要faststart那样整体重写文件，进程中途崩溃也能留下可播放的部分
+    bool fragmented;
+    // 分片的最短时长（毫秒），分片在达到该时长后的第一个视频关键帧处切开
+    int fragmentDurationMs;
+    // 输出文件交给后台写线程（AsyncFileWriter），复用线程不再同步等待磁盘
+    bool writeBehind;
+    AsyncWriteOptions writeOptions;
+
+    MuxerOptions() : fragmented(false), fragmentDurationMs(2000), writeBehind(false) {}
+};
 
 // 复用器类
 class Muxer
 {
 private:
+    // 一路输入流：编码包队列、对应的输出流和编码器上下文，以及交织器中缓存的包数
+    struct MuxInput
+    {
+        PacketQueue *queue;
+        AVStream *stream;
+        AVCodecContext *codecContext;
+        bool isVideo;
+        const char *name;
+        int buffered;
+        // 该流上一个包的排序键（包没有时间戳时沿用）
+        int64_t lastKey;
+        bool finished;
+        // 流复制时容器需要的比特流滤镜（可为空），以及从包时间戳中减去的起始偏移（源时间基）
+        AVBSFContext *bsf;
+        int64_t timestampOffset;
+    };
+
+    // 交织器中缓存的一个包，按换算到微秒的DTS排序，DTS相同时按到达顺序
+    struct InterleaveEntry
+    {
+        int64_t key;
+        uint64_t sequence;
+        int input;
+        AVPacket *packet;
+    };
+
+    struct InterleaveOrder
+    {
+        bool operator()(const InterleaveEntry &a, const InterleaveEntry &b) const
+        {
+            return a.key > b.key || (a.key == b.key && a.sequence > b.sequence);
+        }
+    };
+
     // 输出格式上下文
     AVFormatContext *formatContext;
 
@@ -29,18 +89,45 @@ private:
     AVStream *audioStream;
     AVCodecContext *audioCodecContext;
 
+    // 流复制：由源流参数构造的编解码器上下文（代替编码器上下文描述输出流）、比特流滤镜和起始偏移
+    AVCodecContext *videoCopyContext;
+    AVCodecContext *audioCopyContext;
+    AVBSFContext *videoBsf;
+    AVBSFContext *audioBsf;
+    int64_t videoCopyStartTime;
+    int64_t audioCopyStartTime;
+
     // 输入队列引用
     VideoPacketQueue &videoPacketQueue;
     AudioPacketQueue &audioPacketQueue;
 
+    // 输入队列通知器，任一队列有新数据或被关闭时唤醒复用线程
+    QueueNotifier queueNotifier;
+
     // 线程控制
     std::thread muxThread;
     std::atomic<bool> isRunning;
     std::atomic<bool> isPaused;
 
+    // 完成信号：复用线程写完文件尾后发布
+    CompletionLatch completion;
+
     // 输出文件路径
     std::string outputFile;
 
+    // 复用器参数
+    MuxerOptions options;
+
+    // 后台写文件（writeBehind时代替avio_open），以及被替换的默认io_open回调
+    AsyncFileWriter asyncWriter;
+    int (*defaultIoOpen)(AVFormatContext *s, AVIOContext **pb, const char *url, int flags, AVDictionary **options);
+
+    // 容器打开附加IO（例如faststart回读输出文件）前，先等后台写线程把已提交的数据写完
+    static int openNestedIO(AVFormatContext *s, AVIOContext **pb, const char *url, int flags, AVDictionary **options);
+
+    // 文件头已写入而文件尾尚未写入，保证文件尾只写一次
+    bool trailerPending;
+
     // 包计数
     int videoPacketCount;
     int audioPacketCount;
@@ -48,19 +135,34 @@ private:
     // 播放速度
     double playbackSpeed;
 
-    // 上一个时间戳，用于确保时间戳单调递增
-    int64_t lastVideoPts;
+    // 播放速度的有理数表示（speedNum/speedDen），只作用于视频流的时间基
+    int speedNum;
+    int speedDen;
+
+    // 上一个DTS，用于统计不单调递增的包
     int64_t lastVideoDts;
-    int64_t lastAudioPts;
     int64_t lastAudioDts;
+    int timestampViolations;
 
-    // 时间基转换
-    int64_t rescaleTimestamp(int64_t timestamp, const AVRational &srcTimeBase, const AVRational &dstTimeBase, bool isVideo = true);
+    // DTS交织器：输入流列表和按DTS排序的最小堆（堆中的包由交织器持有）
+    std::vector<MuxInput> inputs;
+    std::priority_queue<InterleaveEntry, std::vector<InterleaveEntry>, InterleaveOrder> interleaveHeap;
+    uint64_t interleaveSequence;
+
+    // 包时间戳所在的时间基（视频已含倍速变换）
+    AVRational sourceTimeBase(bool isVideo) const;
 
     // 私有方法
     bool initMuxer();
     void closeMuxer();
     void muxThreadFunc();
+    int64_t interleaveKey(const AVPacket *packet, MuxInput &input);
+    void pullPackets();
+    void queuePacket(AVPacketPtr &packet, int index);
+    void drainBitstreamFilter(int index, bool flush);
+    bool initCopyBitstreamFilter(bool isVideo);
+    bool canWriteHead(bool &forced) const;
+    void clearInterleaver();
     bool writePacket(AVPacket *packet, bool isVideo);
     bool finalizeFile();
 
@@ -73,19 +175,36 @@ public:
     Muxer(const Muxer &) = delete;
     Muxer &operator=(const Muxer &) = delete;
 
+    /**
+     * 流复制：该流不经过编解码，解复用得到的包直接写入输出（需在init之前调用，init时对应的编码器上下文传nullptr）
+     * parameters/timeBaseNum/timeBaseDen：源流的编解码器参数和时间基
+     * startTime：输入文件的起始时间（AV_TIME_BASE单位），写出时减去，与从0开始的转码流对齐
+     * 容器需要时自动插入比特流滤镜（例如 h264_mp4toannexb、aac_adtstoasc）
+     */
+    bool setStreamCopy(bool isVideo, const AVCodecParameters *parameters, int timeBaseNum, int timeBaseDen,
+                       int64_t startTime);
+
     // 初始化方法
-    bool init(const std::string &outputFile, AVCodecContext *videoCodecCtx, AVCodecContext *audioCodecCtx = nullptr);
+    bool init(const std::string &outputFile, AVCodecContext *videoCodecCtx, AVCodecContext *audioCodecCtx = nullptr,
+              const MuxerOptions &options = MuxerOptions());
 
     // 线程控制
     void start();
     void stop();
     void pause(bool pause);
 
+    // 等待复用线程完成，超时返回false
+    bool waitForCompletion(std::chrono::milliseconds timeout);
+    bool isCompleted() const;
+
     // 获取统计信息
     int getVideoPacketCount() const;
     int getAudioPacketCount() const;
     std::string getOutputFile() const;
 
+    // 是否以分片MP4模式输出（只有MP4/MOV容器会启用）
+    bool isFragmented() const;
+
     // 检查复用器是否正在运行
     bool isActive() const;
 
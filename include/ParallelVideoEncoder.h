@@ -0,0 +1,169 @@
+#ifndef PARALLEL_VIDEO_ENCODER_H
+#define PARALLEL_VIDEO_ENCODER_H
+
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include "queue.h"
+#include "VideoEncoder.h"
+
+// 前向声明
+struct AVCodecContext;
+struct AVFrame;
+
+// 分段并行编码参数
+struct ParallelEncodeOptions
+{
+    // 同时编码的分段数（即并行的编码器实例数）
+    int workers;
+    // 每个分段的最少帧数，<=0表示按帧率取默认值；分段在达到该帧数后的第一个源关键帧处切开，
+    // 超过两倍仍未遇到关键帧时强制切开
+    int segmentFrames;
+
+    ParallelEncodeOptions() : workers(2), segmentFrames(0) {}
+};
+
+/**
+ * 分段并行视频编码器
+ *
+ * 单个编码器实例受限于自身的线程扩展性，在多核机器上无法跑满CPU。这里把解码后的帧流
+ * 按源关键帧（通常也是场景切换点）切成若干分段，每个分段交给一个新建的 VideoEncoder
+ * 独立编码（分段首帧必然是IDR，GOP天然闭合），最多 workers 个分段同时编码：
+ *  分发线程：从帧队列取帧，应用滤镜后放入当前分段的帧队列，到切分点时关闭该分段的帧队列；
+ *  收集线程：按分段顺序取出编码包，pts/dts 加上此前所有分段的帧数，依次放入输出包队列。
+ *
+ * 所有分段使用同样的编码参数，另有一个只打开不编码的参考编码器，为复用器提供时基和全局头。
+ * 接口与 VideoEncoder 保持一致，可以直接替换。
+ */
+class ParallelVideoEncoder
+{
+private:
+    // 一个分段：独立的帧队列、包队列和编码器（编码器引用两个队列，必须最后构造）
+    struct EncodeSegment
+    {
+        int index;
+        // 此前所有分段的帧数，即本分段时间戳的偏移量
+        int64_t frameOffset;
+        int frameCount;
+        // 分发线程已关闭帧队列且不再访问该分段（受segmentMutex保护）
+        bool sealed;
+        VideoFrameQueue frames;
+        VideoPacketQueue packets;
+        VideoEncoder encoder;
+
+        EncodeSegment(int index, int64_t frameOffset, size_t capacity)
+            : index(index), frameOffset(frameOffset), frameCount(0), sealed(false),
+              frames(capacity), packets(capacity), encoder(frames, packets)
+        {
+        }
+    };
+
+    // 输入帧队列和输出包队列引用
+    VideoFrameQueue &frameQueue;
+    VideoPacketQueue &packetQueue;
+
+    // 参考编码器（只打开不编码）及其占位队列
+    VideoFrameQueue referenceFrames;
+    VideoPacketQueue referencePackets;
+    VideoEncoder referenceEncoder;
+
+    // 编码参数，每个分段按同样的参数初始化
+    int width;
+    int height;
+    int frameRate;
+    int bitRate;
+    std::string codecName;
+    EncoderOptions segmentOptions;
+    int workers;
+    int segmentFrames;
+
+    // 视频滤镜（在分发线程中按顺序应用，滤镜图有状态，不能分给多个编码器）
+    bool useFilter;
+    VideoFilter *videoFilter;
+
+    // 编码回调（由收集线程按输出顺序调用）
+    VideoEncodeCallback encodeCallback;
+
+    // 线程控制
+    std::thread dispatchThread;
+    std::thread collectThread;
+    std::atomic<bool> isRunning;
+    std::atomic<bool> isPaused;
+
+    // 完成信号：收集线程输出完所有分段并关闭输出队列后发布
+    CompletionLatch completion;
+
+    // 已开始分发、等待收集的分段（按顺序），以及尚未收集完的分段数
+    std::mutex segmentMutex;
+    std::condition_variable segmentCond;
+    std::deque<std::unique_ptr<EncodeSegment>> pendingSegments;
+    int activeSegments;
+    bool dispatchFinished;
+
+    // 统计
+    std::atomic<int> frameCount;
+    std::atomic<int> segmentCount;
+
+    // 私有方法
+    void dispatchThreadFunc();
+    void collectThreadFunc();
+    EncodeSegment *openSegment(int index, int64_t frameOffset);
+    void sealSegment(EncodeSegment *segment);
+    int collectSegment(EncodeSegment &segment);
+    void sendEOF();
+
+public:
+    // 构造函数和析构函数
+    ParallelVideoEncoder(VideoFrameQueue &frameQueue, VideoPacketQueue &packetQueue);
+    ~ParallelVideoEncoder();
+
+    // 禁止拷贝和赋值
+    ParallelVideoEncoder(const ParallelVideoEncoder &) = delete;
+    ParallelVideoEncoder &operator=(const ParallelVideoEncoder &) = delete;
+
+    // 初始化方法，参数含义与 VideoEncoder::init 相同
+    bool init(int width, int height, int frameRate, int bitRate, const std::string &codecName = "libx264",
+              const EncoderOptions &options = EncoderOptions(),
+              const ParallelEncodeOptions &parallelOptions = ParallelEncodeOptions());
+
+    // 设置视频滤镜
+    bool setVideoFilter(VideoFilter *filter);
+
+    // 设置编码回调
+    void setEncodeCallback(VideoEncodeCallback callback);
+
+    // 线程控制
+    void start();
+    void stop();
+    void pause(bool pause);
+
+    // 等待所有分段编码完成，超时返回false
+    bool waitForCompletion(std::chrono::milliseconds timeout);
+    bool isCompleted() const;
+
+    // 获取编码器信息（来自参考编码器）
+    int getWidth() const;
+    int getHeight() const;
+    int getFrameRate() const;
+    int getBitRate() const;
+    const char *getCodecName() const;
+    int getThreadCount() const;
+    int getGopSize() const;
+    int getMaxBFrames() const;
+    int getWorkers() const;
+    int getSegmentFrames() const;
+
+    // 获取已分发的帧数和分段数
+    int getFrameCount() const;
+    int getSegmentCount() const;
+
+    // 获取编解码器上下文（参考编码器，供复用器创建输出流）
+    AVCodecContext *getCodecContext() const;
+};
+
+#endif // PARALLEL_VIDEO_ENCODER_H
@@ -0,0 +1,133 @@
+#ifndef READ_AHEAD_INPUT_H
+#define READ_AHEAD_INPUT_H
+
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include "RingBuffer.h"
+
+// 前向声明
+struct AVIOContext;
+
+// 默认预读窗口和预读线程每次read的字节数
+#define READ_AHEAD_DEFAULT_WINDOW (16 * 1024 * 1024)
+#define READ_AHEAD_DEFAULT_CHUNK (1024 * 1024)
+
+// 输入读取方式
+enum InputReadMode
+{
+    INPUT_READ_DEFAULT,  // 交给avformat_open_input使用默认的file协议（32KB同步读取）
+    INPUT_READ_AUTO,     // 普通文件用mmap，管道等不能映射的输入用预读线程
+    INPUT_READ_MMAP,     // 整个文件mmap，按读取进度提前madvise(WILLNEED)，不能映射时回退到预读线程
+    INPUT_READ_PREFETCH  // 预读线程把数据读进环形缓冲区
+};
+
+// 输入读取参数
+struct InputReadOptions
+{
+    InputReadMode mode;
+    // 预读窗口：mmap模式下提前建议内核读入的字节数，预读线程模式下环形缓冲区的容量
+    size_t readAheadBytes;
+    // 预读线程每次read的字节数（不超过预读窗口）
+    size_t chunkSize;
+
+    InputReadOptions() : mode(INPUT_READ_DEFAULT), readAheadBytes(READ_AHEAD_DEFAULT_WINDOW),
+                         chunkSize(READ_AHEAD_DEFAULT_CHUNK) {}
+};
+
+/**
+ * 带预读的输入文件（以自定义 AVIOContext 的形式交给解复用器）
+ *
+ * 默认的file协议每次只同步读32KB，解复用线程频繁陷入read，磁盘一慢解码器就跟着断粮。两种替代方式：
+ *  mmap：整个文件只读映射并 madvise(SEQUENTIAL)，读取时在当前位置之前始终保持一个预读窗口的
+ *        madvise(WILLNEED)，由内核在后台读入，读回调只是一次memcpy；
+ *  预读线程：后台线程把数据读进（镜像映射的）环形缓冲区，读回调只从缓冲区拷贝，
+ *        缓冲区空了才等待；普通文件用pread并支持任意seek，管道只支持缓冲区内的前向seek。
+ *
+ * 输入路径为 "-" 或 "pipe:" / "pipe:N" 时读取标准输入或文件描述符N。
+ * mmap模式下输入文件在读取期间被截断会导致SIGBUS，这类输入应使用预读线程。
+ */
+class ReadAheadInput
+{
+private:
+    AVIOContext *ioContext;
+    InputReadOptions options;
+    // 实际使用的方式（INPUT_READ_MMAP或INPUT_READ_PREFETCH）
+    InputReadMode activeMode;
+
+    // 输入文件描述符，是否由本类打开，是否为可以pread/seek的普通文件
+    int fd;
+    bool ownsFd;
+    bool seekable;
+    int64_t fileSize;
+
+    // 读回调看到的当前位置（只在解复用线程中访问）
+    int64_t position;
+
+    // mmap模式：映射区域和已经madvise(WILLNEED)到的位置
+    unsigned char *mapped;
+    size_t mappedSize;
+    int64_t advisedUntil;
+
+    // 预读线程模式：环形缓冲区和线程状态（受mutex保护）
+    std::unique_ptr<RingBuffer<unsigned char>> ring;
+    std::thread prefetchThread;
+    std::mutex mutex;
+    std::condition_variable dataCond;
+    std::condition_variable spaceCond;
+    bool stopping;
+    bool endOfFile;
+    int readError;
+    // seek后递增，预读线程丢弃seek之前发起的读取结果
+    uint64_t generation;
+    // 预读线程下一次读取的文件偏移
+    int64_t fetchOffset;
+
+    // 统计
+    uint64_t bytesRead;
+    uint64_t readCalls;
+    uint64_t starvedWaits;
+    int64_t starvedMicros;
+    uint64_t seekCount;
+
+    // AVIOContext回调
+    static int readPacket(void *opaque, uint8_t *buf, int bufSize);
+    static int64_t seekPacket(void *opaque, int64_t offset, int whence);
+    int read(uint8_t *buf, int size);
+    int64_t seek(int64_t offset, int whence);
+
+    bool openMapped();
+    bool openPrefetch();
+    int readMapped(uint8_t *buf, int size);
+    int readPrefetched(uint8_t *buf, int size);
+    void prefetchThreadFunc();
+
+public:
+    ReadAheadInput();
+    ~ReadAheadInput();
+
+    // 禁止拷贝和赋值
+    ReadAheadInput(const ReadAheadInput &) = delete;
+    ReadAheadInput &operator=(const ReadAheadInput &) = delete;
+
+    // 打开输入并创建AVIOContext，options.mode为INPUT_READ_DEFAULT时返回false
+    bool open(const std::string &path, const InputReadOptions &options);
+
+    // 交给解复用器使用的AVIOContext（需要同时设置AVFMT_FLAG_CUSTOM_IO）
+    AVIOContext *getIOContext() const;
+
+    // 停止预读线程，解除映射，关闭文件并释放AVIOContext
+    void close();
+
+    bool isOpen() const;
+    InputReadMode getActiveMode() const;
+
+    // 打印统计信息
+    void printStats() const;
+};
+
+#endif // READ_AHEAD_INPUT_H
@@ -3,6 +3,17 @@
 
 #include <cstddef> // 仅用于 size_t
 #include <cstring> // 用于 memcpy
+#include <atomic>  // SPSCRingBuffer 的原子索引
+#include <utility> // std::move
+
+#ifdef __linux__
+#include <sys/mman.h>    // mmap/munmap，镜像映射
+#include <sys/syscall.h> // SYS_memfd_create
+#include <unistd.h>      // ftruncate/close/sysconf
+#endif
+
+// 缓存行大小，生产者和消费者各自频繁写入的索引放在不同缓存行，避免伪共享
+#define RING_BUFFER_CACHE_LINE_SIZE 64
 
 /**
  * @brief 通用环形缓冲区实现，不依赖STL
@@ -218,6 +229,28 @@ public:
     }
 };
 
+// 环形缓冲区内的一段连续内存
+struct RingBufferSpan
+{
+    unsigned char *data;
+    size_t size;
+
+    RingBufferSpan() : data(nullptr), size(0) {}
+    RingBufferSpan(unsigned char *data, size_t size) : data(data), size(size) {}
+};
+
+// 零拷贝读写区域：跨越缓冲区末尾时分为两段，second.size为0表示只有一段
+struct RingBufferSpans
+{
+    RingBufferSpan first;
+    RingBufferSpan second;
+
+    size_t totalSize() const
+    {
+        return first.size + second.size;
+    }
+};
+
 // 针对字节数据的特化版本，提供更高效的批量操作
 template <>
 class RingBuffer<unsigned char>
@@ -229,19 +262,128 @@ private:
     size_t head;
     size_t tail;
     bool overwrite;
+    // buffer 是否为镜像映射（同一块内存在虚拟地址上连续映射两次）
+    bool mirrored;
+
+    /**
+     * 分配镜像映射的缓冲区（仅Linux）：用memfd创建一块共享内存，在一段2倍大小的预留地址上
+     * 连续映射两次，于是 buffer[i] 与 buffer[i + capacity] 是同一个字节，任何不超过capacity
+     * 的区域都是连续的。容量向上取整为页大小的整数倍。失败返回nullptr，由调用者回退到普通内存。
+     */
+    static unsigned char *allocateMirrored(size_t &capacity)
+    {
+#if defined(__linux__) && defined(SYS_memfd_create)
+        long pageSize = sysconf(_SC_PAGESIZE);
+        if (pageSize <= 0 || capacity == 0)
+            return nullptr;
+        size_t mappedSize = (capacity + pageSize - 1) / pageSize * pageSize;
+
+        // 1U 即 MFD_CLOEXEC（旧版glibc没有memfd_create封装和该宏）
+        int fd = static_cast<int>(syscall(SYS_memfd_create, "ring_buffer", 1U));
+        if (fd < 0)
+            return nullptr;
+        if (ftruncate(fd, static_cast<off_t>(mappedSize)) != 0)
+        {
+            close(fd);
+            return nullptr;
+        }
+
+        // 先预留2倍大小的连续地址，再把memfd固定映射到前后两半
+        void *reserved = mmap(nullptr, mappedSize * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (reserved == MAP_FAILED)
+        {
+            close(fd);
+            return nullptr;
+        }
+
+        unsigned char *base = static_cast<unsigned char *>(reserved);
+        void *first = mmap(base, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+        void *second = mmap(base + mappedSize, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+        // 映射建立后memfd可以关闭，内存随映射一起保留
+        close(fd);
+
+        if (first != base || second != base + mappedSize)
+        {
+            munmap(reserved, mappedSize * 2);
+            return nullptr;
+        }
+
+        capacity = mappedSize;
+        return base;
+#else
+        (void)capacity;
+        return nullptr;
+#endif
+    }
+
+    static void freeMirrored(unsigned char *buffer, size_t capacity)
+    {
+#ifdef __linux__
+        munmap(buffer, capacity * 2);
+#else
+        (void)buffer;
+        (void)capacity;
+#endif
+    }
+
+    // 从position开始、长度为count的区域（count不超过capacity），必要时在缓冲区末尾处分成两段；
+    // 镜像映射时越过末尾的部分直接落在第二份映射上，始终只有一段
+    RingBufferSpans makeSpans(size_t position, size_t count) const
+    {
+        RingBufferSpans spans;
+        if (count == 0)
+            return spans;
+
+        if (mirrored || position + count <= capacity)
+        {
+            spans.first = RingBufferSpan(buffer + position, count);
+        }
+        else
+        {
+            size_t firstPart = capacity - position;
+            spans.first = RingBufferSpan(buffer + position, firstPart);
+            spans.second = RingBufferSpan(buffer, count - firstPart);
+        }
+        return spans;
+    }
 
 public:
-    RingBuffer(size_t capacity, bool allowOverwrite = false)
-        : capacity(capacity), size(0), head(0), tail(0), overwrite(allowOverwrite)
+    /**
+     * @param allowMirror 为true时尝试使用镜像映射（仅Linux），读写区域跨越末尾时也是连续的一段，
+     *                    容量会向上取整为页大小的整数倍（以getCapacity为准）；
+     *                    其他平台或映射失败时回退到普通内存，可通过isMirrored查询
+     */
+    RingBuffer(size_t capacity, bool allowOverwrite = false, bool allowMirror = false)
+        : buffer(nullptr), capacity(capacity), size(0), head(0), tail(0), overwrite(allowOverwrite),
+          mirrored(false)
     {
-        buffer = new unsigned char[capacity];
+        if (allowMirror)
+        {
+            buffer = allocateMirrored(this->capacity);
+            mirrored = (buffer != nullptr);
+        }
+        if (!buffer)
+        {
+            buffer = new unsigned char[capacity];
+        }
     }
 
     ~RingBuffer()
     {
-        delete[] buffer;
+        if (mirrored)
+        {
+            freeMirrored(buffer, capacity);
+        }
+        else
+        {
+            delete[] buffer;
+        }
     }
 
+    // 禁止拷贝和赋值（缓冲区内存由实例独占）
+    RingBuffer(const RingBuffer &) = delete;
+    RingBuffer &operator=(const RingBuffer &) = delete;
+
     bool write(const unsigned char &item)
     {
         if (isFull())
@@ -290,23 +432,15 @@ public:
             count = available;
         }
 
-        // 执行写入操作
-        if (tail + count <= capacity)
-        {
-            // 连续空间足够
-            memcpy(buffer + tail, items, count);
-        }
-        else
+        // 执行写入操作（跨越末尾时分两段写入）
+        RingBufferSpans spans = reserveWrite(count);
+        memcpy(spans.first.data, items, spans.first.size);
+        if (spans.second.size > 0)
         {
-            // 需要分两段写入
-            size_t firstPart = capacity - tail;
-            memcpy(buffer + tail, items, firstPart);
-            memcpy(buffer, items + firstPart, count - firstPart);
+            memcpy(spans.second.data, items + spans.first.size, spans.second.size);
         }
 
-        tail = (tail + count) % capacity;
-        size += count;
-        return count;
+        return commitWrite(count);
     }
 
     bool read(unsigned char &item)
@@ -331,22 +465,15 @@ public:
         // 计算实际可读取的数量
         count = (count > size) ? size : count;
 
-        if (head + count <= capacity)
+        // 跨越末尾时分两段读取
+        RingBufferSpans spans = peekRead(count);
+        memcpy(items, spans.first.data, spans.first.size);
+        if (spans.second.size > 0)
         {
-            // 连续空间足够
-            memcpy(items, buffer + head, count);
-        }
-        else
-        {
-            // 需要分两段读取
-            size_t firstPart = capacity - head;
-            memcpy(items, buffer + head, firstPart);
-            memcpy(items + firstPart, buffer, count - firstPart);
+            memcpy(items + spans.first.size, spans.second.data, spans.second.size);
         }
 
-        head = (head + count) % capacity;
-        size -= count;
-        return count;
+        return consumeRead(count);
     }
 
     bool peek(unsigned char &item) const
@@ -360,6 +487,55 @@ public:
         return true;
     }
 
+    /**
+     * 零拷贝写入：预留最多count字节的空闲区域，调用者直接写入返回的一段或两段内存
+     * （例如作为 swr_convert 或 fread 的输出），再用 commitWrite 提交实际写入的字节数。
+     * 预留区域只包含空闲空间，不会覆盖旧数据（与overwrite选项无关）；
+     * 提交之前不能调用其他写操作。
+     */
+    RingBufferSpans reserveWrite(size_t count)
+    {
+        size_t available = capacity - size;
+        if (count > available)
+            count = available;
+        return makeSpans(tail, count);
+    }
+
+    // 提交reserveWrite预留区域中已写入的前count字节，返回实际提交的字节数
+    size_t commitWrite(size_t count)
+    {
+        size_t available = capacity - size;
+        if (count > available)
+            count = available;
+
+        tail = (tail + count) % capacity;
+        size += count;
+        return count;
+    }
+
+    /**
+     * 零拷贝读取：返回最多count字节的可读区域，调用者直接从返回的一段或两段内存读取
+     * （例如作为编码器或 fwrite 的输入），再用 consumeRead 释放已处理的字节数。
+     * 释放之前区域内的数据保持有效，不能调用其他读操作或会覆盖旧数据的写操作。
+     */
+    RingBufferSpans peekRead(size_t count)
+    {
+        if (count > size)
+            count = size;
+        return makeSpans(head, count);
+    }
+
+    // 释放可读区域中已处理的前count字节，返回实际释放的字节数
+    size_t consumeRead(size_t count)
+    {
+        if (count > size)
+            count = size;
+
+        head = (head + count) % capacity;
+        size -= count;
+        return count;
+    }
+
     void clear()
     {
         head = 0;
@@ -391,6 +567,270 @@ public:
     {
         return capacity - size;
     }
+
+    // 是否使用镜像映射（为true时reserveWrite/peekRead返回的区域总是一段）
+    bool isMirrored() const
+    {
+        return mirrored;
+    }
+};
+
+/**
+ * @brief 单生产者单消费者无锁环形缓冲区
+ *
+ * 与上面的 RingBuffer 不同，这个版本可以在两个线程之间并发使用：
+ * write/writeMultiple 只由生产者调用，read/readMultiple/clear 只由消费者调用，
+ * getSize/isEmpty/isFull 可以在任意线程调用（结果是瞬时值）。
+ *  容量向上取整为2的幂，下标用掩码计算，不再逐元素取余；
+ *  head/tail 是单调递增的原子索引（acquire/release），各自与本端缓存的对端索引独占一个缓存行，
+ *  只有看起来已满/已空时才去读对端的缓存行；
+ *  不再维护两端都要修改的 size 字段，元素数量由 tail - head 得出；
+ *  批量读写先处理完整批元素，再用一次 release store 发布新的索引。
+ * 元素以移动方式写入和读出，读出后槽位重置为 T()，因此可以存放 unique_ptr 等独占句柄。
+ * 不支持覆盖旧数据（覆盖需要生产者修改 head，无法保持单写者）。
+ */
+template <typename T>
+class SPSCRingBuffer
+{
+private:
+    T *buffer;       // 缓冲区数据
+    size_t capacity; // 缓冲区容量（2的幂）
+    size_t mask;     // capacity - 1
+
+    // 消费者侧：读取位置 + 缓存的写入位置
+    char padding0[RING_BUFFER_CACHE_LINE_SIZE];
+    std::atomic<size_t> head;
+    size_t cachedTail;
+    char padding1[RING_BUFFER_CACHE_LINE_SIZE - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+
+    // 生产者侧：写入位置 + 缓存的读取位置
+    std::atomic<size_t> tail;
+    size_t cachedHead;
+    char padding2[RING_BUFFER_CACHE_LINE_SIZE - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+
+    // 禁止拷贝构造和赋值操作
+    SPSCRingBuffer(const SPSCRingBuffer &) = delete;
+    SPSCRingBuffer &operator=(const SPSCRingBuffer &) = delete;
+
+    static size_t roundUpPowerOfTwo(size_t value)
+    {
+        size_t result = 1;
+        while (result < value)
+        {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    // 生产者可写的元素数，缓存的读取位置不够用时才重新读取head
+    size_t writableCount(size_t currentTail, size_t wanted)
+    {
+        size_t space = capacity - (currentTail - cachedHead);
+        if (space < wanted)
+        {
+            cachedHead = head.load(std::memory_order_acquire);
+            space = capacity - (currentTail - cachedHead);
+        }
+        return space;
+    }
+
+    // 消费者可读的元素数，缓存的写入位置不够用时才重新读取tail
+    size_t readableCount(size_t currentHead, size_t wanted)
+    {
+        size_t available = cachedTail - currentHead;
+        if (available < wanted)
+        {
+            cachedTail = tail.load(std::memory_order_acquire);
+            available = cachedTail - currentHead;
+        }
+        return available;
+    }
+
+public:
+    /**
+     * @brief 构造函数
+     *
+     * @param requestedCapacity 期望容量，向上取整为2的幂（至少为2）
+     */
+    explicit SPSCRingBuffer(size_t requestedCapacity)
+        : buffer(nullptr),
+          capacity(roundUpPowerOfTwo(requestedCapacity < 2 ? 2 : requestedCapacity)),
+          mask(0),
+          head(0),
+          cachedTail(0),
+          tail(0),
+          cachedHead(0)
+    {
+        mask = capacity - 1;
+        buffer = new T[capacity];
+    }
+
+    /**
+     * @brief 析构函数
+     */
+    ~SPSCRingBuffer()
+    {
+        delete[] buffer;
+    }
+
+    /**
+     * @brief 写入单个元素（仅生产者调用）
+     *
+     * @param item 要写入的元素，写入成功时被移走，缓冲区已满时保持不变
+     * @return 是否写入成功
+     */
+    bool write(T &&item)
+    {
+        const size_t currentTail = tail.load(std::memory_order_relaxed);
+        if (writableCount(currentTail, 1) == 0)
+        {
+            return false;
+        }
+
+        buffer[currentTail & mask] = std::move(item);
+
+        // 发布新元素，release保证消费者看到完整的槽位内容
+        tail.store(currentTail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool write(const T &item)
+    {
+        T copy(item);
+        return write(std::move(copy));
+    }
+
+    /**
+     * @brief 批量写入（仅生产者调用），整批写完后只发布一次写入位置
+     *
+     * @param items 要写入的元素数组，前"返回值"个元素被移走
+     * @param count 元素数量
+     * @return 实际写入的元素数量
+     */
+    size_t writeMultiple(T *items, size_t count)
+    {
+        const size_t currentTail = tail.load(std::memory_order_relaxed);
+        size_t space = writableCount(currentTail, count);
+        size_t written = count < space ? count : space;
+        if (written == 0)
+        {
+            return 0;
+        }
+
+        for (size_t i = 0; i < written; i++)
+        {
+            buffer[(currentTail + i) & mask] = std::move(items[i]);
+        }
+
+        tail.store(currentTail + written, std::memory_order_release);
+        return written;
+    }
+
+    /**
+     * @brief 读取单个元素（仅消费者调用）
+     *
+     * @param item 读取的元素将移入此变量
+     * @return 是否读取成功
+     */
+    bool read(T &item)
+    {
+        const size_t currentHead = head.load(std::memory_order_relaxed);
+        if (readableCount(currentHead, 1) == 0)
+        {
+            return false;
+        }
+
+        T &slot = buffer[currentHead & mask];
+        item = std::move(slot);
+        slot = T();
+
+        // 归还槽位，release保证生产者覆盖前我们已经读完
+        head.store(currentHead + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief 批量读取（仅消费者调用），整批读完后只发布一次读取位置
+     *
+     * @param items 存储读取元素的数组
+     * @param count 最多读取的元素数量
+     * @return 实际读取的元素数量
+     */
+    size_t readMultiple(T *items, size_t count)
+    {
+        const size_t currentHead = head.load(std::memory_order_relaxed);
+        size_t available = readableCount(currentHead, count);
+        size_t readCount = count < available ? count : available;
+        if (readCount == 0)
+        {
+            return 0;
+        }
+
+        for (size_t i = 0; i < readCount; i++)
+        {
+            T &slot = buffer[(currentHead + i) & mask];
+            items[i] = std::move(slot);
+            slot = T();
+        }
+
+        head.store(currentHead + readCount, std::memory_order_release);
+        return readCount;
+    }
+
+    /**
+     * @brief 清空缓冲区（仅消费者调用，或在没有生产者并发时调用）
+     */
+    void clear()
+    {
+        T item;
+        while (read(item))
+        {
+            item = T();
+        }
+    }
+
+    /**
+     * @brief 检查缓冲区是否为空（瞬时值）
+     */
+    bool isEmpty() const
+    {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief 检查缓冲区是否已满（瞬时值）
+     */
+    bool isFull() const
+    {
+        return getSize() >= capacity;
+    }
+
+    /**
+     * @brief 获取当前元素数量（瞬时值）
+     */
+    size_t getSize() const
+    {
+        // 先读head再读tail，保证结果不会为负
+        const size_t currentHead = head.load(std::memory_order_acquire);
+        const size_t currentTail = tail.load(std::memory_order_acquire);
+        return currentTail - currentHead;
+    }
+
+    /**
+     * @brief 获取缓冲区容量
+     */
+    size_t getCapacity() const
+    {
+        return capacity;
+    }
+
+    /**
+     * @brief 获取剩余空间（瞬时值）
+     */
+    size_t getAvailableSpace() const
+    {
+        return capacity - getSize();
+    }
 };
 
 #endif // RING_BUFFER_H
\ No newline at end of file
@@ -4,9 +4,11 @@
 #include <string>
 #include <thread>
 #include <atomic>
+#include <chrono>
 #include <functional>
 #include <fstream>
 #include "queue.h"
+#include "FrameBufferPool.h"
 
 // 前向声明
 struct AVCodecContext;
@@ -18,6 +20,29 @@ struct AVPacket;
 // 视频帧回调函数类型
 typedef std::function<void(AVFrame *)> VideoFrameCallback;
 
+// 解码线程类型
+enum DecoderThreadType
+{
+    DECODER_THREAD_AUTO,  // 帧级与片级都允许，由解码器选择
+    DECODER_THREAD_FRAME, // 帧级多线程：吞吐量高，但每个线程会增加一帧延迟
+    DECODER_THREAD_SLICE  // 片级多线程：不增加延迟，但取决于码流的分片数
+};
+
+/**
+ * 解码器线程选项：
+ *  threadCount：解码线程数，0表示自动（按CPU核数）
+ *  threadType：帧级/片级多线程
+ *  lowDelay：低延迟模式（直播任务），强制片级多线程并设置AV_CODEC_FLAG_LOW_DELAY
+ */
+struct DecoderThreadOptions
+{
+    int threadCount;
+    DecoderThreadType threadType;
+    bool lowDelay;
+
+    DecoderThreadOptions() : threadCount(0), threadType(DECODER_THREAD_AUTO), lowDelay(false) {}
+};
+
 // 视频解码器类
 class VideoDecoder
 {
@@ -39,6 +64,9 @@ private:
     std::atomic<bool> isRunning;
     std::atomic<bool> isPaused;
 
+    // 完成信号：线程刷新完所有输出并关闭输出队列后发布
+    CompletionLatch completion;
+
     // 帧回调函数
     VideoFrameCallback frameCallback;
 
@@ -50,12 +78,26 @@ private:
     // 直接YUV输出文件路径
     std::string directYuvOutput;
 
+    // 解码线程选项
+    DecoderThreadOptions threadOptions;
+
+    // 项目自有的帧缓冲池（get_buffer2），以及是否启用/是否使用透明大页
+    FrameBufferPool frameBufferPool;
+    bool useFrameBufferPool;
+    bool useHugePages;
+
+    // 时间段（流时间基，AV_NOPTS_VALUE表示不限）：范围外的帧解码后直接丢弃，以及丢弃的帧数
+    int64_t rangeStartPts;
+    int64_t rangeEndPts;
+    int rangeDiscardedFrames;
+
     // 私有方法
     bool initDecoder(AVCodecParameters *codecPar);
     void closeDecoder();
     void decodeThreadFunc();
     void saveFrameToYUV(AVFrame *frame);
     void writeFrameToYUVFile(AVFrame *frame, FILE *file);
+    bool isFrameInRange(const AVFrame *frame) const;
 
 public:
     // 构造函数和析构函数
@@ -66,12 +108,22 @@ public:
     VideoDecoder(const VideoDecoder &) = delete;
     VideoDecoder &operator=(const VideoDecoder &) = delete;
 
+    // 设置帧缓冲池选项，必须在init之前调用
+    void setFrameBufferPool(bool enable, bool hugePages = false);
+
     // 公共方法
-    bool init(AVCodecParameters *codecPar);
+    bool init(AVCodecParameters *codecPar, const DecoderThreadOptions &options = DecoderThreadOptions());
     void start();
     void stop();
     void pause(bool pause);
 
+    // 等待视频解码线程完成，超时返回false
+    bool waitForCompletion(std::chrono::milliseconds timeout);
+    bool isCompleted() const;
+
+    // 设置时间段（流时间基），pts在[startPts, endPts)之外的帧不再输出，必须在解码线程启动前调用
+    void setTimeRange(int64_t startPts, int64_t endPts);
+
     // 设置帧回调
     void setFrameCallback(VideoFrameCallback callback);
 
@@ -88,6 +140,10 @@ public:
     double getFrameRate() const;
     const char *getCodecName() const;
 
+    // 获取实际生效的解码线程配置（解码器打开后才有效）
+    int getThreadCount() const;
+    const char *getThreadTypeName() const;
+
     // 获取解码后的帧
     AVFrame *getFrame();
 
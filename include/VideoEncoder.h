@@ -4,7 +4,9 @@
 #include <string>
 #include <thread>
 #include <atomic>
+#include <chrono>
 #include <functional>
+#include <map>
 #include "queue.h"
 #include "../include/VideoFilter.h"
 
@@ -13,10 +15,20 @@ struct AVCodecContext;
 struct AVFrame;
 struct AVPacket;
 struct AVCodec;
+struct AVDictionary;
 
 // 视频编码回调函数类型
 typedef std::function<void(AVPacket *)> VideoEncodeCallback;
 
+/**
+ * 编码器选项（键值对），在avcodec_open2时应用，覆盖编码器的默认参数：
+ *  通用选项（AVCodecContext）：threads（数字或auto）、thread_type（frame/slice）、slices、
+ *                              gop（即g）、bframes（即bf）
+ *  常用私有选项：preset、tune、crf、lookahead（即rc-lookahead）
+ *  其他键原样传给编码器的priv_data（如x264-params、profile、level）
+ */
+typedef std::map<std::string, std::string> EncoderOptions;
+
 // 视频编码器类
 class VideoEncoder
 {
@@ -38,6 +50,9 @@ private:
     std::atomic<bool> isRunning;
     std::atomic<bool> isPaused;
 
+    // 完成信号：线程刷新完所有输出并关闭输出队列后发布
+    CompletionLatch completion;
+
     // 帧计数
     int frameCount;
 
@@ -55,8 +70,13 @@ private:
     bool useFilter;
     VideoFilter *videoFilter;
 
+    // 用户指定的编码器选项
+    EncoderOptions options;
+
     // 私有方法
     bool initEncoder();
+    AVDictionary *buildOptionDictionary() const;
+    void reportUnusedOptions(AVDictionary *unused) const;
     void closeEncoder();
     void encodeThreadFunc();
     bool encodeFrame(AVFrame *frame);
@@ -72,7 +92,8 @@ public:
     VideoEncoder &operator=(const VideoEncoder &) = delete;
 
     // 初始化方法
-    bool init(int width, int height, int frameRate, int bitRate, const std::string &codecName = "libx264");
+    bool init(int width, int height, int frameRate, int bitRate, const std::string &codecName = "libx264",
+              const EncoderOptions &options = EncoderOptions());
 
     // 设置视频滤镜
     bool setVideoFilter(VideoFilter *filter);
@@ -85,6 +106,10 @@ public:
     void stop();
     void pause(bool pause);
 
+    // 等待视频编码线程完成，超时返回false
+    bool waitForCompletion(std::chrono::milliseconds timeout);
+    bool isCompleted() const;
+
     // 设置编码回调
     void setEncodeCallback(VideoEncodeCallback callback);
 
@@ -94,6 +119,9 @@ public:
     int getFrameRate() const;
     int getBitRate() const;
     const char *getCodecName() const;
+    int getThreadCount() const;
+    int getGopSize() const;
+    int getMaxBFrames() const;
 
     // 获取编码帧数
     int getFrameCount() const;
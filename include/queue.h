@@ -3,16 +3,45 @@
 
 #include <mutex>              // 替换pthread_mutex_t
 #include <condition_variable> // 替换pthread_cond_t
+#include <atomic>
+#include <chrono>
+#include <utility>
+#include <memory>
+#include <cstddef>
+#include "MediaPool.h"
+#include "RingBuffer.h"
+
+// AVPacket删除器：句柄销毁时释放引用的数据，外壳归还对象池
+struct AVPacketDeleter
+{
+    void operator()(AVPacket *packet) const
+    {
+        MediaPool::releasePacket(packet);
+    }
+};
+
+// AVFrame删除器：句柄销毁时释放引用的数据，外壳归还对象池
+struct AVFrameDeleter
+{
+    void operator()(AVFrame *frame) const
+    {
+        MediaPool::releaseFrame(frame);
+    }
+};
 
-// 前向声明
-extern "C"
+// 数据包/帧的独占句柄，在各阶段之间通过移动传递所有权
+typedef std::unique_ptr<AVPacket, AVPacketDeleter> AVPacketPtr;
+typedef std::unique_ptr<AVFrame, AVFrameDeleter> AVFramePtr;
+
+// 从对象池获取空的数据包/帧句柄，代替 av_packet_alloc / av_frame_alloc
+inline AVPacketPtr allocPacket()
 {
-    struct AVPacket;
-    struct AVFrame;
+    return AVPacketPtr(MediaPool::acquirePacket());
+}
 
-    // FFmpeg函数声明
-    void av_packet_free(AVPacket **pkt);
-    void av_frame_free(AVFrame **frame);
+inline AVFramePtr allocFrame()
+{
+    return AVFramePtr(MediaPool::acquireFrame());
 }
 
 // 队列节点结构体
@@ -200,152 +229,607 @@ public:
     }
 };
 
-// 视频包队列
-class VideoPacketQueue : public ThreadSafeQueue<void *>
+// 缓存行大小，用于隔离生产者和消费者各自频繁写入的字段，避免伪共享
+#define QUEUE_CACHE_LINE_SIZE 64
+
+// 各阶段队列的默认容量（队列满时生产者等待，从而给内存占用设置硬上限）
+#define DEFAULT_PACKET_QUEUE_CAPACITY 1024
+#define DEFAULT_VIDEO_FRAME_QUEUE_CAPACITY 32
+#define DEFAULT_AUDIO_FRAME_QUEUE_CAPACITY 256
+
+// 队列状态变化通知器
+//
+// 需要同时等待多个队列的线程（例如复用器同时等待音频和视频包）可以把同一个通知器挂到多个队列上，
+// 任一队列发生入队、出队或关闭时都会唤醒等待者。没有等待者时notify只是一次原子读，不会加锁。
+class QueueNotifier
 {
+private:
+    std::atomic<int> waiters;
+    std::mutex mutex;
+    std::condition_variable cond;
+
+    // 禁止拷贝构造和赋值操作
+    QueueNotifier(const QueueNotifier &) = delete;
+    QueueNotifier &operator=(const QueueNotifier &) = delete;
+
 public:
-    VideoPacketQueue() : ThreadSafeQueue<void *>() {}
-    ~VideoPacketQueue() {}
+    QueueNotifier() : waiters(0) {}
 
-    // 重写clear方法，确保正确释放AVPacket资源
-    void clear() override
+    // 唤醒所有等待者（调用前状态必须已经发布，并执行过seq_cst内存屏障）
+    void notify()
     {
-        std::lock_guard<std::mutex> lock(mutex);
-
-        // 逐个删除节点，并释放AVPacket
-        QueueNode<void *> *current = head;
-        while (current != nullptr)
+        if (waiters.load(std::memory_order_relaxed) > 0)
         {
-            QueueNode<void *> *temp = current;
-            current = current->next;
-
-            // 释放AVPacket
-            if (temp->data != nullptr)
+            // 先获取一次锁，保证等待者要么还没检查条件，要么已经进入等待
             {
-                AVPacket *packet = static_cast<AVPacket *>(temp->data);
-                // 使用FFmpeg函数释放AVPacket
-                av_packet_free(&packet);
+                std::lock_guard<std::mutex> lock(mutex);
             }
+            cond.notify_all();
+        }
+    }
 
-            delete temp;
+    // 等待直到ready()为真或超时，返回ready()的最终结果
+    template <typename Predicate>
+    bool waitFor(std::chrono::milliseconds timeout, Predicate ready)
+    {
+        if (ready())
+        {
+            return true;
         }
 
-        // 重置队列状态
-        head = nullptr;
-        tail = nullptr;
-        size = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        waiters.fetch_add(1, std::memory_order_seq_cst);
+        // 与生产者一侧的屏障配对，保证不会错过通知
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool result = cond.wait_for(lock, timeout, ready);
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+        return result;
     }
 };
 
-// 音频包队列
-class AudioPacketQueue : public ThreadSafeQueue<void *>
+// 阶段完成信号（一次性门闩）
+//
+// 每个阶段的线程在刷新完所有输出、关闭输出队列之后发布完成信号，
+// 主线程据此确定性地等待流水线结束，不再靠轮询队列和固定时长的sleep。
+// start()时reset()，线程函数退出时由CompletionGuard自动signal()。
+class CompletionLatch
 {
+private:
+    mutable std::mutex mutex;
+    std::condition_variable cond;
+    bool done;
+
+    // 禁止拷贝构造和赋值操作
+    CompletionLatch(const CompletionLatch &) = delete;
+    CompletionLatch &operator=(const CompletionLatch &) = delete;
+
 public:
-    AudioPacketQueue() : ThreadSafeQueue<void *>() {}
-    ~AudioPacketQueue() {}
+    CompletionLatch() : done(false) {}
 
-    // 重写clear方法，确保正确释放AVPacket资源
-    void clear() override
+    // 重新开始（线程启动前调用）
+    void reset()
     {
         std::lock_guard<std::mutex> lock(mutex);
+        done = false;
+    }
 
-        // 逐个删除节点，并释放AVPacket
-        QueueNode<void *> *current = head;
-        while (current != nullptr)
+    // 发布完成信号，唤醒所有等待者
+    void signal()
+    {
         {
-            QueueNode<void *> *temp = current;
-            current = current->next;
+            std::lock_guard<std::mutex> lock(mutex);
+            done = true;
+        }
+        cond.notify_all();
+    }
+
+    // 是否已完成
+    bool isDone() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return done;
+    }
+
+    // 等待完成，超时返回false
+    bool waitFor(std::chrono::milliseconds timeout)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        return cond.wait_for(lock, timeout, [this]
+                             { return done; });
+    }
+};
+
+// 线程函数退出（包括提前return）时自动发布完成信号
+class CompletionGuard
+{
+private:
+    CompletionLatch &latch;
+
+    CompletionGuard(const CompletionGuard &) = delete;
+    CompletionGuard &operator=(const CompletionGuard &) = delete;
+
+public:
+    explicit CompletionGuard(CompletionLatch &latch) : latch(latch) {}
+    ~CompletionGuard() { latch.signal(); }
+};
+
+// 一个队列最多可以挂接的外部通知器数量
+#define QUEUE_MAX_NOTIFIERS 4
+
+// 批量入队/出队时每次在栈上暂存的元素数
+#define QUEUE_BATCH_SIZE 16
+
+// 有界无锁队列（单生产者单消费者，基于 SPSCRingBuffer 实现）
+//
+// 流水线中每一跳（解复用->解码->编码->复用）都只有一个生产者线程和一个消费者线程，
+// 因此可以用两个原子索引代替互斥锁：push只由生产者调用，pop/tryPop/clear只由消费者调用，
+// getSize/isEmpty可以在任意线程调用（结果只是一个瞬时值）。
+// 无锁部分（2的幂容量、分处不同缓存行的读写索引、批量发布）由 SPSCRingBuffer 提供，
+// 这里在其上增加字节统计、阻塞等待、关闭和外部通知。
+// 队列为空/已满时等待方会挂在条件变量上，对端发布数据后立即唤醒；
+// 生产者结束时调用close()，消费者取完剩余数据后pop/popFor即返回失败。
+template <typename T>
+class SPSCQueue
+{
+protected:
+    // 槽位：元素及其负载字节数（用于按字节统计队列占用）
+    struct Slot
+    {
+        T value;
+        size_t bytes;
+
+        Slot() : value(), bytes(0) {}
+    };
+
+    // 无锁环形缓冲区
+    SPSCRingBuffer<Slot> ring;
+
+    // 已出队字节数（只由消费者写）和已入队字节数（只由生产者写），各自独占一个缓存行
+    char padding0[QUEUE_CACHE_LINE_SIZE];
+    std::atomic<size_t> poppedBytes;
+    char padding1[QUEUE_CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> pushedBytes;
+    char padding2[QUEUE_CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+
+    // 阻塞等待相关状态（只在队列为空/已满的慢路径上使用）
+    std::atomic<bool> closed;
+    std::atomic<int> waiters;
+    std::mutex waitMutex;
+    std::condition_variable waitCond;
+
+    // 外部通知器（需在线程启动前挂接）
+    QueueNotifier *notifiers[QUEUE_MAX_NOTIFIERS];
+    int notifierCount;
+
+    // 状态发生变化后唤醒等待者
+    void notifyWaiters()
+    {
+        // 与等待方的屏障配对：要么我们看到等待者，要么等待者看到新的索引
+        std::atomic_thread_fence(std::memory_order_seq_cst);
 
-            // 释放AVPacket
-            if (temp->data != nullptr)
+        if (waiters.load(std::memory_order_relaxed) > 0)
+        {
             {
-                AVPacket *packet = static_cast<AVPacket *>(temp->data);
-                // 使用FFmpeg函数释放AVPacket
-                av_packet_free(&packet);
+                std::lock_guard<std::mutex> lock(waitMutex);
             }
+            waitCond.notify_all();
+        }
 
-            delete temp;
+        for (int i = 0; i < notifierCount; i++)
+        {
+            notifiers[i]->notify();
         }
+    }
 
-        // 重置队列状态
-        head = nullptr;
-        tail = nullptr;
-        size = 0;
+    // 在内部条件变量上等待，直到ready()为真或到达截止时间
+    template <typename Predicate>
+    bool waitUntil(const std::chrono::steady_clock::time_point &deadline, Predicate ready)
+    {
+        if (ready())
+        {
+            return true;
+        }
+
+        std::unique_lock<std::mutex> lock(waitMutex);
+        waiters.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool result = waitCond.wait_until(lock, deadline, ready);
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+        return result;
     }
-};
 
-// 视频帧队列 - 用于存储解码后的视频帧
-class VideoFrameQueue : public ThreadSafeQueue<void *>
-{
+    // 是否还有可写空间
+    bool hasSpace() const
+    {
+        return !ring.isFull();
+    }
+
+    // 累加字节统计（每个计数只有一个写者，不需要read-modify-write原子操作）
+    static void addBytes(std::atomic<size_t> &counter, size_t bytes)
+    {
+        if (bytes > 0)
+        {
+            counter.store(counter.load(std::memory_order_relaxed) + bytes, std::memory_order_release);
+        }
+    }
+
+private:
+    // 禁止拷贝构造和赋值操作
+    SPSCQueue(const SPSCQueue &) = delete;
+    SPSCQueue &operator=(const SPSCQueue &) = delete;
+
 public:
-    VideoFrameQueue() : ThreadSafeQueue<void *>() {}
-    ~VideoFrameQueue() {}
+    // 构造函数，容量向上取整为2的幂
+    explicit SPSCQueue(size_t requestedCapacity)
+        : ring(requestedCapacity),
+          poppedBytes(0),
+          pushedBytes(0),
+          closed(false),
+          waiters(0),
+          notifierCount(0)
+    {
+    }
 
-    // 重写clear方法，确保正确释放AVFrame资源
-    void clear() override
+    // 析构函数
+    virtual ~SPSCQueue()
     {
-        std::lock_guard<std::mutex> lock(mutex);
+    }
 
-        // 逐个删除节点，并释放AVFrame
-        QueueNode<void *> *current = head;
-        while (current != nullptr)
+    // 尝试入队（仅生产者调用），队列已满或已关闭时返回false且不修改value
+    // bytes为该元素的负载字节数（可选），计入getBytes()的统计
+    bool tryPush(T &&value, size_t bytes = 0)
+    {
+        if (closed.load(std::memory_order_acquire))
         {
-            QueueNode<void *> *temp = current;
-            current = current->next;
+            return false;
+        }
+
+        Slot slot;
+        slot.value = std::move(value);
+        slot.bytes = bytes;
+        if (!ring.write(std::move(slot)))
+        {
+            // 队列已满，元素还给调用者
+            value = std::move(slot.value);
+            return false;
+        }
+
+        addBytes(pushedBytes, bytes);
+        notifyWaiters();
+        return true;
+    }
 
-            // 释放AVFrame
-            if (temp->data != nullptr)
+    bool tryPush(const T &value, size_t bytes = 0)
+    {
+        T copy(value);
+        return tryPush(std::move(copy), bytes);
+    }
+
+    // 入队操作，如果队列已满则等待消费者腾出空间
+    // 返回false表示队列已关闭，此时value未被移动，所有权仍归调用者
+    bool push(T &&value, size_t bytes = 0)
+    {
+        while (!tryPush(std::move(value), bytes))
+        {
+            if (closed.load(std::memory_order_acquire))
             {
-                AVFrame *frame = static_cast<AVFrame *>(temp->data);
-                // 使用FFmpeg函数释放AVFrame
-                av_frame_free(&frame);
+                return false;
             }
 
-            delete temp;
+            waitUntil(std::chrono::steady_clock::now() + std::chrono::milliseconds(100), [this]
+                      { return hasSpace() || closed.load(std::memory_order_acquire); });
         }
+        return true;
+    }
 
-        // 重置队列状态
-        head = nullptr;
-        tail = nullptr;
-        size = 0;
+    bool push(const T &value, size_t bytes = 0)
+    {
+        T copy(value);
+        return push(std::move(copy), bytes);
     }
-};
 
-// 音频帧队列 - 用于存储解码后的音频帧
-class AudioFrameQueue : public ThreadSafeQueue<void *>
-{
-public:
-    AudioFrameQueue() : ThreadSafeQueue<void *>() {}
-    ~AudioFrameQueue() {}
+    // 带超时的入队操作（仅生产者调用）
+    // 返回false表示超时或队列已关闭（可用isClosed()区分），此时value未被移动
+    bool pushFor(T &&value, size_t bytes, std::chrono::milliseconds timeout)
+    {
+        if (tryPush(std::move(value), bytes))
+        {
+            return true;
+        }
+
+        waitUntil(std::chrono::steady_clock::now() + timeout, [this]
+                  { return hasSpace() || closed.load(std::memory_order_acquire); });
+        return tryPush(std::move(value), bytes);
+    }
 
-    // 重写clear方法，确保正确释放AVFrame资源
-    void clear() override
+    // 尝试批量入队（仅生产者调用），每批只发布一次写入位置、唤醒一次消费者
+    // bytes可以为nullptr；返回实际入队数量，前"返回值"个元素被移走，其余仍归调用者
+    size_t tryPushMultiple(T *values, const size_t *bytes, size_t count)
     {
-        std::lock_guard<std::mutex> lock(mutex);
+        if (closed.load(std::memory_order_acquire))
+        {
+            return 0;
+        }
 
-        // 逐个删除节点，并释放AVFrame
-        QueueNode<void *> *current = head;
-        while (current != nullptr)
+        size_t pushed = 0;
+        size_t pushedByteCount = 0;
+        while (pushed < count)
         {
-            QueueNode<void *> *temp = current;
-            current = current->next;
+            Slot staged[QUEUE_BATCH_SIZE];
+            size_t batch = count - pushed < QUEUE_BATCH_SIZE ? count - pushed : QUEUE_BATCH_SIZE;
+            for (size_t i = 0; i < batch; i++)
+            {
+                staged[i].value = std::move(values[pushed + i]);
+                staged[i].bytes = bytes ? bytes[pushed + i] : 0;
+            }
 
-            // 释放AVFrame
-            if (temp->data != nullptr)
+            size_t written = ring.writeMultiple(staged, batch);
+            for (size_t i = 0; i < written; i++)
             {
-                AVFrame *frame = static_cast<AVFrame *>(temp->data);
-                // 使用FFmpeg函数释放AVFrame
-                av_frame_free(&frame);
+                pushedByteCount += staged[i].bytes;
+            }
+            // 没写进去的元素还给调用者
+            for (size_t i = written; i < batch; i++)
+            {
+                values[pushed + i] = std::move(staged[i].value);
             }
 
-            delete temp;
+            pushed += written;
+            if (written < batch)
+            {
+                break;
+            }
         }
 
-        // 重置队列状态
-        head = nullptr;
-        tail = nullptr;
-        size = 0;
+        if (pushed > 0)
+        {
+            addBytes(pushedBytes, pushedByteCount);
+            notifyWaiters();
+        }
+        return pushed;
+    }
+
+    // 批量入队，空间不足时等待消费者腾出空间
+    // 返回入队数量，小于count表示队列已关闭，未入队的元素仍归调用者
+    size_t pushMultiple(T *values, const size_t *bytes, size_t count)
+    {
+        size_t pushed = 0;
+        while (pushed < count)
+        {
+            pushed += tryPushMultiple(values + pushed, bytes ? bytes + pushed : nullptr, count - pushed);
+            if (pushed == count || closed.load(std::memory_order_acquire))
+            {
+                break;
+            }
+
+            waitUntil(std::chrono::steady_clock::now() + std::chrono::milliseconds(100), [this]
+                      { return hasSpace() || closed.load(std::memory_order_acquire); });
+        }
+        return pushed;
+    }
+
+    // 尝试出队（仅消费者调用），如果队列为空则返回false
+    bool tryPop(T &value)
+    {
+        Slot slot;
+        if (!ring.read(slot))
+        {
+            return false;
+        }
+
+        value = std::move(slot.value);
+        addBytes(poppedBytes, slot.bytes);
+        notifyWaiters();
+        return true;
+    }
+
+    // 尝试批量出队（仅消费者调用），每批只发布一次读取位置、唤醒一次生产者
+    // 返回实际出队数量
+    size_t tryPopMultiple(T *values, size_t count)
+    {
+        size_t popped = 0;
+        size_t poppedByteCount = 0;
+        while (popped < count)
+        {
+            Slot staged[QUEUE_BATCH_SIZE];
+            size_t batch = count - popped < QUEUE_BATCH_SIZE ? count - popped : QUEUE_BATCH_SIZE;
+            size_t readCount = ring.readMultiple(staged, batch);
+            for (size_t i = 0; i < readCount; i++)
+            {
+                values[popped + i] = std::move(staged[i].value);
+                poppedByteCount += staged[i].bytes;
+            }
+
+            popped += readCount;
+            if (readCount < batch)
+            {
+                break;
+            }
+        }
+
+        if (popped > 0)
+        {
+            addBytes(poppedBytes, poppedByteCount);
+            notifyWaiters();
+        }
+        return popped;
+    }
+
+    // 等待直到队列非空、队列已关闭或超时
+    // 返回true表示队列中有数据可取
+    bool waitNonEmpty(std::chrono::milliseconds timeout)
+    {
+        waitUntil(std::chrono::steady_clock::now() + timeout, [this]
+                  { return !isEmpty() || closed.load(std::memory_order_acquire); });
+        return !isEmpty();
+    }
+
+    // 带超时的出队操作（仅消费者调用）
+    // 返回false表示超时，或队列已关闭且数据已全部取完（可用isDrained()区分）
+    bool popFor(T &value, std::chrono::milliseconds timeout)
+    {
+        if (tryPop(value))
+        {
+            return true;
+        }
+
+        waitNonEmpty(timeout);
+        return tryPop(value);
+    }
+
+    // 带超时的批量出队（仅消费者调用），有数据时立即取走当前可取的部分（最多count个）
+    // 返回0表示超时，或队列已关闭且数据已全部取完（可用isDrained()区分）
+    size_t popMultipleFor(T *values, size_t count, std::chrono::milliseconds timeout)
+    {
+        size_t popped = tryPopMultiple(values, count);
+        if (popped > 0)
+        {
+            return popped;
+        }
+
+        waitNonEmpty(timeout);
+        return tryPopMultiple(values, count);
+    }
+
+    // 出队操作，如果队列为空则阻塞，队列关闭且为空时返回T()
+    T pop()
+    {
+        T value = T();
+        while (!tryPop(value))
+        {
+            if (isDrained())
+            {
+                return T();
+            }
+            waitNonEmpty(std::chrono::milliseconds(100));
+        }
+        return value;
     }
+
+    // 关闭队列：之后的入队都会失败，已入队的数据仍可取出，所有等待者被唤醒
+    void close()
+    {
+        closed.store(true, std::memory_order_release);
+        notifyWaiters();
+    }
+
+    // 队列是否已关闭
+    bool isClosed() const
+    {
+        return closed.load(std::memory_order_acquire);
+    }
+
+    // 队列是否已关闭且没有剩余数据
+    bool isDrained() const
+    {
+        return closed.load(std::memory_order_acquire) && isEmpty();
+    }
+
+    // 挂接外部通知器（必须在生产者和消费者线程启动之前调用）
+    bool addNotifier(QueueNotifier *notifier)
+    {
+        if (!notifier || notifierCount >= QUEUE_MAX_NOTIFIERS)
+        {
+            return false;
+        }
+        notifiers[notifierCount++] = notifier;
+        return true;
+    }
+
+    // 摘除外部通知器（必须在生产者和消费者线程结束之后调用）
+    void removeNotifier(QueueNotifier *notifier)
+    {
+        for (int i = 0; i < notifierCount; i++)
+        {
+            if (notifiers[i] == notifier)
+            {
+                notifiers[i] = notifiers[--notifierCount];
+                return;
+            }
+        }
+    }
+
+    // 获取队列大小（瞬时值）
+    int getSize() const
+    {
+        return static_cast<int>(ring.getSize());
+    }
+
+    // 获取队列中元素的负载总字节数（瞬时值）
+    size_t getBytes() const
+    {
+        // 先读出队字节数再读入队字节数，保证结果不会为负
+        const size_t popped = poppedBytes.load(std::memory_order_acquire);
+        const size_t pushed = pushedBytes.load(std::memory_order_acquire);
+        return pushed >= popped ? pushed - popped : 0;
+    }
+
+    // 获取队列容量
+    size_t getCapacity() const
+    {
+        return ring.getCapacity();
+    }
+
+    // 提供给外部调用
+    bool isEmpty() const
+    {
+        return ring.isEmpty();
+    }
+
+    // 清空队列（仅消费者调用，或在没有生产者并发时调用）
+    virtual void clear()
+    {
+        T value;
+        while (tryPop(value))
+        {
+        }
+    }
+};
+
+// 媒体数据队列：存放带自定义删除器的独占句柄
+//
+// 句柄随push/pop移动，引用计数的数据只转移不复制；队列析构或clear()时
+// 剩余元素由删除器自动释放，push失败时所有权仍留在调用者手中，不会泄漏。
+template <typename T, typename Deleter>
+class MediaQueue : public SPSCQueue<std::unique_ptr<T, Deleter>>
+{
+public:
+    typedef std::unique_ptr<T, Deleter> Handle;
+
+    explicit MediaQueue(size_t capacity) : SPSCQueue<Handle>(capacity) {}
+    virtual ~MediaQueue() {}
+};
+
+// 数据包队列和帧队列
+typedef MediaQueue<AVPacket, AVPacketDeleter> PacketQueue;
+typedef MediaQueue<AVFrame, AVFrameDeleter> FrameQueue;
+
+// 视频包队列
+class VideoPacketQueue : public PacketQueue
+{
+public:
+    explicit VideoPacketQueue(size_t capacity = DEFAULT_PACKET_QUEUE_CAPACITY) : PacketQueue(capacity) {}
+};
+
+// 音频包队列
+class AudioPacketQueue : public PacketQueue
+{
+public:
+    explicit AudioPacketQueue(size_t capacity = DEFAULT_PACKET_QUEUE_CAPACITY) : PacketQueue(capacity) {}
+};
+
+// 视频帧队列 - 用于存储解码后的视频帧
+class VideoFrameQueue : public FrameQueue
+{
+public:
+    explicit VideoFrameQueue(size_t capacity = DEFAULT_VIDEO_FRAME_QUEUE_CAPACITY) : FrameQueue(capacity) {}
+};
+
+// 音频帧队列 - 用于存储解码后的音频帧
+class AudioFrameQueue : public FrameQueue
+{
+public:
+    explicit AudioFrameQueue(size_t capacity = DEFAULT_AUDIO_FRAME_QUEUE_CAPACITY) : FrameQueue(capacity) {}
 };
 
 #endif // QUEUE_H
@@ -0,0 +1,610 @@
+#include "../include/AsyncFileWriter.h"
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+// 引入FFmpeg头文件
+extern "C"
+{
+#include "ffmpeg/include_ffmpeg/libavformat/avio.h"
+#include "ffmpeg/include_ffmpeg/libavutil/error.h"
+#include "ffmpeg/include_ffmpeg/libavutil/mem.h"
+}
+
+// AVIOContext自身的缓冲区大小（写回调每次收到的最大字节数）
+#define ASYNC_WRITER_AVIO_BUFFER_SIZE (64 * 1024)
+// 一次pwritev最多合并的块数
+#define ASYNC_WRITER_MAX_COALESCE 16
+
+namespace
+{
+    size_t alignUp(size_t value, size_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+// 构造函数
+AsyncFileWriter::AsyncFileWriter()
+    : ioContext(nullptr),
+      fd(-1),
+      directFd(-1),
+      currentBlock(-1),
+      inflightBlocks(0),
+      position(0),
+      logicalSize(0),
+      stopping(false),
+      writeError(0),
+      bytesWritten(0),
+      writeCalls(0),
+      directWrites(0),
+      syncCalls(0),
+      stallCount(0),
+      stallMicros(0),
+      bytesSinceSync(0)
+{
+}
+
+// 析构函数
+AsyncFileWriter::~AsyncFileWriter()
+{
+    if (isOpen())
+    {
+        close();
+    }
+    releaseResources();
+}
+
+// 创建输出文件，分配写缓冲块和AVIOContext，启动写线程
+bool AsyncFileWriter::open(const std::string &path, const AsyncWriteOptions &options)
+{
+    if (isOpen())
+    {
+        std::cerr << "后台写文件: 文件已打开: " << this->path << std::endl;
+        return false;
+    }
+
+    this->path = path;
+    this->options = options;
+    this->options.blockSize = alignUp(options.blockSize > 0 ? options.blockSize : ASYNC_WRITER_DEFAULT_BLOCK_SIZE,
+                                      ASYNC_WRITER_ALIGN);
+    if (this->options.blockCount < 2)
+    {
+        this->options.blockCount = 2;
+    }
+
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        std::cerr << "后台写文件: 无法打开输出文件: " << path << " (" << strerror(errno) << ")" << std::endl;
+        return false;
+    }
+
+    // 写线程使用pwrite按偏移写入，只能用于普通文件
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || !S_ISREG(fileStat.st_mode))
+    {
+        std::cerr << "后台写文件: 输出不是普通文件，不能使用后台写入: " << path << std::endl;
+        releaseResources();
+        return false;
+    }
+
+    if (this->options.directIO)
+    {
+#ifdef O_DIRECT
+        directFd = ::open(path.c_str(), O_WRONLY | O_DIRECT | O_CLOEXEC);
+        if (directFd < 0)
+        {
+            std::cerr << "后台写文件: 文件系统不支持O_DIRECT，改用普通写入 (" << strerror(errno) << ")" << std::endl;
+        }
+#else
+        std::cerr << "后台写文件: 当前平台不支持O_DIRECT，改用普通写入" << std::endl;
+#endif
+    }
+
+    // 分配对齐的写缓冲块
+    blocks.resize(this->options.blockCount);
+    for (size_t i = 0; i < blocks.size(); i++)
+    {
+        void *memory = nullptr;
+        if (posix_memalign(&memory, ASYNC_WRITER_ALIGN, this->options.blockSize) != 0)
+        {
+            std::cerr << "后台写文件: 无法分配写缓冲块" << std::endl;
+            releaseResources();
+            return false;
+        }
+        blocks[i].data = static_cast<unsigned char *>(memory);
+        blocks[i].size = 0;
+        blocks[i].offset = 0;
+        freeBlocks.push_back(static_cast<int>(i));
+    }
+
+    unsigned char *avioBuffer = static_cast<unsigned char *>(av_malloc(ASYNC_WRITER_AVIO_BUFFER_SIZE));
+    if (!avioBuffer)
+    {
+        std::cerr << "后台写文件: 无法分配AVIO缓冲区" << std::endl;
+        releaseResources();
+        return false;
+    }
+
+    ioContext = avio_alloc_context(avioBuffer, ASYNC_WRITER_AVIO_BUFFER_SIZE, 1, this,
+                                   nullptr, &AsyncFileWriter::writePacket, &AsyncFileWriter::seekPacket);
+    if (!ioContext)
+    {
+        std::cerr << "后台写文件: 无法创建AVIOContext" << std::endl;
+        av_free(avioBuffer);
+        releaseResources();
+        return false;
+    }
+    ioContext->seekable = AVIO_SEEKABLE_NORMAL;
+
+    // 重置状态并启动写线程
+    currentBlock = -1;
+    inflightBlocks = 0;
+    position = 0;
+    logicalSize = 0;
+    stopping = false;
+    writeError = 0;
+    bytesWritten = 0;
+    writeCalls = 0;
+    directWrites = 0;
+    syncCalls = 0;
+    stallCount = 0;
+    stallMicros = 0;
+    bytesSinceSync = 0;
+    writerThread = std::thread(&AsyncFileWriter::writerThreadFunc, this);
+
+    std::cout << "后台写文件: 已打开 " << path << "，缓冲块 " << (this->options.blockSize / 1024) << "KB x "
+              << this->options.blockCount << (directFd >= 0 ? "，O_DIRECT" : "") << std::endl;
+    return true;
+}
+
+// AVIOContext写回调
+int AsyncFileWriter::writePacket(void *opaque, uint8_t *buf, int bufSize)
+{
+    return static_cast<AsyncFileWriter *>(opaque)->write(buf, bufSize);
+}
+
+// AVIOContext定位回调
+int64_t AsyncFileWriter::seekPacket(void *opaque, int64_t offset, int whence)
+{
+    return static_cast<AsyncFileWriter *>(opaque)->seek(offset, whence);
+}
+
+// 把数据拷进当前块，块写满后交给写线程（只在复用线程中调用）
+int AsyncFileWriter::write(const uint8_t *buf, int size)
+{
+    int error = writeError.load();
+    if (error < 0)
+    {
+        return error;
+    }
+
+    size_t remaining = size > 0 ? static_cast<size_t>(size) : 0;
+    while (remaining > 0)
+    {
+        if (currentBlock < 0 && !acquireBlock())
+        {
+            error = writeError.load();
+            return error < 0 ? error : AVERROR(EIO);
+        }
+
+        WriteBlock &block = blocks[currentBlock];
+        size_t count = options.blockSize - block.size;
+        if (count > remaining)
+        {
+            count = remaining;
+        }
+        memcpy(block.data + block.size, buf, count);
+        block.size += count;
+        buf += count;
+        remaining -= count;
+        position += static_cast<int64_t>(count);
+
+        if (block.size == options.blockSize)
+        {
+            submitCurrentBlock();
+        }
+    }
+
+    if (position > logicalSize)
+    {
+        logicalSize = position;
+    }
+    return size;
+}
+
+// 定位：提交当前块后改写位置，之后的数据进入从新位置开始的块
+int64_t AsyncFileWriter::seek(int64_t offset, int whence)
+{
+    if (whence & AVSEEK_SIZE)
+    {
+        return logicalSize;
+    }
+
+    int64_t target;
+    switch (whence & ~AVSEEK_FORCE)
+    {
+    case SEEK_SET:
+        target = offset;
+        break;
+    case SEEK_CUR:
+        target = position + offset;
+        break;
+    case SEEK_END:
+        target = logicalSize + offset;
+        break;
+    default:
+        return AVERROR(EINVAL);
+    }
+
+    if (target < 0)
+    {
+        return AVERROR(EINVAL);
+    }
+
+    if (target != position)
+    {
+        submitCurrentBlock();
+        position = target;
+    }
+    return target;
+}
+
+// 取一个空闲块作为当前块，所有块都在排队时等待写线程归还
+bool AsyncFileWriter::acquireBlock()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (freeBlocks.empty())
+    {
+        auto waitStart = std::chrono::steady_clock::now();
+        freeCond.wait(lock, [this]() { return !freeBlocks.empty() || writeError.load() < 0; });
+        stallCount++;
+        stallMicros += std::chrono::duration_cast<std::chrono::microseconds>(
+                           std::chrono::steady_clock::now() - waitStart)
+                           .count();
+    }
+
+    if (writeError.load() < 0)
+    {
+        return false;
+    }
+
+    currentBlock = freeBlocks.front();
+    freeBlocks.pop_front();
+    blocks[currentBlock].size = 0;
+    blocks[currentBlock].offset = position;
+    return true;
+}
+
+// 把当前块交给写线程，空块直接放回空闲列表
+void AsyncFileWriter::submitCurrentBlock()
+{
+    if (currentBlock < 0)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (blocks[currentBlock].size > 0)
+        {
+            pendingBlocks.push_back(currentBlock);
+        }
+        else
+        {
+            freeBlocks.push_back(currentBlock);
+        }
+    }
+    currentBlock = -1;
+    pendingCond.notify_one();
+}
+
+// 写线程：每次取出文件偏移连续的一组块合并写入，写完归还空闲列表
+void AsyncFileWriter::writerThreadFunc()
+{
+    std::vector<int> run;
+    run.reserve(ASYNC_WRITER_MAX_COALESCE);
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            pendingCond.wait(lock, [this]() { return !pendingBlocks.empty() || stopping; });
+            if (pendingBlocks.empty())
+            {
+                break;
+            }
+
+            run.clear();
+            run.push_back(pendingBlocks.front());
+            pendingBlocks.pop_front();
+            while (!pendingBlocks.empty() && run.size() < ASYNC_WRITER_MAX_COALESCE)
+            {
+                const WriteBlock &last = blocks[run.back()];
+                if (blocks[pendingBlocks.front()].offset != last.offset + static_cast<int64_t>(last.size))
+                {
+                    break;
+                }
+                run.push_back(pendingBlocks.front());
+                pendingBlocks.pop_front();
+            }
+            inflightBlocks += static_cast<int>(run.size());
+        }
+
+        // 出错后不再写入，只归还缓冲块，复用线程下一次写入时得到错误
+        if (writeError.load() >= 0)
+        {
+            writeBlocks(run);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (size_t i = 0; i < run.size(); i++)
+            {
+                freeBlocks.push_back(run[i]);
+            }
+            inflightBlocks -= static_cast<int>(run.size());
+        }
+        freeCond.notify_all();
+    }
+}
+
+// 写入一组偏移连续的块，偏移和长度都对齐时走O_DIRECT
+bool AsyncFileWriter::writeBlocks(const std::vector<int> &run)
+{
+    size_t total = 0;
+    bool aligned = directFd >= 0 && blocks[run.front()].offset % ASYNC_WRITER_ALIGN == 0;
+    for (size_t i = 0; i < run.size(); i++)
+    {
+        total += blocks[run[i]].size;
+        if (blocks[run[i]].size % ASYNC_WRITER_ALIGN != 0)
+        {
+            aligned = false;
+        }
+    }
+
+    bool success = false;
+    if (aligned)
+    {
+        success = writeFully(directFd, run, total);
+        if (success)
+        {
+            directWrites++;
+        }
+        else if (errno == EINVAL)
+        {
+            // 部分文件系统在打开时接受O_DIRECT、写入时才拒绝，此后全部走普通写入
+            std::cerr << "后台写文件: O_DIRECT写入被拒绝，改用普通写入" << std::endl;
+            ::close(directFd);
+            directFd = -1;
+            success = writeFully(fd, run, total);
+        }
+    }
+    else
+    {
+        success = writeFully(fd, run, total);
+    }
+
+    if (!success)
+    {
+        int error = errno;
+        std::cerr << "后台写文件: 写入失败，偏移 " << blocks[run.front()].offset << " (" << strerror(error) << ")" << std::endl;
+        writeError = AVERROR(error ? error : EIO);
+        return false;
+    }
+
+    bytesWritten += total;
+
+    // 按写入量定期同步
+    if (options.syncIntervalBytes > 0)
+    {
+        bytesSinceSync += static_cast<int64_t>(total);
+        if (bytesSinceSync >= options.syncIntervalBytes)
+        {
+            if (fdatasync(fd) == 0)
+            {
+                syncCalls++;
+            }
+            else
+            {
+                std::cerr << "后台写文件: fdatasync失败 (" << strerror(errno) << ")" << std::endl;
+            }
+            bytesSinceSync = 0;
+        }
+    }
+    return true;
+}
+
+// 用pwritev写完一组块，处理被信号打断和部分写入
+bool AsyncFileWriter::writeFully(int targetFd, const std::vector<int> &run, size_t total)
+{
+    struct iovec iov[ASYNC_WRITER_MAX_COALESCE];
+    int count = static_cast<int>(run.size());
+    for (int i = 0; i < count; i++)
+    {
+        iov[i].iov_base = blocks[run[i]].data;
+        iov[i].iov_len = blocks[run[i]].size;
+    }
+
+    int64_t offset = blocks[run.front()].offset;
+    size_t done = 0;
+    int first = 0;
+    while (done < total)
+    {
+        ssize_t written = pwritev(targetFd, iov + first, count - first, offset + static_cast<int64_t>(done));
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        if (written == 0)
+        {
+            errno = EIO;
+            return false;
+        }
+        writeCalls++;
+
+        // 跳过已写完的部分
+        done += static_cast<size_t>(written);
+        size_t consumed = static_cast<size_t>(written);
+        while (first < count && consumed >= iov[first].iov_len)
+        {
+            consumed -= iov[first].iov_len;
+            first++;
+        }
+        if (first < count && consumed > 0)
+        {
+            iov[first].iov_base = static_cast<unsigned char *>(iov[first].iov_base) + consumed;
+            iov[first].iov_len -= consumed;
+        }
+    }
+    return true;
+}
+
+// 交给复用器使用的AVIOContext
+AVIOContext *AsyncFileWriter::getIOContext() const
+{
+    return ioContext;
+}
+
+// 刷新AVIO缓冲并等待所有已提交的块写入文件（只在复用线程中调用）
+bool AsyncFileWriter::drain()
+{
+    if (!ioContext)
+    {
+        return false;
+    }
+
+    avio_flush(ioContext);
+    submitCurrentBlock();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    freeCond.wait(lock, [this]() { return pendingBlocks.empty() && inflightBlocks == 0; });
+    return writeError.load() >= 0;
+}
+
+// 写完所有数据，按策略同步并关闭文件
+bool AsyncFileWriter::close()
+{
+    if (!isOpen())
+    {
+        return true;
+    }
+
+    bool success = drain();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    pendingCond.notify_all();
+    if (writerThread.joinable())
+    {
+        writerThread.join();
+    }
+
+    if (options.syncOnClose && success)
+    {
+        if (fdatasync(fd) == 0)
+        {
+            syncCalls++;
+        }
+        else
+        {
+            std::cerr << "后台写文件: fdatasync失败 (" << strerror(errno) << ")" << std::endl;
+            success = false;
+        }
+    }
+
+    if (::close(fd) != 0)
+    {
+        std::cerr << "后台写文件: 关闭文件失败 (" << strerror(errno) << ")" << std::endl;
+        success = false;
+    }
+    fd = -1;
+
+    releaseResources();
+    return success;
+}
+
+// 释放文件描述符、写缓冲块和AVIOContext
+void AsyncFileWriter::releaseResources()
+{
+    if (writerThread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        pendingCond.notify_all();
+        writerThread.join();
+    }
+
+    if (directFd >= 0)
+    {
+        ::close(directFd);
+        directFd = -1;
+    }
+    if (fd >= 0)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+
+    for (size_t i = 0; i < blocks.size(); i++)
+    {
+        free(blocks[i].data);
+    }
+    blocks.clear();
+    freeBlocks.clear();
+    pendingBlocks.clear();
+    currentBlock = -1;
+
+    if (ioContext)
+    {
+        av_freep(&ioContext->buffer);
+        avio_context_free(&ioContext);
+    }
+}
+
+// 文件是否已打开
+bool AsyncFileWriter::isOpen() const
+{
+    return ioContext != nullptr;
+}
+
+// 获取已写入文件的字节数
+uint64_t AsyncFileWriter::getBytesWritten() const
+{
+    return bytesWritten.load();
+}
+
+// 获取写系统调用次数
+uint64_t AsyncFileWriter::getWriteCalls() const
+{
+    return writeCalls.load();
+}
+
+// 获取复用线程等待空闲缓冲块的次数
+uint64_t AsyncFileWriter::getStallCount() const
+{
+    return stallCount;
+}
+
+// 打印统计信息
+void AsyncFileWriter::printStats() const
+{
+    std::cout << "后台写文件: 共写入 " << (getBytesWritten() / (1024 * 1024)) << "MB，写系统调用 " << getWriteCalls()
+              << " 次 (O_DIRECT " << directWrites.load() << " 次)，fdatasync " << syncCalls.load()
+              << " 次，复用线程等待空闲缓冲 " << stallCount << " 次共 " << (stallMicros / 1000) << "ms" << std::endl;
+}
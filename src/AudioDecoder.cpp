@@ -16,7 +16,26 @@ AudioDecoder::AudioDecoder(AudioPacketQueue &packetQueue, AudioFrameQueue &decod
     : codecContext(nullptr),
       codec(nullptr),
       swrContext(nullptr),
+      resamplerInFormat(-1),
+      resamplerInRate(0),
+      resamplerInLayout(0),
+      convertedData(nullptr),
+      convertedCapacity(0),
       audioFifo(nullptr),
+      outputSampleRate(44100),
+      outputChannels(2),
+      outputChannelLayout(AV_CH_LAYOUT_STEREO),
+      outputSampleFormat(AV_SAMPLE_FMT_FLTP),
+      outputFrameSize(AUDIO_DECODER_DEFAULT_FRAME_SIZE),
+      nextFramePts(0),
+      rangeStartPts(AV_NOPTS_VALUE),
+      rangeEndPts(AV_NOPTS_VALUE),
+      rangeTimeBaseNum(0),
+      rangeTimeBaseDen(1),
+      rangeDiscardedSamples(0),
+      pcmSwrContext(nullptr),
+      pcmBuffer(nullptr),
+      pcmBufferSize(0),
       packetQueue(packetQueue),
       decodedFrameQueue(decodedFrameQueue),
       isRunning(false),
@@ -82,38 +101,9 @@ bool AudioDecoder::initDecoder(AVCodecParameters *codecPar)
         return false;
     }
 
-    // 初始化重采样上下文
-    swrContext = swr_alloc();
-    if (!swrContext)
-    {
-        std::cerr << "音频解码器: 无法分配重采样上下文" << std::endl;
-        closeDecoder();
-        return false;
-    }
-
-    // 设置输入格式
-    av_opt_set_int(swrContext, "in_channel_layout", codecContext->channel_layout, 0);
-    av_opt_set_int(swrContext, "in_sample_rate", codecContext->sample_rate, 0);
-    av_opt_set_sample_fmt(swrContext, "in_sample_fmt", codecContext->sample_fmt, 0);
-
-    // 设置输出格式 (固定为立体声, 44100Hz, S16格式)
-    av_opt_set_int(swrContext, "out_channel_layout", AV_CH_LAYOUT_STEREO, 0);
-    av_opt_set_int(swrContext, "out_sample_rate", 44100, 0);
-    av_opt_set_sample_fmt(swrContext, "out_sample_fmt", AV_SAMPLE_FMT_S16, 0);
-
-    // 初始化重采样上下文
-    if (swr_init(swrContext) < 0)
-    {
-        std::cerr << "音频解码器: 无法初始化重采样上下文" << std::endl;
-        closeDecoder();
-        return false;
-    }
-
-    // 创建音频FIFO
-    audioFifo = av_audio_fifo_alloc(AV_SAMPLE_FMT_S16, 2, 1);
-    if (!audioFifo)
+    // 创建输出帧累积器（重采样上下文在第一帧到达时按帧的实际格式创建）
+    if (!allocateAccumulator())
     {
-        std::cerr << "音频解码器: 无法创建音频FIFO" << std::endl;
         closeDecoder();
         return false;
     }
@@ -141,6 +131,23 @@ void AudioDecoder::closeDecoder()
         swr_free(&swrContext);
         swrContext = nullptr;
     }
+    resamplerInFormat = -1;
+
+    if (convertedData)
+    {
+        av_freep(&convertedData[0]);
+        av_freep(&convertedData);
+        convertedCapacity = 0;
+    }
+
+    if (pcmSwrContext)
+    {
+        swr_free(&pcmSwrContext);
+        pcmSwrContext = nullptr;
+    }
+
+    av_freep(&pcmBuffer);
+    pcmBufferSize = 0;
 
     if (codecContext)
     {
@@ -162,7 +169,15 @@ void AudioDecoder::start()
     isRunning = true;
     isPaused = false;
 
+    // 输出帧从时间戳0开始
+    nextFramePts = 0;
+    if (audioFifo)
+    {
+        av_audio_fifo_reset(audioFifo);
+    }
+
     // 创建解码线程
+    completion.reset();
     decodeThread = std::thread(&AudioDecoder::decodeThreadFunc, this);
 }
 
@@ -189,6 +204,18 @@ void AudioDecoder::pause(bool pause)
     isPaused = pause;
 }
 
+// 等待音频解码线程完成
+bool AudioDecoder::waitForCompletion(std::chrono::milliseconds timeout)
+{
+    return completion.waitFor(timeout);
+}
+
+// 音频解码线程是否已完成
+bool AudioDecoder::isCompleted() const
+{
+    return completion.isDone();
+}
+
 // 设置帧回调
 void AudioDecoder::setFrameCallback(AudioFrameCallback callback)
 {
@@ -277,17 +304,13 @@ bool AudioDecoder::isQueueEmpty() const
 // 解码线程函数
 void AudioDecoder::decodeThreadFunc()
 {
-    if (!codecContext || !swrContext || !audioFifo)
-    {
-        std::cerr << "音频解码线程: 解码器未正确初始化" << std::endl;
-        return;
-    }
+    // 线程函数退出时（包括提前返回）发布完成信号
+    CompletionGuard completionGuard(completion);
 
-    // 分配AVPacket
-    AVPacket *packet = av_packet_alloc();
-    if (!packet)
+    if (!codecContext || !audioFifo)
     {
-        std::cerr << "音频解码线程: 无法分配AVPacket" << std::endl;
+        std::cerr << "音频解码线程: 解码器未正确初始化" << std::endl;
+        decodedFrameQueue.close();
         return;
     }
 
@@ -296,15 +319,10 @@ void AudioDecoder::decodeThreadFunc()
     if (!frame)
     {
         std::cerr << "音频解码线程: 无法分配AVFrame" << std::endl;
-        av_packet_free(&packet);
+        decodedFrameQueue.close();
         return;
     }
 
-    // 分配重采样输出缓冲区
-    uint8_t **resampledData = nullptr;
-    int resampledLinesize;
-    int resampledBufferSize = 0;
-
     std::cout << "音频解码线程: 开始" << std::endl;
 
     // 创建直接PCM输出文件（如果需要）
@@ -339,25 +357,28 @@ void AudioDecoder::decodeThreadFunc()
             continue;
         }
 
-        // 从队列中获取数据包
-        void *packetData = nullptr;
-        if (!packetQueue.tryPop(packetData))
+        // 从队列中获取数据包，队列为空时阻塞等待，数据到达即被唤醒
+        AVPacketPtr pkt;
+        if (!packetQueue.popFor(pkt, std::chrono::milliseconds(100)))
         {
-            // 队列为空，等待一段时间
+            // 上游已关闭且没有剩余数据，说明不会再有EOF标记包
+            if (packetQueue.isDrained())
+            {
+                std::cout << "音频解码线程: 输入队列已关闭，结束解码" << std::endl;
+                break;
+            }
+
             emptyPacketCount++;
             if (emptyPacketCount % 20 == 0)
             {
                 std::cout << "音频解码线程: 队列持续为空 " << emptyPacketCount / 10 << " 秒" << std::endl;
             }
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
             continue;
         }
 
         // 重置空队列计数
         emptyPacketCount = 0;
 
-        // 转换为AVPacket
-        AVPacket *pkt = static_cast<AVPacket *>(packetData);
         packetCount++;
 
         // 检查是否为EOF标志包
@@ -386,81 +407,15 @@ void AudioDecoder::decodeThreadFunc()
 
                 frameDecoded++;
 
-                // 计算重采样后的样本数
-                int outSamples = av_rescale_rnd(
-                    swr_get_delay(swrContext, codecContext->sample_rate) + frame->nb_samples,
-                    44100,
-                    codecContext->sample_rate,
-                    AV_ROUND_UP);
-
-                // 确保重采样缓冲区足够大
-                if (outSamples > resampledBufferSize)
-                {
-                    if (resampledData)
-                    {
-                        av_freep(&resampledData[0]);
-                    }
-                    av_freep(&resampledData);
-
-                    // 分配新的缓冲区
-                    int ret = av_samples_alloc_array_and_samples(
-                        &resampledData,
-                        &resampledLinesize,
-                        2, // 立体声
-                        outSamples,
-                        AV_SAMPLE_FMT_S16,
-                        0);
-
-                    if (ret < 0)
-                    {
-                        std::cerr << "音频解码线程: 无法分配重采样缓冲区" << std::endl;
-                        break;
-                    }
-
-                    resampledBufferSize = outSamples;
-                }
-
-                // 执行重采样
-                int samplesOut = swr_convert(
-                    swrContext,
-                    resampledData,
-                    outSamples,
-                    (const uint8_t **)frame->data,
-                    frame->nb_samples);
-
-                if (samplesOut < 0)
+                // 转换为输出格式并放入累积器
+                if (!processDecodedFrame(frame, directPcmFile))
                 {
-                    std::cerr << "音频解码线程: 重采样失败" << std::endl;
                     break;
                 }
-
-                // 计算输出数据大小
-                int dataSize = samplesOut * 2 * 2; // 2通道，2字节每样本
-
-                // 保存到PCM文件
-                if (saveToPCM)
-                {
-                    savePCMData(resampledData[0], dataSize);
-                }
-
-                // 保存到直接PCM输出文件
-                if (directPcmFile)
-                {
-                    writePCMToFile(resampledData[0], dataSize, directPcmFile);
-                }
-
-                // 调用回调函数
-                if (frameCallback)
-                {
-                    frameCallback(resampledData[0], dataSize, 44100, 2);
-                }
-
-                // 处理音频帧，将其添加到缓冲区
-                processAudioSamples(resampledData[0], samplesOut, frame->pts);
             }
 
             // 释放数据包
-            av_packet_free(&pkt);
+            pkt.reset();
 
             std::cout << "音频解码线程: 刷新完成，准备退出" << std::endl;
             break; // 文件结束，退出解码循环
@@ -477,10 +432,10 @@ void AudioDecoder::decodeThreadFunc()
         }
 
         // 发送数据包到解码器
-        int ret = avcodec_send_packet(codecContext, pkt);
+        int ret = avcodec_send_packet(codecContext, pkt.get());
 
         // 释放数据包
-        av_packet_free(&pkt);
+        pkt.reset();
 
         if (ret < 0)
         {
@@ -511,77 +466,11 @@ void AudioDecoder::decodeThreadFunc()
             frameReceived = true;
             frameDecoded++;
 
-            // 计算重采样后的样本数
-            int outSamples = av_rescale_rnd(
-                swr_get_delay(swrContext, codecContext->sample_rate) + frame->nb_samples,
-                44100,
-                codecContext->sample_rate,
-                AV_ROUND_UP);
-
-            // 确保重采样缓冲区足够大
-            if (outSamples > resampledBufferSize)
+            // 转换为输出格式并放入累积器
+            if (!processDecodedFrame(frame, directPcmFile))
             {
-                if (resampledData)
-                {
-                    av_freep(&resampledData[0]);
-                }
-                av_freep(&resampledData);
-
-                // 分配新的缓冲区
-                int ret = av_samples_alloc_array_and_samples(
-                    &resampledData,
-                    &resampledLinesize,
-                    2, // 立体声
-                    outSamples,
-                    AV_SAMPLE_FMT_S16,
-                    0);
-
-                if (ret < 0)
-                {
-                    std::cerr << "音频解码线程: 无法分配重采样缓冲区" << std::endl;
-                    break;
-                }
-
-                resampledBufferSize = outSamples;
-            }
-
-            // 执行重采样
-            int samplesOut = swr_convert(
-                swrContext,
-                resampledData,
-                outSamples,
-                (const uint8_t **)frame->data,
-                frame->nb_samples);
-
-            if (samplesOut < 0)
-            {
-                std::cerr << "音频解码线程: 重采样失败" << std::endl;
                 break;
             }
-
-            // 计算输出数据大小
-            int dataSize = samplesOut * 2 * 2; // 2通道，2字节每样本
-
-            // 保存到PCM文件
-            if (saveToPCM)
-            {
-                savePCMData(resampledData[0], dataSize);
-            }
-
-            // 保存到直接PCM输出文件
-            if (directPcmFile)
-            {
-                writePCMToFile(resampledData[0], dataSize, directPcmFile);
-            }
-
-            // 调用回调函数
-            if (frameCallback)
-            {
-                frameCallback(resampledData[0], dataSize, 44100, 2);
-            }
-
-            // 处理音频帧，将其添加到缓冲区
-            processAudioSamples(resampledData[0], samplesOut, frame->pts);
         }
 
         // 如果没有收到帧但解码了很多包，可能是解码过程有问题
@@ -592,6 +481,9 @@ void AudioDecoder::decodeThreadFunc()
         }
     }
 
+    // 取出重采样器中缓存的尾部样本
+    flushResampler(directPcmFile);
+
     // 关闭直接PCM输出文件
     if (directPcmFile)
     {
@@ -599,22 +491,25 @@ void AudioDecoder::decodeThreadFunc()
         std::cout << "音频解码线程: 已关闭直接PCM输出文件: " << directPcmOutput << std::endl;
     }
 
-    // 释放重采样缓冲区
-    if (resampledData)
-    {
-        av_freep(&resampledData[0]);
-        av_freep(&resampledData);
-    }
+    // 累积器中不足一帧的剩余样本作为最后一帧输出
+    flushAudioSamples();
+
+    // 不会再产出新帧，关闭帧队列唤醒下游
+    decodedFrameQueue.close();
 
     // 清理
     av_frame_free(&frame);
-    av_packet_free(&packet);
 
     auto endTime = std::chrono::high_resolution_clock::now();
     double totalSeconds = std::chrono::duration<double>(endTime - startTime).count();
     std::cout << "音频解码线程: 结束，总共解码 " << frameDecoded << " 帧，耗时 "
               << totalSeconds << " 秒";
 
+    if (rangeDiscardedSamples > 0)
+    {
+        std::cout << "，丢弃时间段之外的 " << rangeDiscardedSamples << " 个样本";
+    }
+
     if (receivedEOF)
     {
         std::cout << "，正常收到EOF标记";
@@ -652,79 +547,509 @@ void AudioDecoder::writePCMToFile(const uint8_t *data, int size, FILE *file)
 // 获取解码后的帧
 AVFrame *AudioDecoder::getFrame()
 {
-    void *framePtr = nullptr;
-    if (decodedFrameQueue.tryPop(framePtr))
+    // 所有权交给调用者，由调用者负责释放
+    AVFramePtr frame;
+    if (decodedFrameQueue.tryPop(frame))
     {
-        return static_cast<AVFrame *>(framePtr);
+        return frame.release();
     }
     return nullptr;
 }
 
-// 处理音频样本，将其添加到缓冲区并创建符合AC3要求的帧
-void AudioDecoder::processAudioSamples(const uint8_t *data, int samplesCount, int64_t pts)
+// 设置输出格式
+bool AudioDecoder::setOutputFormat(int sampleRate, uint64_t channelLayout, int sampleFormat)
+{
+    if (isRunning)
+    {
+        std::cerr << "音频解码器: 不能在解码线程运行时设置输出格式" << std::endl;
+        return false;
+    }
+
+    int channels = av_get_channel_layout_nb_channels(channelLayout);
+    if (sampleRate <= 0 || channels <= 0 || !av_get_sample_fmt_name((AVSampleFormat)sampleFormat))
+    {
+        std::cerr << "音频解码器: 无效的输出格式 - 采样率: " << sampleRate
+                  << ", 通道数: " << channels << ", 采样格式: " << sampleFormat << std::endl;
+        return false;
+    }
+
+    outputSampleRate = sampleRate;
+    outputChannels = channels;
+    outputChannelLayout = channelLayout;
+    outputSampleFormat = sampleFormat;
+
+    // 输出格式变化后重采样器、输出缓冲区和累积器都要按新格式重建
+    if (swrContext)
+    {
+        swr_free(&swrContext);
+        swrContext = nullptr;
+    }
+    resamplerInFormat = -1;
+    if (convertedData)
+    {
+        av_freep(&convertedData[0]);
+        av_freep(&convertedData);
+        convertedCapacity = 0;
+    }
+    if (pcmSwrContext)
+    {
+        swr_free(&pcmSwrContext);
+        pcmSwrContext = nullptr;
+    }
+    if (codecContext && !allocateAccumulator())
+    {
+        return false;
+    }
+
+    bool passthrough = codecContext &&
+                       codecContext->sample_fmt == sampleFormat &&
+                       codecContext->sample_rate == sampleRate &&
+                       codecContext->channels == channels;
+    std::cout << "音频解码器: 输出格式 " << sampleRate << " Hz, " << channels << " 通道, "
+              << av_get_sample_fmt_name((AVSampleFormat)sampleFormat)
+              << (passthrough ? "（与解码输出一致，无需转换）" : "（每帧重采样一次）") << std::endl;
+    return true;
+}
+
+// 设置输出帧的样本数
+bool AudioDecoder::setOutputFrameSize(int frameSize)
+{
+    if (isRunning)
+    {
+        std::cerr << "音频解码器: 不能在解码线程运行时设置输出帧大小" << std::endl;
+        return false;
+    }
+
+    if (frameSize <= 0)
+    {
+        std::cerr << "音频解码器: 无效的输出帧大小: " << frameSize << std::endl;
+        return false;
+    }
+
+    outputFrameSize = frameSize;
+    std::cout << "音频解码器: 输出帧大小设置为 " << outputFrameSize << " 个样本" << std::endl;
+    return true;
+}
+
+// 获取输出帧的样本数
+int AudioDecoder::getOutputFrameSize() const
+{
+    return outputFrameSize;
+}
+
+// 设置时间段
+bool AudioDecoder::setTimeRange(int64_t startPts, int64_t endPts, int timeBaseNum, int timeBaseDen)
 {
-    // AC3编码器要求每个帧的样本数为1536
-    static const int AC3_FRAME_SIZE = 1536;
-    static std::vector<float> leftChannel;
-    static std::vector<float> rightChannel;
-    static int64_t lastPts = 0;
+    if (isRunning)
+    {
+        std::cerr << "音频解码器: 不能在解码线程运行时设置时间段" << std::endl;
+        return false;
+    }
 
-    if (pts > 0)
+    if (timeBaseNum <= 0 || timeBaseDen <= 0)
     {
-        lastPts = pts;
+        std::cerr << "音频解码器: 无效的时间基: " << timeBaseNum << "/" << timeBaseDen << std::endl;
+        return false;
     }
 
-    // 将当前帧的样本添加到缓冲区
-    for (int i = 0; i < samplesCount; i++)
+    rangeStartPts = startPts;
+    rangeEndPts = endPts;
+    rangeTimeBaseNum = timeBaseNum;
+    rangeTimeBaseDen = timeBaseDen;
+    return true;
+}
+
+// 获取输出格式
+int AudioDecoder::getOutputSampleRate() const
+{
+    return outputSampleRate;
+}
+
+int AudioDecoder::getOutputChannels() const
+{
+    return outputChannels;
+}
+
+uint64_t AudioDecoder::getOutputChannelLayout() const
+{
+    return outputChannelLayout;
+}
+
+int AudioDecoder::getOutputSampleFormat() const
+{
+    return outputSampleFormat;
+}
+
+// 按输出格式（重新）创建输出帧累积器
+bool AudioDecoder::allocateAccumulator()
+{
+    if (audioFifo)
     {
-        int16_t *src = (int16_t *)data;
-        leftChannel.push_back(src[i * 2] / 32768.0f);
-        rightChannel.push_back(src[i * 2 + 1] / 32768.0f);
+        av_audio_fifo_free(audioFifo);
+        audioFifo = nullptr;
     }
 
-    // 当缓冲区中的样本数达到或超过AC3_FRAME_SIZE时，创建帧并放入队列
-    while (leftChannel.size() >= AC3_FRAME_SIZE)
+    audioFifo = av_audio_fifo_alloc((AVSampleFormat)outputSampleFormat, outputChannels, outputFrameSize);
+    if (!audioFifo)
     {
-        AVFrame *outputFrame = av_frame_alloc();
-        if (outputFrame)
+        std::cerr << "音频解码器: 无法创建音频FIFO" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// 按解码帧的实际格式配置重采样器；与输出格式一致时释放重采样器，直接使用解码帧
+bool AudioDecoder::configureResampler(int inFormat, int inRate, uint64_t inLayout)
+{
+    if (inFormat == resamplerInFormat && inRate == resamplerInRate && inLayout == resamplerInLayout)
+    {
+        return true;
+    }
+
+    if (swrContext)
+    {
+        swr_free(&swrContext);
+        swrContext = nullptr;
+    }
+    resamplerInFormat = inFormat;
+    resamplerInRate = inRate;
+    resamplerInLayout = inLayout;
+
+    if (inFormat == outputSampleFormat && inRate == outputSampleRate && inLayout == outputChannelLayout)
+    {
+        std::cout << "音频解码线程: 解码输出与目标格式一致，跳过重采样" << std::endl;
+        return true;
+    }
+
+    swrContext = swr_alloc_set_opts(nullptr,
+                                    outputChannelLayout, (AVSampleFormat)outputSampleFormat, outputSampleRate,
+                                    inLayout, (AVSampleFormat)inFormat, inRate,
+                                    0, nullptr);
+    if (!swrContext || swr_init(swrContext) < 0)
+    {
+        std::cerr << "音频解码线程: 无法初始化重采样上下文" << std::endl;
+        swr_free(&swrContext);
+        swrContext = nullptr;
+        resamplerInFormat = -1;
+        return false;
+    }
+
+    std::cout << "音频解码线程: 重采样 " << inRate << " Hz "
+              << av_get_sample_fmt_name((AVSampleFormat)inFormat) << " -> "
+              << outputSampleRate << " Hz "
+              << av_get_sample_fmt_name((AVSampleFormat)outputSampleFormat) << std::endl;
+    return true;
+}
+
+// 确保重采样输出缓冲区至少能容纳samplesCount个样本
+bool AudioDecoder::ensureConvertedCapacity(int samplesCount)
+{
+    if (samplesCount <= convertedCapacity)
+    {
+        return true;
+    }
+
+    if (convertedData)
+    {
+        av_freep(&convertedData[0]);
+        av_freep(&convertedData);
+    }
+    convertedCapacity = 0;
+
+    int linesize;
+    if (av_samples_alloc_array_and_samples(&convertedData, &linesize, outputChannels, samplesCount,
+                                           (AVSampleFormat)outputSampleFormat, 0) < 0)
+    {
+        std::cerr << "音频解码线程: 无法分配重采样缓冲区" << std::endl;
+        convertedData = nullptr;
+        return false;
+    }
+
+    convertedCapacity = samplesCount;
+    return true;
+}
+
+// 计算帧在时间段内的部分：跳过起点之前的skipSamples个样本，之后保留keepSamples个；整帧都在范围外时返回false
+bool AudioDecoder::clipFrameToRange(const AVFrame *frame, int &skipSamples, int &keepSamples)
+{
+    skipSamples = 0;
+    keepSamples = frame->nb_samples;
+
+    int64_t pts = frame->best_effort_timestamp != AV_NOPTS_VALUE ? frame->best_effort_timestamp : frame->pts;
+    if (pts == AV_NOPTS_VALUE || frame->sample_rate <= 0 ||
+        (rangeStartPts == AV_NOPTS_VALUE && rangeEndPts == AV_NOPTS_VALUE))
+    {
+        return true;
+    }
+
+    AVRational timeBase = {rangeTimeBaseNum, rangeTimeBaseDen};
+    AVRational sampleBase = {1, frame->sample_rate};
+    if (rangeStartPts != AV_NOPTS_VALUE && pts < rangeStartPts)
+    {
+        int64_t skip = av_rescale_q(rangeStartPts - pts, timeBase, sampleBase);
+        skipSamples = static_cast<int>(FFMIN(skip, static_cast<int64_t>(frame->nb_samples)));
+    }
+    if (rangeEndPts != AV_NOPTS_VALUE)
+    {
+        int64_t keep = pts < rangeEndPts ? av_rescale_q(rangeEndPts - pts, timeBase, sampleBase) : 0;
+        keepSamples = static_cast<int>(FFMIN(keep, static_cast<int64_t>(frame->nb_samples)));
+    }
+
+    rangeDiscardedSamples += frame->nb_samples - FFMAX(keepSamples - skipSamples, 0);
+    return keepSamples > skipSamples;
+}
+
+// 处理一个解码帧：需要时重采样一次到输出格式，然后写入PCM输出、回调和累积器
+bool AudioDecoder::processDecodedFrame(AVFrame *frame, FILE *directPcmFile)
+{
+    // 按时间段裁剪：定位落在起点之前，跨越起点/终点的帧只取范围内的样本
+    int skipSamples = 0;
+    int keepSamples = frame->nb_samples;
+    if (!clipFrameToRange(frame, skipSamples, keepSamples))
+    {
+        return true;
+    }
+
+    const uint8_t **inputData = const_cast<const uint8_t **>(frame->extended_data);
+    int inputSamples = keepSamples - skipSamples;
+    std::vector<const uint8_t *> clippedPlanes;
+    if (skipSamples > 0)
+    {
+        AVSampleFormat format = static_cast<AVSampleFormat>(frame->format);
+        bool planar = av_sample_fmt_is_planar(format) != 0;
+        int planes = planar ? frame->channels : 1;
+        int offset = skipSamples * av_get_bytes_per_sample(format) * (planar ? 1 : frame->channels);
+        clippedPlanes.resize(planes);
+        for (int i = 0; i < planes; i++)
         {
-            // 使用FLTP格式，与AC3编码器期望的格式匹配
-            outputFrame->format = AV_SAMPLE_FMT_FLTP;
-            outputFrame->channel_layout = av_get_default_channel_layout(2); // 立体声
-            outputFrame->sample_rate = 44100;
-            outputFrame->nb_samples = AC3_FRAME_SIZE;
-
-            int ret = av_frame_get_buffer(outputFrame, 0);
-            if (ret >= 0)
-            {
-                // 复制缓冲区中的样本到输出帧
-                float *leftDst = (float *)outputFrame->data[0];
-                float *rightDst = (float *)outputFrame->data[1];
+            clippedPlanes[i] = frame->extended_data[i] + offset;
+        }
+        inputData = clippedPlanes.data();
+    }
 
-                for (int i = 0; i < AC3_FRAME_SIZE; i++)
-                {
-                    leftDst[i] = leftChannel[i];
-                    rightDst[i] = rightChannel[i];
-                }
+    uint64_t inLayout = frame->channel_layout ? frame->channel_layout
+                                              : av_get_default_channel_layout(frame->channels);
+    if (!configureResampler(frame->format, frame->sample_rate, inLayout))
+    {
+        return false;
+    }
+
+    const uint8_t **samples = nullptr;
+    int samplesCount = 0;
+
+    if (!swrContext)
+    {
+        // 与输出格式一致，直接使用解码帧的数据
+        samples = inputData;
+        samplesCount = inputSamples;
+    }
+    else
+    {
+        // 计算重采样后的样本数
+        int outSamples = av_rescale_rnd(
+            swr_get_delay(swrContext, frame->sample_rate) + inputSamples,
+            outputSampleRate,
+            frame->sample_rate,
+            AV_ROUND_UP);
+
+        if (!ensureConvertedCapacity(outSamples))
+        {
+            return false;
+        }
+
+        samplesCount = swr_convert(
+            swrContext,
+            convertedData,
+            outSamples,
+            inputData,
+            inputSamples);
+        if (samplesCount < 0)
+        {
+            std::cerr << "音频解码线程: 重采样失败" << std::endl;
+            return false;
+        }
+        samples = const_cast<const uint8_t **>(convertedData);
+    }
 
-                // 从缓冲区中移除已使用的样本
-                leftChannel.erase(leftChannel.begin(), leftChannel.begin() + AC3_FRAME_SIZE);
-                rightChannel.erase(rightChannel.begin(), rightChannel.begin() + AC3_FRAME_SIZE);
+    if (samplesCount > 0)
+    {
+        writePCMOutputs(samples, samplesCount, directPcmFile);
 
-                // 设置帧的时间戳
-                // 这里简化处理，实际应该根据样本数和采样率计算正确的时间戳
-                static int64_t framePts = 0;
-                outputFrame->pts = framePts;
-                framePts += AC3_FRAME_SIZE;
+        // 调用回调函数
+        if (frameCallback)
+        {
+            int dataSize = av_samples_get_buffer_size(nullptr, outputChannels, samplesCount,
+                                                      (AVSampleFormat)outputSampleFormat, 1);
+            frameCallback(samples[0], dataSize, outputSampleRate, outputChannels);
+        }
 
-                // 放入队列
-                decodedFrameQueue.push(outputFrame);
+        // 放入累积器，凑满一帧即输出
+        processAudioSamples(samples, samplesCount);
+    }
+    return true;
+}
+
+// 取出重采样器内部缓存的尾部样本
+void AudioDecoder::flushResampler(FILE *directPcmFile)
+{
+    if (!swrContext)
+    {
+        return;
+    }
+
+    int pending = av_rescale_rnd(swr_get_delay(swrContext, resamplerInRate), outputSampleRate,
+                                 resamplerInRate, AV_ROUND_UP);
+    if (pending <= 0 || !ensureConvertedCapacity(pending))
+    {
+        return;
+    }
+
+    int samplesCount = swr_convert(swrContext, convertedData, pending, nullptr, 0);
+    if (samplesCount > 0)
+    {
+        const uint8_t **samples = const_cast<const uint8_t **>(convertedData);
+        writePCMOutputs(samples, samplesCount, directPcmFile);
+        processAudioSamples(samples, samplesCount);
+    }
+}
+
+// 写入PCM文件输出（S16交错格式，采样率和通道数与输出格式相同）
+void AudioDecoder::writePCMOutputs(const uint8_t **samples, int samplesCount, FILE *directPcmFile)
+{
+    if (!saveToPCM && !directPcmFile)
+    {
+        return;
+    }
+
+    const uint8_t *pcmData = samples[0];
+    int pcmSize = samplesCount * outputChannels * 2; // 2字节每样本
+
+    if (outputSampleFormat != AV_SAMPLE_FMT_S16)
+    {
+        // 只转换采样格式，不改变采样率和通道布局
+        if (!pcmSwrContext)
+        {
+            pcmSwrContext = swr_alloc_set_opts(nullptr,
+                                               outputChannelLayout, AV_SAMPLE_FMT_S16, outputSampleRate,
+                                               outputChannelLayout, (AVSampleFormat)outputSampleFormat, outputSampleRate,
+                                               0, nullptr);
+            if (!pcmSwrContext || swr_init(pcmSwrContext) < 0)
+            {
+                std::cerr << "音频解码线程: 无法初始化PCM输出的格式转换" << std::endl;
+                swr_free(&pcmSwrContext);
+                pcmSwrContext = nullptr;
+                return;
             }
-            else
+        }
+
+        if (pcmBufferSize < pcmSize)
+        {
+            av_freep(&pcmBuffer);
+            pcmBufferSize = 0;
+            pcmBuffer = static_cast<uint8_t *>(av_malloc(pcmSize));
+            if (!pcmBuffer)
             {
-                av_frame_free(&outputFrame);
-                std::cerr << "音频解码线程: 无法为输出帧分配缓冲区" << std::endl;
+                std::cerr << "音频解码线程: 无法分配PCM输出缓冲区" << std::endl;
+                return;
             }
+            pcmBufferSize = pcmSize;
+        }
+        uint8_t *pcmOut = pcmBuffer;
+        int converted = swr_convert(pcmSwrContext, &pcmOut, samplesCount, samples, samplesCount);
+        if (converted <= 0)
+        {
+            return;
         }
+        pcmData = pcmBuffer;
+        pcmSize = converted * outputChannels * 2;
+    }
+
+    // 保存到PCM文件
+    if (saveToPCM)
+    {
+        savePCMData(pcmData, pcmSize);
+    }
+
+    // 保存到直接PCM输出文件
+    if (directPcmFile)
+    {
+        writePCMToFile(pcmData, pcmSize, directPcmFile);
+    }
+}
+
+// 把输出格式的样本放入累积器，每凑满outputFrameSize个样本输出一帧
+void AudioDecoder::processAudioSamples(const uint8_t **samples, int samplesCount)
+{
+    if (!samples || samplesCount <= 0)
+    {
+        return;
+    }
+
+    if (av_audio_fifo_write(audioFifo, reinterpret_cast<void **>(const_cast<uint8_t **>(samples)), samplesCount) < samplesCount)
+    {
+        std::cerr << "音频解码线程: 写入音频累积器失败" << std::endl;
+        return;
+    }
+
+    while (av_audio_fifo_size(audioFifo) >= outputFrameSize)
+    {
+        if (!emitAudioFrame(outputFrameSize))
+        {
+            break;
+        }
+    }
+}
+
+// 从累积器取出samplesCount个样本组成一帧放入队列
+bool AudioDecoder::emitAudioFrame(int samplesCount)
+{
+    AVFramePtr outputFrame = allocFrame();
+    if (!outputFrame)
+    {
+        std::cerr << "音频解码线程: 无法分配输出帧" << std::endl;
+        return false;
+    }
+
+    // 输出格式即编码器期望的格式
+    outputFrame->format = outputSampleFormat;
+    outputFrame->channel_layout = outputChannelLayout;
+    outputFrame->channels = outputChannels;
+    outputFrame->sample_rate = outputSampleRate;
+    outputFrame->nb_samples = samplesCount;
+
+    if (av_frame_get_buffer(outputFrame.get(), 0) < 0)
+    {
+        std::cerr << "音频解码线程: 无法为输出帧分配缓冲区" << std::endl;
+        return false;
+    }
+
+    // 通道数超过AV_NUM_DATA_POINTERS时平面指针只在extended_data中
+    if (av_audio_fifo_read(audioFifo, reinterpret_cast<void **>(outputFrame->extended_data), samplesCount) < samplesCount)
+    {
+        std::cerr << "音频解码线程: 从音频累积器读取样本失败" << std::endl;
+        return false;
+    }
+
+    // 时间戳按已输出的样本数连续递增
+    outputFrame->pts = nextFramePts;
+    nextFramePts += samplesCount;
+
+    // 移入队列，队列关闭时由句柄自动释放
+    return decodedFrameQueue.push(std::move(outputFrame));
+}
+
+// 输出累积器中剩余的样本（不足一帧）
+void AudioDecoder::flushAudioSamples()
+{
+    if (!audioFifo)
+    {
+        return;
+    }
+
+    int remaining = av_audio_fifo_size(audioFifo);
+    if (remaining > 0)
+    {
+        std::cout << "音频解码线程: 输出剩余的 " << remaining << " 个样本" << std::endl;
+        emitAudioFrame(remaining);
     }
 }
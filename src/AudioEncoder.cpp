@@ -1,5 +1,7 @@
 #include "../include/AudioEncoder.h"
 #include <iostream>
+#include <cstdlib>
+#include <algorithm>
 
 // 引入FFmpeg头文件
 extern "C"
@@ -10,7 +12,6 @@ extern "C"
 #include "ffmpeg/include_ffmpeg/libavutil/samplefmt.h"
 #include "ffmpeg/include_ffmpeg/libavutil/frame.h"
 #include "ffmpeg/include_ffmpeg/libavutil/error.h"
-#include "ffmpeg/include_ffmpeg/libswresample/swresample.h"
 #include "ffmpeg/include_ffmpeg/libavutil/audio_fifo.h"
 }
 
@@ -18,7 +19,6 @@ extern "C"
 AudioEncoder::AudioEncoder(AudioFrameQueue &frameQueue, AudioPacketQueue &packetQueue)
     : codecContext(nullptr),
       codec(nullptr),
-      swrContext(nullptr),
       frameQueue(frameQueue),
       packetQueue(packetQueue),
       isRunning(false),
@@ -32,7 +32,11 @@ AudioEncoder::AudioEncoder(AudioFrameQueue &frameQueue, AudioPacketQueue &packet
       codecName(""),
       useFilter(false),
       audioFilter(nullptr),
-      nextPts(0)
+      nextPts(0),
+      ptsInitialized(false),
+      sampleFifo(nullptr),
+      fifoFrame(nullptr),
+      filteredFrame(nullptr)
 {
     std::cout << "音频编码器: 创建实例" << std::endl;
 }
@@ -61,6 +65,47 @@ bool AudioEncoder::init(int sampleRate, int channels, uint64_t channelLayout, in
     return initEncoder();
 }
 
+// 选择编码器支持的采样格式，preferred不受支持时使用编码器列出的第一个格式
+static AVSampleFormat selectSampleFormat(const AVCodec *codec, AVSampleFormat preferred)
+{
+    if (!codec->sample_fmts)
+    {
+        return preferred;
+    }
+
+    for (const AVSampleFormat *fmt = codec->sample_fmts; *fmt != AV_SAMPLE_FMT_NONE; fmt++)
+    {
+        if (*fmt == preferred)
+        {
+            return preferred;
+        }
+    }
+    return codec->sample_fmts[0];
+}
+
+// 选择编码器支持的采样率，requested不受支持时使用最接近的采样率
+static int selectSampleRate(const AVCodec *codec, int requested)
+{
+    if (!codec->supported_samplerates)
+    {
+        return requested;
+    }
+
+    int best = 0;
+    for (const int *rate = codec->supported_samplerates; *rate != 0; rate++)
+    {
+        if (*rate == requested)
+        {
+            return requested;
+        }
+        if (best == 0 || std::abs(*rate - requested) < std::abs(best - requested))
+        {
+            best = *rate;
+        }
+    }
+    return best;
+}
+
 // 内部初始化编码器方法
 bool AudioEncoder::initEncoder()
 {
@@ -129,8 +174,19 @@ bool AudioEncoder::initEncoder()
         return false;
     }
 
+    // 协商采样格式和采样率：优先使用请求的参数，编码器不支持时选择它支持的格式，
+    // 上游解码器据此直接输出编码器需要的格式，音频链路上最多只转换一次
+    AVSampleFormat sampleFormat = selectSampleFormat(codec, AV_SAMPLE_FMT_FLTP);
+    int negotiatedRate = selectSampleRate(codec, sampleRate);
+    if (negotiatedRate != sampleRate)
+    {
+        std::cout << "音频编码器: " << codec->name << " 不支持 " << sampleRate
+                  << " Hz，改用 " << negotiatedRate << " Hz" << std::endl;
+        sampleRate = negotiatedRate;
+    }
+
     // 设置编码器参数
-    codecContext->sample_fmt = AV_SAMPLE_FMT_FLTP; // AC3需要浮点平面格式
+    codecContext->sample_fmt = sampleFormat;
     codecContext->sample_rate = sampleRate;
     codecContext->channels = channels;
     codecContext->channel_layout = channelLayout;
@@ -148,20 +204,41 @@ bool AudioEncoder::initEncoder()
         return false;
     }
 
-    // 初始化重采样上下文
-    swrContext = swr_alloc();
-    if (!swrContext)
+    // 固定帧大小的编码器：创建样本FIFO和复用的编码帧，把任意长度的输入帧切成frame_size
+    if (codecContext->frame_size > 0 && !(codec->capabilities & AV_CODEC_CAP_VARIABLE_FRAME_SIZE))
+    {
+        sampleFifo = av_audio_fifo_alloc(codecContext->sample_fmt, codecContext->channels,
+                                         codecContext->frame_size * 2);
+        fifoFrame = av_frame_alloc();
+        if (!sampleFifo || !fifoFrame)
+        {
+            std::cerr << "音频编码器: 无法创建样本FIFO" << std::endl;
+            closeEncoder();
+            return false;
+        }
+
+        fifoFrame->format = codecContext->sample_fmt;
+        fifoFrame->channel_layout = codecContext->channel_layout;
+        fifoFrame->channels = codecContext->channels;
+        fifoFrame->sample_rate = codecContext->sample_rate;
+        fifoFrame->nb_samples = codecContext->frame_size;
+        if (av_frame_get_buffer(fifoFrame, 0) < 0)
+        {
+            std::cerr << "音频编码器: 无法为编码帧分配缓冲区" << std::endl;
+            closeEncoder();
+            return false;
+        }
+    }
+
+    // 滤镜输出帧
+    filteredFrame = av_frame_alloc();
+    if (!filteredFrame)
     {
-        std::cerr << "音频编码器: 无法分配重采样上下文" << std::endl;
+        std::cerr << "音频编码器: 无法分配滤镜帧" << std::endl;
         closeEncoder();
         return false;
     }
 
-    // 设置重采样参数 (输入格式将在编码时设置)
-    av_opt_set_int(swrContext, "out_sample_rate", codecContext->sample_rate, 0);
-    av_opt_set_sample_fmt(swrContext, "out_sample_fmt", codecContext->sample_fmt, 0);
-    av_opt_set_int(swrContext, "out_channel_layout", codecContext->channel_layout, 0);
-
     std::cout << "音频编码器: 成功初始化编码器 " << codecContext->codec->name << std::endl;
     std::cout << "  采样率: " << codecContext->sample_rate << " Hz" << std::endl;
     std::cout << "  通道数: " << codecContext->channels << std::endl;
@@ -174,16 +251,18 @@ bool AudioEncoder::initEncoder()
 // 关闭编码器
 void AudioEncoder::closeEncoder()
 {
-    if (codecContext)
+    if (sampleFifo)
     {
-        avcodec_free_context(&codecContext);
-        codecContext = nullptr;
+        av_audio_fifo_free(sampleFifo);
+        sampleFifo = nullptr;
     }
+    av_frame_free(&fifoFrame);
+    av_frame_free(&filteredFrame);
 
-    if (swrContext)
+    if (codecContext)
     {
-        swr_free(&swrContext);
-        swrContext = nullptr;
+        avcodec_free_context(&codecContext);
+        codecContext = nullptr;
     }
 
     codec = nullptr;
@@ -216,7 +295,8 @@ bool AudioEncoder::encode(AVFrame *frame)
     return encodeFrame(frame);
 }
 
-// 内部编码帧方法
+// 内部编码帧方法：输入帧可以是任意长度，经样本FIFO切成编码器要求的frame_size后编码；
+// frame为空表示输入结束，先编码FIFO中剩余的样本再刷新编码器
 bool AudioEncoder::encodeFrame(AVFrame *frame)
 {
     if (!codecContext)
@@ -225,149 +305,140 @@ bool AudioEncoder::encodeFrame(AVFrame *frame)
         return false;
     }
 
-    int ret;
-    AVFrame *frameToEncode = nullptr;
-
-    // 如果有滤镜并且帧不为空，应用滤镜
-    if (useFilter && audioFilter && frame)
+    // 检查帧是否为空（EOF标记）
+    if (!frame)
     {
-        AVFrame *filteredFrame = av_frame_alloc();
-        if (!filteredFrame)
+        // 不足一帧的剩余样本作为最后一帧
+        drainSampleFifo(true);
+
+        // 发送NULL帧表示结束编码
+        int ret = avcodec_send_frame(codecContext, nullptr);
+        if (ret < 0)
         {
-            std::cerr << "音频编码器: 无法分配滤镜帧" << std::endl;
+            char errbuf[AV_ERROR_MAX_STRING_SIZE];
+            av_strerror(ret, errbuf, sizeof(errbuf));
+            std::cerr << "音频编码器: 发送EOF帧失败: " << errbuf << std::endl;
             return false;
         }
+        return receivePackets();
+    }
 
-        bool filterResult = audioFilter->processFrame(frame, filteredFrame);
-        if (!filterResult)
-        {
-            av_frame_free(&filteredFrame);
-            std::cerr << "音频编码器: 滤镜处理失败，使用原始帧" << std::endl;
+    AVFrame *frameToEncode = frame;
 
-            // 滤镜处理失败，使用原始帧
-            frameToEncode = frame;
+    // 如果有滤镜，应用滤镜（滤镜输出帧复用同一个AVFrame）
+    if (useFilter && audioFilter)
+    {
+        av_frame_unref(filteredFrame);
+        if (audioFilter->processFrame(frame, filteredFrame))
+        {
+            frameToEncode = filteredFrame;
         }
         else
         {
-            // 使用滤镜处理后的帧
-            std::cout << "音频编码器: 使用滤镜处理后的帧" << std::endl;
-            frameToEncode = filteredFrame;
+            std::cerr << "音频编码器: 滤镜处理失败，使用原始帧" << std::endl;
         }
     }
-    else
-    {
-        // 直接使用原始帧
-        frameToEncode = frame;
-    }
 
-    // 检查帧是否为空（可能是EOF标记）
-    if (!frameToEncode)
+    bool result;
+    if (!sampleFifo)
     {
-        // 发送NULL帧表示结束编码
-        ret = avcodec_send_frame(codecContext, nullptr);
-        if (ret < 0)
+        // 可变帧大小的编码器：直接编码，只需保证PTS单调递增
+        if (frameToEncode->pts == AV_NOPTS_VALUE || frameToEncode->pts < nextPts)
         {
-            char errbuf[AV_ERROR_MAX_STRING_SIZE];
-            av_strerror(ret, errbuf, sizeof(errbuf));
-            std::cerr << "音频编码器: 发送EOF帧失败: " << errbuf << std::endl;
-            return false;
+            frameToEncode->pts = nextPts;
         }
+        nextPts = frameToEncode->pts + frameToEncode->nb_samples;
+        result = sendFrame(frameToEncode);
     }
     else
     {
-        // 设置正确的PTS值，确保单调递增
-        if (frameToEncode->pts == AV_NOPTS_VALUE || frameToEncode->pts < nextPts)
+        // 第一帧确定时间戳起点，之后按已编码的样本数连续递增
+        if (!ptsInitialized)
         {
-            frameToEncode->pts = nextPts;
+            if (frameToEncode->pts != AV_NOPTS_VALUE)
+            {
+                nextPts = frameToEncode->pts;
+            }
+            ptsInitialized = true;
         }
 
-        // 更新下一个PTS值
-        int64_t frameDuration = frameToEncode->nb_samples;
-        nextPts = frameToEncode->pts + frameDuration;
-
-        // 检查帧大小是否符合AC3编码器要求
-        if (codecContext->codec_id == AV_CODEC_ID_AC3 &&
-            frameToEncode->nb_samples != 1536 &&
-            strcmp(codecContext->codec->name, "ac3") == 0)
+        result = av_audio_fifo_write(sampleFifo, reinterpret_cast<void **>(frameToEncode->extended_data),
+                                     frameToEncode->nb_samples) >= frameToEncode->nb_samples;
+        if (!result)
         {
-            std::cout << "音频编码器: 调整帧大小以符合AC3编码器要求，当前样本数: "
-                      << frameToEncode->nb_samples << std::endl;
+            std::cerr << "音频编码器: 写入样本FIFO失败" << std::endl;
+        }
+        else
+        {
+            result = drainSampleFifo(false);
+        }
+    }
 
-            // 创建一个新帧，样本数为1536
-            AVFrame *adjustedFrame = av_frame_alloc();
-            if (!adjustedFrame)
-            {
-                std::cerr << "音频编码器: 无法分配调整大小的帧" << std::endl;
-                if (frameToEncode != frame)
-                {
-                    av_frame_free(&frameToEncode);
-                }
-                return false;
-            }
+    if (frameToEncode == filteredFrame)
+    {
+        av_frame_unref(filteredFrame);
+    }
+    return result;
+}
+
+// 从样本FIFO中取出完整的帧编码；final为true时把不足一帧的剩余样本也编码掉
+bool AudioEncoder::drainSampleFifo(bool final)
+{
+    if (!sampleFifo)
+    {
+        return true;
+    }
 
-            adjustedFrame->format = frameToEncode->format;
-            adjustedFrame->channel_layout = frameToEncode->channel_layout;
-            adjustedFrame->channels = frameToEncode->channels;
-            adjustedFrame->sample_rate = frameToEncode->sample_rate;
-            adjustedFrame->nb_samples = 1536;
+    int frameSize = codecContext->frame_size;
+    while (av_audio_fifo_size(sampleFifo) >= frameSize ||
+           (final && av_audio_fifo_size(sampleFifo) > 0))
+    {
+        int samples = std::min(av_audio_fifo_size(sampleFifo), frameSize);
 
-            // 保持原始帧的PTS值
-            adjustedFrame->pts = frameToEncode->pts;
+        // 编码器已释放上一帧的引用时不会重新分配
+        if (av_frame_make_writable(fifoFrame) < 0)
+        {
+            std::cerr << "音频编码器: 无法复用编码帧缓冲区" << std::endl;
+            return false;
+        }
 
-            ret = av_frame_get_buffer(adjustedFrame, 0);
-            if (ret < 0)
-            {
-                std::cerr << "音频编码器: 无法为调整大小的帧分配缓冲区" << std::endl;
-                av_frame_free(&adjustedFrame);
-                if (frameToEncode != frame)
-                {
-                    av_frame_free(&frameToEncode);
-                }
-                return false;
-            }
+        fifoFrame->nb_samples = frameSize;
+        if (av_audio_fifo_read(sampleFifo, reinterpret_cast<void **>(fifoFrame->extended_data), samples) < samples)
+        {
+            std::cerr << "音频编码器: 从样本FIFO读取失败" << std::endl;
+            return false;
+        }
 
-            // 复制数据，确保不超出源帧的样本数
-            int samples_to_copy = std::min(frameToEncode->nb_samples, 1536);
-            for (int ch = 0; ch < frameToEncode->channels; ch++)
+        // 最后一帧不足frame_size：编码器允许短帧时直接编码，否则用静音补齐
+        if (samples < frameSize)
+        {
+            if (codec->capabilities & AV_CODEC_CAP_SMALL_LAST_FRAME)
             {
-                memcpy(adjustedFrame->data[ch],
-                       frameToEncode->data[ch],
-                       samples_to_copy * av_get_bytes_per_sample((AVSampleFormat)frameToEncode->format));
-
-                // 如果样本数不足1536，用静音填充剩余部分
-                if (samples_to_copy < 1536)
-                {
-                    memset(adjustedFrame->data[ch] + samples_to_copy * av_get_bytes_per_sample((AVSampleFormat)frameToEncode->format),
-                           0,
-                           (1536 - samples_to_copy) * av_get_bytes_per_sample((AVSampleFormat)frameToEncode->format));
-                }
+                fifoFrame->nb_samples = samples;
             }
-
-            // 释放原始滤镜帧
-            if (frameToEncode != frame)
+            else
             {
-                av_frame_free(&frameToEncode);
+                av_samples_set_silence(fifoFrame->extended_data, samples, frameSize - samples,
+                                       codecContext->channels, codecContext->sample_fmt);
             }
-
-            // 使用调整后的帧
-            frameToEncode = adjustedFrame;
-
-            // 更新下一个PTS值，考虑到调整后的帧大小
-            nextPts = frameToEncode->pts + 1536;
-
-            std::cout << "音频编码器: 帧大小已调整为1536个样本" << std::endl;
         }
 
-        // 发送帧到编码器
-        ret = avcodec_send_frame(codecContext, frameToEncode);
+        fifoFrame->pts = nextPts;
+        nextPts += fifoFrame->nb_samples;
 
-        // 如果这是我们创建的帧（不是原始输入帧），释放它
-        if (frameToEncode != frame)
+        if (!sendFrame(fifoFrame))
         {
-            av_frame_free(&frameToEncode);
+            return false;
         }
     }
 
+    return true;
+}
+
+// 发送一帧到编码器并取出编码好的包
+bool AudioEncoder::sendFrame(AVFrame *frame)
+{
+    int ret = avcodec_send_frame(codecContext, frame);
     if (ret < 0)
     {
         char errbuf[AV_ERROR_MAX_STRING_SIZE];
@@ -376,20 +447,24 @@ bool AudioEncoder::encodeFrame(AVFrame *frame)
         return false;
     }
 
-    // 接收编码后的包
-    while (ret >= 0)
+    return receivePackets();
+}
+
+// 接收编码后的包
+bool AudioEncoder::receivePackets()
+{
+    while (true)
     {
-        AVPacket *packet = av_packet_alloc();
+        AVPacketPtr packet = allocPacket();
         if (!packet)
         {
             std::cerr << "音频编码器: 无法分配包" << std::endl;
             return false;
         }
 
-        ret = avcodec_receive_packet(codecContext, packet);
+        int ret = avcodec_receive_packet(codecContext, packet.get());
         if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
         {
-            av_packet_free(&packet);
             break;
         }
         else if (ret < 0)
@@ -397,7 +472,6 @@ bool AudioEncoder::encodeFrame(AVFrame *frame)
             char errbuf[AV_ERROR_MAX_STRING_SIZE];
             av_strerror(ret, errbuf, sizeof(errbuf));
             std::cerr << "音频编码器: 接收包失败: " << errbuf << std::endl;
-            av_packet_free(&packet);
             return false;
         }
 
@@ -417,11 +491,12 @@ bool AudioEncoder::encodeFrame(AVFrame *frame)
         // 如果有回调函数，调用它
         if (encodeCallback)
         {
-            encodeCallback(packet);
+            encodeCallback(packet.get());
         }
 
-        // 将包添加到队列
-        packetQueue.push(packet);
+        // 将包移入队列，队列关闭时由句柄自动释放
+        size_t bytes = static_cast<size_t>(packet->size);
+        packetQueue.push(std::move(packet), bytes);
     }
 
     return true;
@@ -434,11 +509,25 @@ void AudioEncoder::sendEOF()
     {
         encodeFrame(nullptr);
     }
+
+    // 向复用器发送EOF标记包，然后关闭输出队列
+    AVPacketPtr eofPacket = allocPacket();
+    if (eofPacket)
+    {
+        eofPacket->data = nullptr;
+        eofPacket->size = 0;
+        eofPacket->flags |= 0x100; // 自定义EOF标志
+        packetQueue.push(std::move(eofPacket));
+    }
+    packetQueue.close();
 }
 
 // 线程函数
 void AudioEncoder::encodeThreadFunc()
 {
+    // 线程函数退出时（包括提前返回）发布完成信号
+    CompletionGuard completionGuard(completion);
+
     std::cout << "音频编码器: 编码线程启动" << std::endl;
 
     while (isRunning)
@@ -449,19 +538,25 @@ void AudioEncoder::encodeThreadFunc()
             continue;
         }
 
-        // 从队列获取帧
-        void *framePtr = frameQueue.pop();
-        AVFrame *frame = static_cast<AVFrame *>(framePtr);
-        if (!frame)
+        // 从队列获取帧，队列为空时阻塞等待，数据到达即被唤醒
+        AVFramePtr frame;
+        if (!frameQueue.popFor(frame, std::chrono::milliseconds(100)))
         {
+            // 上游已关闭且没有剩余数据，音频帧已全部编码
+            if (frameQueue.isDrained())
+            {
+                break;
+            }
             continue;
         }
 
-        // 编码帧
-        encodeFrame(frame);
+        if (!frame)
+        {
+            continue;
+        }
 
-        // 释放帧
-        av_frame_free(&frame);
+        // 编码帧，帧在句柄离开作用域时释放
+        encodeFrame(frame.get());
     }
 
     // 发送EOF
@@ -480,6 +575,7 @@ void AudioEncoder::start()
 
     isRunning = true;
     isPaused = false;
+    completion.reset();
     encodeThread = std::thread(&AudioEncoder::encodeThreadFunc, this);
 }
 
@@ -504,6 +600,18 @@ void AudioEncoder::pause(bool pause)
     isPaused = pause;
 }
 
+// 等待音频编码线程完成
+bool AudioEncoder::waitForCompletion(std::chrono::milliseconds timeout)
+{
+    return completion.waitFor(timeout);
+}
+
+// 音频编码线程是否已完成
+bool AudioEncoder::isCompleted() const
+{
+    return completion.isDone();
+}
+
 // 设置编码回调
 void AudioEncoder::setEncodeCallback(AudioEncodeCallback callback)
 {
@@ -528,6 +636,18 @@ uint64_t AudioEncoder::getChannelLayout() const
     return codecContext ? codecContext->channel_layout : channelLayout;
 }
 
+// 获取采样格式
+int AudioEncoder::getSampleFormat() const
+{
+    return codecContext ? codecContext->sample_fmt : AV_SAMPLE_FMT_NONE;
+}
+
+// 获取每帧样本数（可变帧大小的编码器为0）
+int AudioEncoder::getFrameSize() const
+{
+    return codecContext ? codecContext->frame_size : 0;
+}
+
 // 获取比特率
 int AudioEncoder::getBitRate() const
 {
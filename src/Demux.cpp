@@ -18,8 +18,23 @@ Demux::Demux(const std::string &inputFile, VideoPacketQueue &videoQueue, AudioPa
       audioQueue(audioQueue),
       isRunning(false),
       isPaused(false),
-      isEOF(false)
+      isEOF(false),
+      backpressureWaits(0),
+      starvationOverrides(0),
+      videoOverride(false),
+      audioOverride(false),
+      rangeStartTime(AV_NOPTS_VALUE),
+      rangeEndTime(AV_NOPTS_VALUE),
+      videoRangeStart(AV_NOPTS_VALUE),
+      videoRangeEnd(AV_NOPTS_VALUE),
+      audioRangeStart(AV_NOPTS_VALUE),
+      audioRangeEnd(AV_NOPTS_VALUE),
+      videoRangeDone(false),
+      audioRangeDone(false)
 {
+    // 解码线程取走数据包时唤醒解复用线程
+    videoQueue.addNotifier(&bufferNotifier);
+    audioQueue.addNotifier(&bufferNotifier);
 }
 
 // 析构函数
@@ -27,6 +42,9 @@ Demux::~Demux()
 {
     stop();
     closeInputFile();
+
+    videoQueue.removeNotifier(&bufferNotifier);
+    audioQueue.removeNotifier(&bufferNotifier);
 }
 
 // 初始化解复用器
@@ -53,10 +71,25 @@ bool Demux::openInputFile()
         return false;
     }
 
+    // 使用带预读的输入时由自定义AVIOContext提供数据，文件名只用于探测格式
+    if (readOptions.mode != INPUT_READ_DEFAULT)
+    {
+        if (inputReader.open(inputFile, readOptions))
+        {
+            formatContext->pb = inputReader.getIOContext();
+            formatContext->flags |= AVFMT_FLAG_CUSTOM_IO;
+        }
+        else
+        {
+            std::cerr << "解复用器: 无法使用预读输入，改用默认读取方式" << std::endl;
+        }
+    }
+
     // 打开输入文件
     if (avformat_open_input(&formatContext, inputFile.c_str(), nullptr, nullptr) != 0)
     {
         std::cerr << "无法打开输入文件" << std::endl;
+        inputReader.close();
         return false;
     }
 
@@ -87,6 +120,9 @@ bool Demux::openInputFile()
                 mediaInfo.fps = stream->avg_frame_rate.num / stream->avg_frame_rate.den;
             }
 
+            mediaInfo.videoTimeBaseNum = stream->time_base.num;
+            mediaInfo.videoTimeBaseDen = stream->time_base.den;
+
             // 保存编解码器参数
             mediaInfo.videoCodecPar = avcodec_parameters_alloc();
             avcodec_parameters_copy(mediaInfo.videoCodecPar, stream->codecpar);
@@ -99,12 +135,18 @@ bool Demux::openInputFile()
             // 获取通道数
             mediaInfo.channels = stream->codecpar->channels;
 
+            mediaInfo.audioTimeBaseNum = stream->time_base.num;
+            mediaInfo.audioTimeBaseDen = stream->time_base.den;
+
             // 保存编解码器参数
             mediaInfo.audioCodecPar = avcodec_parameters_alloc();
             avcodec_parameters_copy(mediaInfo.audioCodecPar, stream->codecpar);
         }
     }
 
+    // 输入起始时间（AV_NOPTS_VALUE表示未知）
+    mediaInfo.startTime = formatContext->start_time;
+
     // 获取总时长
     if (formatContext->duration != AV_NOPTS_VALUE)
     {
@@ -157,6 +199,13 @@ void Demux::closeInputFile()
         avformat_free_context(formatContext);
         formatContext = nullptr;
     }
+
+    // 自定义AVIOContext不随格式上下文释放
+    if (inputReader.isOpen())
+    {
+        inputReader.printStats();
+        inputReader.close();
+    }
 }
 
 // 启动解复用线程
@@ -171,6 +220,7 @@ void Demux::start()
     isPaused = false;
 
     // 创建解复用线程
+    completion.reset();
     demuxThread = std::thread(&Demux::demuxThreadFunc, this);
 }
 
@@ -197,6 +247,289 @@ void Demux::pause(bool pause)
     isPaused = pause;
 }
 
+// 等待解复用线程完成
+bool Demux::waitForCompletion(std::chrono::milliseconds timeout)
+{
+    return completion.waitFor(timeout);
+}
+
+// 解复用线程是否已完成
+bool Demux::isCompleted() const
+{
+    return completion.isDone();
+}
+
+// 设置缓冲水位
+void Demux::setBufferLimits(const DemuxBufferLimits &videoLimits, const DemuxBufferLimits &audioLimits)
+{
+    this->videoLimits = videoLimits;
+    this->audioLimits = audioLimits;
+}
+
+// 超过高水位时阻塞，直到降到低水位以下、另一路饥饿或线程停止
+void Demux::waitForBufferSpace(bool isVideo)
+{
+    PacketQueue &queue = isVideo ? static_cast<PacketQueue &>(videoQueue) : audioQueue;
+    PacketQueue &otherQueue = isVideo ? static_cast<PacketQueue &>(audioQueue) : videoQueue;
+    const DemuxBufferLimits &limits = isVideo ? videoLimits : audioLimits;
+    bool hasOtherStream = isVideo ? (mediaInfo.audioStreamIndex >= 0) : (mediaInfo.videoStreamIndex >= 0);
+    bool &overrideActive = isVideo ? videoOverride : audioOverride;
+
+    // 未达到高水位，直接放行
+    if (queue.getSize() < limits.highPackets && static_cast<int64_t>(queue.getBytes()) < limits.highBytes)
+    {
+        overrideActive = false;
+        return;
+    }
+
+    // 已经在为饥饿的另一路放行，且另一路仍然没有数据，继续读取直到它拿到数据为止
+    if (overrideActive && hasOtherStream && otherQueue.isEmpty())
+    {
+        return;
+    }
+    overrideActive = false;
+
+    backpressureWaits++;
+
+    auto belowLowWatermark = [&]
+    {
+        return queue.getSize() <= limits.lowPackets && static_cast<int64_t>(queue.getBytes()) <= limits.lowBytes;
+    };
+
+    int lastSize = queue.getSize();
+    auto lastProgress = std::chrono::steady_clock::now();
+
+    while (isRunning && !belowLowWatermark())
+    {
+        // 另一路已经饿死，且本路一段时间内没有被消耗：下游很可能在等另一路的数据，继续读取
+        auto now = std::chrono::steady_clock::now();
+        if (hasOtherStream && otherQueue.isEmpty() &&
+            now - lastProgress >= std::chrono::milliseconds(limits.stallTimeoutMs))
+        {
+            starvationOverrides++;
+            overrideActive = true;
+            break;
+        }
+
+        bufferNotifier.waitFor(std::chrono::milliseconds(limits.stallTimeoutMs), [&]
+                               { return !isRunning || belowLowWatermark(); });
+
+        // 队列变短说明下游仍在消耗
+        int size = queue.getSize();
+        if (size < lastSize)
+        {
+            lastSize = size;
+            lastProgress = std::chrono::steady_clock::now();
+        }
+    }
+}
+
+// 将数据包移入队列，队列已满时等待，线程停止或队列关闭时放弃（此时packet仍归调用者所有）
+bool Demux::pushPacket(PacketQueue &queue, AVPacketPtr &packet)
+{
+    size_t bytes = packet->size > 0 ? static_cast<size_t>(packet->size) : 0;
+    while (!queue.pushFor(std::move(packet), bytes, std::chrono::milliseconds(100)))
+    {
+        if (!isRunning || queue.isClosed())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 设置输入读取方式
+void Demux::setInputReadOptions(const InputReadOptions &options)
+{
+    readOptions = options;
+}
+
+// 建立关键帧索引
+bool Demux::buildKeyframeIndex(KeyframeIndex &index, const std::string &indexFile) const
+{
+    if (mediaInfo.videoStreamIndex < 0)
+    {
+        std::cerr << "解复用器: 没有视频流，无法建立关键帧索引" << std::endl;
+        return false;
+    }
+    return index.loadOrBuild(inputFile, indexFile, mediaInfo.videoStreamIndex);
+}
+
+// 发送文件结束标记包到各路队列
+void Demux::sendEOFPackets()
+{
+    if (mediaInfo.videoStreamIndex >= 0)
+    {
+        // 创建一个空数据包作为文件结束标记
+        AVPacketPtr eofPkt = allocPacket();
+        if (eofPkt)
+        {
+            eofPkt->data = NULL;
+            eofPkt->size = 0;
+            eofPkt->stream_index = mediaInfo.videoStreamIndex;
+            // 用一个特殊的 flags 标记这是EOF包
+            eofPkt->flags = AV_PKT_FLAG_KEY | 0x100; // 自定义标记
+            pushPacket(videoQueue, eofPkt);
+        }
+        std::cout << "解复用线程: 已发送视频EOF标记包" << std::endl;
+    }
+
+    if (mediaInfo.audioStreamIndex >= 0)
+    {
+        AVPacketPtr eofPkt = allocPacket();
+        if (eofPkt)
+        {
+            eofPkt->data = NULL;
+            eofPkt->size = 0;
+            eofPkt->stream_index = mediaInfo.audioStreamIndex;
+            eofPkt->flags = AV_PKT_FLAG_KEY | 0x100; // 自定义标记
+            pushPacket(audioQueue, eofPkt);
+        }
+        std::cout << "解复用线程: 已发送音频EOF标记包" << std::endl;
+    }
+}
+
+// 判断数据包是否越过时间段终点并记录该路流已结束；按dts判断，保证pts在终点之前的帧都已读到
+bool Demux::isPastRangeEnd(const AVPacket *packet)
+{
+    bool isVideo = packet->stream_index == mediaInfo.videoStreamIndex;
+    if (!isVideo && packet->stream_index != mediaInfo.audioStreamIndex)
+    {
+        return false;
+    }
+
+    bool &done = isVideo ? videoRangeDone : audioRangeDone;
+    if (done)
+    {
+        return true;
+    }
+
+    int64_t timestamp = packet->dts != AV_NOPTS_VALUE ? packet->dts : packet->pts;
+    int64_t rangeEnd = isVideo ? videoRangeEnd : audioRangeEnd;
+    if (timestamp == AV_NOPTS_VALUE || timestamp < rangeEnd)
+    {
+        return false;
+    }
+
+    done = true;
+    std::cout << "解复用线程: " << (isVideo ? "视频" : "音频") << "流已到达时间段终点" << std::endl;
+    return true;
+}
+
+// 设置时间段并定位到起点之前最近的关键帧
+bool Demux::setTimeRange(double startSeconds, double endSeconds, const KeyframeIndex *index)
+{
+    if (!formatContext || isRunning)
+    {
+        std::cerr << "解复用器: 必须在init之后、start之前设置时间段" << std::endl;
+        return false;
+    }
+    if (startSeconds < 0 || (endSeconds > 0 && endSeconds <= startSeconds))
+    {
+        std::cerr << "解复用器: 无效的时间段 " << startSeconds << " - " << endSeconds << " 秒" << std::endl;
+        return false;
+    }
+
+    int64_t baseTime = formatContext->start_time != AV_NOPTS_VALUE ? formatContext->start_time : 0;
+    rangeStartTime = startSeconds > 0 ? baseTime + static_cast<int64_t>(startSeconds * AV_TIME_BASE) : AV_NOPTS_VALUE;
+    rangeEndTime = endSeconds > 0 ? baseTime + static_cast<int64_t>(endSeconds * AV_TIME_BASE) : AV_NOPTS_VALUE;
+
+    // 换算到各路流的时间基，解复用线程和解码器直接与包/帧的时间戳比较
+    videoRangeStart = videoRangeEnd = audioRangeStart = audioRangeEnd = AV_NOPTS_VALUE;
+    if (mediaInfo.videoStreamIndex >= 0)
+    {
+        AVRational timeBase = formatContext->streams[mediaInfo.videoStreamIndex]->time_base;
+        if (rangeStartTime != AV_NOPTS_VALUE)
+        {
+            videoRangeStart = av_rescale_q(rangeStartTime, AV_TIME_BASE_Q, timeBase);
+        }
+        if (rangeEndTime != AV_NOPTS_VALUE)
+        {
+            videoRangeEnd = av_rescale_q(rangeEndTime, AV_TIME_BASE_Q, timeBase);
+        }
+    }
+    if (mediaInfo.audioStreamIndex >= 0)
+    {
+        AVRational timeBase = formatContext->streams[mediaInfo.audioStreamIndex]->time_base;
+        if (rangeStartTime != AV_NOPTS_VALUE)
+        {
+            audioRangeStart = av_rescale_q(rangeStartTime, AV_TIME_BASE_Q, timeBase);
+        }
+        if (rangeEndTime != AV_NOPTS_VALUE)
+        {
+            audioRangeEnd = av_rescale_q(rangeEndTime, AV_TIME_BASE_Q, timeBase);
+        }
+    }
+
+    // 不存在的流视为已经到达终点
+    videoRangeDone = mediaInfo.videoStreamIndex < 0;
+    audioRangeDone = mediaInfo.audioStreamIndex < 0;
+
+    std::cout << "解复用器: 处理时间段 " << startSeconds << " - ";
+    if (endSeconds > 0)
+    {
+        std::cout << endSeconds << " 秒" << std::endl;
+    }
+    else
+    {
+        std::cout << "文件结束" << std::endl;
+    }
+
+    if (rangeStartTime == AV_NOPTS_VALUE)
+    {
+        return true;
+    }
+
+    // 有关键帧索引时直接定位到索引中起点之前的关键帧，否则交给解复用器在自己的索引中查找
+    int ret = -1;
+    if (index && index->getStreamIndex() == mediaInfo.videoStreamIndex && videoRangeStart != AV_NOPTS_VALUE)
+    {
+        int keyframe = index->findKeyframeBefore(videoRangeStart);
+        if (keyframe >= 0)
+        {
+            const KeyframeEntry &entry = index->getEntries()[keyframe];
+            int64_t seekTarget = entry.dts != AV_NOPTS_VALUE ? entry.dts : entry.pts;
+            ret = avformat_seek_file(formatContext, mediaInfo.videoStreamIndex, INT64_MIN, seekTarget, seekTarget, 0);
+            if (ret >= 0)
+            {
+                AVRational timeBase = formatContext->streams[mediaInfo.videoStreamIndex]->time_base;
+                std::cout << "解复用器: 按关键帧索引定位到第 " << keyframe << " 个关键帧 ("
+                          << (av_rescale_q(seekTarget, timeBase, AV_TIME_BASE_Q) - baseTime) / (double)AV_TIME_BASE
+                          << " 秒)" << std::endl;
+            }
+        }
+    }
+    if (ret < 0)
+    {
+        ret = avformat_seek_file(formatContext, -1, INT64_MIN, rangeStartTime, rangeStartTime, 0);
+    }
+
+    if (ret < 0)
+    {
+        // 不能定位（例如管道输入）时从头读取，起点之前的帧同样由解码器丢弃
+        char errBuff[AV_ERROR_MAX_STRING_SIZE] = {0};
+        av_strerror(ret, errBuff, AV_ERROR_MAX_STRING_SIZE);
+        std::cerr << "解复用器: 无法定位到起点 (" << errBuff << ")，将从头读取并丢弃起点之前的帧" << std::endl;
+    }
+    return true;
+}
+
+int64_t Demux::getRangeStartPts(bool isVideo) const
+{
+    return isVideo ? videoRangeStart : audioRangeStart;
+}
+
+int64_t Demux::getRangeEndPts(bool isVideo) const
+{
+    return isVideo ? videoRangeEnd : audioRangeEnd;
+}
+
+// 输出的起始时间
+int64_t Demux::getOutputStartTime() const
+{
+    return rangeStartTime != AV_NOPTS_VALUE ? rangeStartTime : mediaInfo.startTime;
+}
+
 // 获取媒体信息
 const MediaInfo &Demux::getMediaInfo() const
 {
@@ -206,18 +539,19 @@ const MediaInfo &Demux::getMediaInfo() const
 // 解复用线程函数
 void Demux::demuxThreadFunc()
 {
+    // 线程函数退出时（包括提前返回）发布完成信号
+    CompletionGuard completionGuard(completion);
+
     if (!formatContext)
     {
         std::cerr << "解复用线程: 格式上下文为空" << std::endl;
+        videoQueue.close();
+        audioQueue.close();
         return;
     }
 
-    AVPacket *packet = av_packet_alloc();
-    if (!packet)
-    {
-        std::cerr << "解复用线程: 无法分配AVPacket" << std::endl;
-        return;
-    }
+    // 读取用的数据包，读到的内容直接移入队列，不再额外复制引用
+    AVPacketPtr packet;
 
     std::cout << "解复用线程: 开始" << std::endl;
 
@@ -237,21 +571,19 @@ void Demux::demuxThreadFunc()
         //     continue;
         // }
 
-        // // 检查队列大小，避免内存占用过多
-        // if (mediaInfo.videoStreamIndex >= 0 && videoQueue.getSize() > 500)
-        // {
-        //     std::this_thread::sleep_for(std::chrono::milliseconds(10));
-        //     continue;
-        // }
-
-        // if (mediaInfo.audioStreamIndex >= 0 && audioQueue.getSize() > 100)
-        // {
-        //     std::this_thread::sleep_for(std::chrono::milliseconds(10));
-        //     continue;
-        // }
+        // 上一个数据包已移交给队列，分配新的数据包
+        if (!packet)
+        {
+            packet = allocPacket();
+            if (!packet)
+            {
+                std::cerr << "解复用线程: 无法分配AVPacket" << std::endl;
+                break;
+            }
+        }
 
         // 读取下一个数据包
-        int ret = av_read_frame(formatContext, packet);
+        int ret = av_read_frame(formatContext, packet.get());
 
         // 定期打印解复用状态
         packetCount++;
@@ -262,6 +594,7 @@ void Demux::demuxThreadFunc()
             std::cout << "解复用线程: 已读取 " << packetCount << " 个数据包 (视频: "
                       << videoPacketCount << ", 音频: " << audioPacketCount
                       << "), 队列大小: " << videoQueue.getSize()
+                      << " (" << videoQueue.getBytes() / 1024 << " KB)"
                       << ", 耗时: " << elapsedSeconds << "秒" << std::endl;
         }
 
@@ -279,32 +612,7 @@ void Demux::demuxThreadFunc()
                           << ", 音频: " << audioPacketCount << ")" << std::endl;
 
                 // 发送文件结束标记包到队列
-                if (mediaInfo.videoStreamIndex >= 0)
-                {
-                    // 创建一个空数据包作为文件结束标记
-                    AVPacket *eofPkt = av_packet_alloc();
-                    av_packet_unref(eofPkt); // 确保内容为空
-                    eofPkt->data = NULL;
-                    eofPkt->size = 0;
-                    eofPkt->stream_index = mediaInfo.videoStreamIndex;
-                    // 用一个特殊的 flags 标记这是EOF包
-                    eofPkt->flags = AV_PKT_FLAG_KEY | 0x100; // 自定义标记
-                    videoQueue.push(eofPkt);
-                    std::cout << "解复用线程: 已发送视频EOF标记包" << std::endl;
-                }
-
-                if (mediaInfo.audioStreamIndex >= 0)
-                {
-                    AVPacket *eofPkt = av_packet_alloc();
-                    av_packet_unref(eofPkt);
-                    eofPkt->data = NULL;
-                    eofPkt->size = 0;
-                    eofPkt->stream_index = mediaInfo.audioStreamIndex;
-                    eofPkt->flags = AV_PKT_FLAG_KEY | 0x100; // 自定义标记
-                    audioQueue.push(eofPkt);
-                    std::cout << "解复用线程: 已发送音频EOF标记包" << std::endl;
-                }
-
+                sendEOFPackets();
                 isEOF = true;
             }
             else
@@ -325,13 +633,28 @@ void Demux::demuxThreadFunc()
             break;
         }
 
+        // 按时间段处理：越过终点的包直接丢弃，所有流都到达终点后不再读取文件剩余部分
+        if (rangeEndTime != AV_NOPTS_VALUE && isPastRangeEnd(packet.get()))
+        {
+            av_packet_unref(packet.get());
+            if (videoRangeDone && audioRangeDone)
+            {
+                std::cout << "解复用线程: 已到达时间段终点，已读取 " << packetCount
+                          << " 个数据包 (视频: " << videoPacketCount
+                          << ", 音频: " << audioPacketCount << ")" << std::endl;
+                sendEOFPackets();
+                isEOF = true;
+                break;
+            }
+            continue;
+        }
+
         // 处理数据包
         if (packet->stream_index == mediaInfo.videoStreamIndex)
         {
-            // 复制数据包并放入视频队列
-            AVPacket *videoPkt = av_packet_alloc();
-            av_packet_ref(videoPkt, packet);
-            videoQueue.push(videoPkt);
+            // 视频队列超过高水位时先等待解码线程消耗
+            waitForBufferSpace(true);
+
             videoPacketCount++;
 
             // 检查是否是关键帧
@@ -343,22 +666,38 @@ void Demux::demuxThreadFunc()
                               << ", 总包数: " << videoPacketCount << std::endl;
                 }
             }
+
+            // 将数据包直接移入视频队列
+            if (!pushPacket(videoQueue, packet))
+            {
+                av_packet_unref(packet.get());
+            }
         }
         else if (packet->stream_index == mediaInfo.audioStreamIndex)
         {
-            // 复制数据包并放入音频队列
-            AVPacket *audioPkt = av_packet_alloc();
-            av_packet_ref(audioPkt, packet);
-            audioQueue.push(audioPkt);
+            // 音频队列超过高水位时先等待解码线程消耗
+            waitForBufferSpace(false);
+
+            // 将数据包直接移入音频队列
+            if (!pushPacket(audioQueue, packet))
+            {
+                av_packet_unref(packet.get());
+            }
             audioPacketCount++;
         }
-
-        // 释放原始数据包
-        av_packet_unref(packet);
+        else
+        {
+            // 其他流的数据包不需要，复用数据包外壳
+            av_packet_unref(packet.get());
+        }
     }
 
     // 清理
-    av_packet_free(&packet);
+    packet.reset();
+
+    // 不会再有新的数据包，关闭队列唤醒下游解码线程
+    videoQueue.close();
+    audioQueue.close();
 
     // 如果线程正常结束，设置EOF标志
     isEOF = true;
@@ -367,7 +706,8 @@ void Demux::demuxThreadFunc()
     auto endTime = std::chrono::high_resolution_clock::now();
     double totalSeconds = std::chrono::duration<double>(endTime - startTime).count();
     std::cout << "解复用线程: 结束，总共处理 " << packetCount << " 个数据包，耗时 "
-              << totalSeconds << " 秒" << std::endl;
+              << totalSeconds << " 秒，反压等待 " << backpressureWaits
+              << " 次，饥饿放行 " << starvationOverrides << " 次" << std::endl;
 }
 
 // 检查解复用是否完成
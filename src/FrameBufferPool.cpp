@@ -0,0 +1,357 @@
+#include "../include/FrameBufferPool.h"
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <cerrno>
+#include <sys/mman.h>
+
+// 引入FFmpeg头文件
+extern "C"
+{
+#include "ffmpeg/include_ffmpeg/libavcodec/avcodec.h"
+#include "ffmpeg/include_ffmpeg/libavutil/buffer.h"
+#include "ffmpeg/include_ffmpeg/libavutil/frame.h"
+#include "ffmpeg/include_ffmpeg/libavutil/imgutils.h"
+#include "ffmpeg/include_ffmpeg/libavutil/pixdesc.h"
+}
+
+// 平面起始地址与行宽的对齐字节数
+#define FRAME_BUFFER_ALIGN 64
+// 透明大页大小，帧缓冲不小于该值时按大页对齐并建议内核使用大页
+#define FRAME_BUFFER_HUGE_PAGE (2 * 1024 * 1024)
+
+namespace
+{
+    size_t alignUp(size_t value, size_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    // AVBufferPool的分配回调，opaque为FrameBufferPool
+#if FF_API_BUFFER_SIZE_T
+    AVBufferRef *poolAlloc(void *opaque, int size)
+#else
+    AVBufferRef *poolAlloc(void *opaque, size_t size)
+#endif
+    {
+        return static_cast<FrameBufferPool *>(opaque)->allocBuffer(static_cast<size_t>(size));
+    }
+
+    // posix_memalign分配的内存直接free
+    void poolFree(void *opaque, uint8_t *data)
+    {
+        (void)opaque;
+        free(data);
+    }
+}
+
+// 构造函数
+FrameBufferPool::FrameBufferPool()
+    : pool(nullptr),
+      poolWidth(0),
+      poolHeight(0),
+      poolFormat(-1),
+      planeCount(0),
+      bufferSize(0),
+      prefillFrames(0),
+      useHugePages(false),
+      requests(0),
+      fallbacks(0),
+      allocatedBuffers(0)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        linesizes[i] = 0;
+        planeOffsets[i] = 0;
+    }
+}
+
+// 析构函数
+FrameBufferPool::~FrameBufferPool()
+{
+    releasePool();
+}
+
+// 挂接到解码器上下文
+bool FrameBufferPool::attach(AVCodecContext *codecContext, int prefillFrames, bool useHugePages)
+{
+    if (!codecContext || !codecContext->codec)
+    {
+        std::cerr << "帧缓冲池: 无效的解码器上下文" << std::endl;
+        return false;
+    }
+
+    if (!(codecContext->codec->capabilities & AV_CODEC_CAP_DR1))
+    {
+        std::cout << "帧缓冲池: 解码器 " << codecContext->codec->name << " 不支持自定义帧缓冲，使用默认分配" << std::endl;
+        return false;
+    }
+
+    this->prefillFrames = prefillFrames > 0 ? prefillFrames : 0;
+    this->useHugePages = useHugePages;
+
+    codecContext->opaque = this;
+    codecContext->get_buffer2 = &FrameBufferPool::getBuffer2;
+
+    // 回调内部有锁保护，允许帧级多线程解码直接在工作线程中调用
+#if FF_API_THREAD_SAFE_CALLBACKS
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+    codecContext->thread_safe_callbacks = 1;
+#pragma GCC diagnostic pop
+#endif
+
+    std::cout << "帧缓冲池: 已挂接到解码器，预分配 " << this->prefillFrames << " 帧"
+              << (useHugePages ? "，使用透明大页" : "") << std::endl;
+    return true;
+}
+
+// 调整预分配帧数
+void FrameBufferPool::setPrefillFrames(int prefillFrames)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    this->prefillFrames = prefillFrames > 0 ? prefillFrames : 0;
+}
+
+// get_buffer2静态回调
+int FrameBufferPool::getBuffer2(AVCodecContext *codecContext, AVFrame *frame, int flags)
+{
+    FrameBufferPool *self = static_cast<FrameBufferPool *>(codecContext->opaque);
+    if (!self)
+    {
+        return avcodec_default_get_buffer2(codecContext, frame, flags);
+    }
+    return self->getBuffer(codecContext, frame, flags);
+}
+
+// 为解码器分配一帧的缓冲区
+int FrameBufferPool::getBuffer(AVCodecContext *codecContext, AVFrame *frame, int flags)
+{
+    requests.fetch_add(1, std::memory_order_relaxed);
+
+    // 硬件帧和调色板格式交给默认分配器
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(static_cast<AVPixelFormat>(frame->format));
+    if (codecContext->codec_type != AVMEDIA_TYPE_VIDEO || !desc ||
+        (desc->flags & (AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_PAL)))
+    {
+        fallbacks.fetch_add(1, std::memory_order_relaxed);
+        return avcodec_default_get_buffer2(codecContext, frame, flags);
+    }
+
+    AVBufferRef *buffer = nullptr;
+    int frameLinesizes[4];
+    size_t frameOffsets[4];
+    int framePlanes = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!pool || frame->width != poolWidth || frame->height != poolHeight || frame->format != poolFormat)
+        {
+            if (!configure(codecContext, frame->width, frame->height, frame->format))
+            {
+                fallbacks.fetch_add(1, std::memory_order_relaxed);
+                return avcodec_default_get_buffer2(codecContext, frame, flags);
+            }
+        }
+
+        buffer = av_buffer_pool_get(pool);
+        framePlanes = planeCount;
+        for (int i = 0; i < 4; i++)
+        {
+            frameLinesizes[i] = linesizes[i];
+            frameOffsets[i] = planeOffsets[i];
+        }
+    }
+
+    if (!buffer)
+    {
+        std::cerr << "帧缓冲池: 无法从缓冲池获取内存" << std::endl;
+        return AVERROR(ENOMEM);
+    }
+
+    // 整帧共用一块内存，各平面按偏移切分
+    frame->buf[0] = buffer;
+    for (int i = 0; i < framePlanes; i++)
+    {
+        frame->data[i] = buffer->data + frameOffsets[i];
+        frame->linesize[i] = frameLinesizes[i];
+    }
+    frame->extended_data = frame->data;
+
+    return 0;
+}
+
+// 按帧格式（重新）创建缓冲池
+bool FrameBufferPool::configure(AVCodecContext *codecContext, int width, int height, int format)
+{
+    AVPixelFormat pixFmt = static_cast<AVPixelFormat>(format);
+
+    // 解码器要求的对齐尺寸（宏块边界、边缘扩展等）
+    int alignedWidth = width;
+    int alignedHeight = height;
+    int strideAlign[AV_NUM_DATA_POINTERS];
+    avcodec_align_dimensions2(codecContext, &alignedWidth, &alignedHeight, strideAlign);
+
+    // 逐步放大宽度，直到所有平面的行宽都是64字节的整数倍（保持各平面行宽比例不变）
+    int lines[4];
+    bool unaligned = true;
+    while (unaligned)
+    {
+        if (av_image_fill_linesizes(lines, pixFmt, alignedWidth) < 0)
+        {
+            std::cerr << "帧缓冲池: 不支持的像素格式 " << format << std::endl;
+            return false;
+        }
+        unaligned = false;
+        for (int i = 0; i < 4; i++)
+        {
+            if (lines[i] % FRAME_BUFFER_ALIGN != 0 ||
+                (strideAlign[i] > 0 && lines[i] % strideAlign[i] != 0))
+            {
+                unaligned = true;
+            }
+        }
+        if (unaligned)
+        {
+            alignedWidth += alignedWidth & ~(alignedWidth - 1);
+        }
+    }
+
+    ptrdiff_t planeLinesizes[4];
+    for (int i = 0; i < 4; i++)
+    {
+        planeLinesizes[i] = lines[i];
+    }
+
+    size_t planeSizes[4];
+    if (av_image_fill_plane_sizes(planeSizes, pixFmt, alignedHeight, planeLinesizes) < 0)
+    {
+        std::cerr << "帧缓冲池: 无法计算平面大小" << std::endl;
+        return false;
+    }
+
+    // 各平面依次排布在同一块内存中，起始地址64字节对齐，末尾留出解码器越界读写的余量
+    size_t offset = 0;
+    int planes = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        linesizes[i] = 0;
+        planeOffsets[i] = 0;
+        if (planeSizes[i] == 0)
+        {
+            continue;
+        }
+        linesizes[i] = lines[i];
+        planeOffsets[i] = offset;
+        offset = alignUp(offset + planeSizes[i] + 16 + FRAME_BUFFER_ALIGN - 1, FRAME_BUFFER_ALIGN);
+        planes = i + 1;
+    }
+
+    // 旧池在已经发出的帧全部释放后自动销毁
+    releasePool();
+
+    bufferSize = offset + AV_INPUT_BUFFER_PADDING_SIZE;
+    pool = av_buffer_pool_init2(bufferSize, this, poolAlloc, nullptr);
+    if (!pool)
+    {
+        std::cerr << "帧缓冲池: 无法创建AVBufferPool" << std::endl;
+        return false;
+    }
+
+    planeCount = planes;
+    poolWidth = width;
+    poolHeight = height;
+    poolFormat = format;
+
+    // 预分配：一次取出若干块再全部放回池中
+    std::vector<AVBufferRef *> prefilled;
+    prefilled.reserve(prefillFrames);
+    for (int i = 0; i < prefillFrames; i++)
+    {
+        AVBufferRef *buffer = av_buffer_pool_get(pool);
+        if (!buffer)
+        {
+            break;
+        }
+        prefilled.push_back(buffer);
+    }
+    for (size_t i = 0; i < prefilled.size(); i++)
+    {
+        av_buffer_unref(&prefilled[i]);
+    }
+
+    std::cout << "帧缓冲池: " << width << "x" << height << " " << av_get_pix_fmt_name(pixFmt)
+              << "，行宽 " << linesizes[0] << "，每帧 " << bufferSize / 1024 << " KB，预分配 "
+              << prefilled.size() << " 帧" << std::endl;
+    return true;
+}
+
+// 释放当前缓冲池
+void FrameBufferPool::releasePool()
+{
+    if (pool)
+    {
+        av_buffer_pool_uninit(&pool);
+        pool = nullptr;
+    }
+}
+
+// 分配一块新的帧内存
+AVBufferRef *FrameBufferPool::allocBuffer(size_t size)
+{
+    size_t alignment = FRAME_BUFFER_ALIGN;
+    size_t allocSize = size;
+    bool hugePage = useHugePages && size >= FRAME_BUFFER_HUGE_PAGE;
+    if (hugePage)
+    {
+        // 按大页对齐，内核才能用整页映射
+        alignment = FRAME_BUFFER_HUGE_PAGE;
+        allocSize = alignUp(size, FRAME_BUFFER_HUGE_PAGE);
+    }
+
+    void *data = nullptr;
+    if (posix_memalign(&data, alignment, allocSize) != 0)
+    {
+        std::cerr << "帧缓冲池: 无法分配 " << allocSize << " 字节" << std::endl;
+        return nullptr;
+    }
+
+#ifdef MADV_HUGEPAGE
+    if (hugePage)
+    {
+        madvise(data, allocSize, MADV_HUGEPAGE);
+    }
+#endif
+
+    AVBufferRef *buffer = av_buffer_create(static_cast<uint8_t *>(data), size, poolFree, nullptr, 0);
+    if (!buffer)
+    {
+        free(data);
+        return nullptr;
+    }
+
+    allocatedBuffers.fetch_add(1, std::memory_order_relaxed);
+    return buffer;
+}
+
+// 获取统计信息
+uint64_t FrameBufferPool::getRequests() const
+{
+    return requests.load(std::memory_order_relaxed);
+}
+
+uint64_t FrameBufferPool::getFallbacks() const
+{
+    return fallbacks.load(std::memory_order_relaxed);
+}
+
+int FrameBufferPool::getAllocatedBuffers() const
+{
+    return allocatedBuffers.load(std::memory_order_relaxed);
+}
+
+// 打印统计信息
+void FrameBufferPool::printStats() const
+{
+    std::cout << "帧缓冲池: 共请求 " << getRequests() << " 帧，实际分配 " << getAllocatedBuffers()
+              << " 块内存，回退默认分配 " << getFallbacks() << " 次" << std::endl;
+}
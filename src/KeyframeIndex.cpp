@@ -0,0 +1,370 @@
+#include "../include/KeyframeIndex.h"
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <sys/stat.h>
+
+// 引入FFmpeg头文件
+extern "C"
+{
+#include "ffmpeg/include_ffmpeg/libavformat/avformat.h"
+#include "ffmpeg/include_ffmpeg/libavcodec/avcodec.h"
+}
+
+// 索引文件格式：魔数、版本，文件头（输入大小、修改时间、流索引、时间基、关键帧数），然后是定长的关键帧记录
+#define KEYFRAME_INDEX_MAGIC 0x5846464B // "KFFX"
+#define KEYFRAME_INDEX_VERSION 1
+
+namespace
+{
+    struct IndexFileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        int64_t inputSize;
+        int64_t inputMtime;
+        int32_t streamIndex;
+        int32_t timeBaseNum;
+        int32_t timeBaseDen;
+        uint32_t entryCount;
+    };
+
+    // 每条记录28字节，不使用结构体直接读写，避免填充字节进入文件
+    const size_t ENTRY_BYTES = 3 * sizeof(int64_t) + sizeof(uint32_t);
+
+    void packEntry(const KeyframeEntry &entry, unsigned char *out)
+    {
+        memcpy(out, &entry.pts, sizeof(int64_t));
+        memcpy(out + 8, &entry.dts, sizeof(int64_t));
+        memcpy(out + 16, &entry.pos, sizeof(int64_t));
+        memcpy(out + 24, &entry.gopLength, sizeof(uint32_t));
+    }
+
+    void unpackEntry(const unsigned char *in, KeyframeEntry &entry)
+    {
+        memcpy(&entry.pts, in, sizeof(int64_t));
+        memcpy(&entry.dts, in + 8, sizeof(int64_t));
+        memcpy(&entry.pos, in + 16, sizeof(int64_t));
+        memcpy(&entry.gopLength, in + 24, sizeof(uint32_t));
+    }
+}
+
+// 构造函数
+KeyframeIndex::KeyframeIndex()
+    : streamIndex(-1),
+      timeBaseNum(0),
+      timeBaseDen(1),
+      inputSize(-1),
+      inputMtime(0),
+      fromCache(false)
+{
+}
+
+// 获取输入文件的大小和修改时间，不是普通文件（例如管道）时返回false
+bool KeyframeIndex::statInput(const std::string &inputFile, int64_t &size, int64_t &mtime)
+{
+    struct stat fileStat;
+    if (stat(inputFile.c_str(), &fileStat) != 0 || !S_ISREG(fileStat.st_mode))
+    {
+        return false;
+    }
+    size = static_cast<int64_t>(fileStat.st_size);
+    mtime = static_cast<int64_t>(fileStat.st_mtim.tv_sec) * 1000000000LL + fileStat.st_mtim.tv_nsec;
+    return true;
+}
+
+// 扫描输入文件建立索引
+bool KeyframeIndex::build(const std::string &inputFile, int streamIndex)
+{
+    entries.clear();
+    fromCache = false;
+
+    if (!statInput(inputFile, inputSize, inputMtime))
+    {
+        std::cerr << "关键帧索引: 输入不是普通文件，无法建立索引: " << inputFile << std::endl;
+        return false;
+    }
+
+    AVFormatContext *formatContext = nullptr;
+    if (avformat_open_input(&formatContext, inputFile.c_str(), nullptr, nullptr) != 0)
+    {
+        std::cerr << "关键帧索引: 无法打开输入文件: " << inputFile << std::endl;
+        return false;
+    }
+    if (avformat_find_stream_info(formatContext, nullptr) < 0)
+    {
+        std::cerr << "关键帧索引: 无法找到流信息" << std::endl;
+        avformat_close_input(&formatContext);
+        return false;
+    }
+
+    if (streamIndex < 0)
+    {
+        for (unsigned int i = 0; i < formatContext->nb_streams; i++)
+        {
+            if (formatContext->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO)
+            {
+                streamIndex = static_cast<int>(i);
+                break;
+            }
+        }
+    }
+    if (streamIndex < 0 || streamIndex >= static_cast<int>(formatContext->nb_streams) ||
+        formatContext->streams[streamIndex]->codecpar->codec_type != AVMEDIA_TYPE_VIDEO)
+    {
+        std::cerr << "关键帧索引: 输入中没有视频流" << std::endl;
+        avformat_close_input(&formatContext);
+        return false;
+    }
+
+    // 只读取视频流
+    for (unsigned int i = 0; i < formatContext->nb_streams; i++)
+    {
+        formatContext->streams[i]->discard = (static_cast<int>(i) == streamIndex) ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+    }
+
+    this->streamIndex = streamIndex;
+    timeBaseNum = formatContext->streams[streamIndex]->time_base.num;
+    timeBaseDen = formatContext->streams[streamIndex]->time_base.den;
+
+    AVPacket *packet = av_packet_alloc();
+    if (!packet)
+    {
+        avformat_close_input(&formatContext);
+        return false;
+    }
+
+    int ret;
+    while ((ret = av_read_frame(formatContext, packet)) >= 0)
+    {
+        if (packet->stream_index == streamIndex)
+        {
+            if (packet->flags & AV_PKT_FLAG_KEY)
+            {
+                KeyframeEntry entry;
+                entry.pts = packet->pts;
+                entry.dts = packet->dts;
+                entry.pos = packet->pos;
+                entry.gopLength = 0;
+                entries.push_back(entry);
+            }
+            // 关键帧之前的包（开放GOP的前导帧）不属于任何GOP
+            if (!entries.empty())
+            {
+                entries.back().gopLength++;
+            }
+        }
+        av_packet_unref(packet);
+    }
+    av_packet_free(&packet);
+    avformat_close_input(&formatContext);
+
+    if (ret != AVERROR_EOF)
+    {
+        char errBuf[AV_ERROR_MAX_STRING_SIZE] = {0};
+        av_strerror(ret, errBuf, AV_ERROR_MAX_STRING_SIZE);
+        std::cerr << "关键帧索引: 读取输入时出错，索引可能不完整: " << errBuf << std::endl;
+        return false;
+    }
+
+    if (entries.empty())
+    {
+        std::cerr << "关键帧索引: 视频流中没有关键帧" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// 从索引文件加载
+bool KeyframeIndex::load(const std::string &inputFile, const std::string &indexFile, int streamIndex)
+{
+    int64_t size = 0;
+    int64_t mtime = 0;
+    if (!statInput(inputFile, size, mtime))
+    {
+        return false;
+    }
+
+    FILE *file = fopen(indexFile.c_str(), "rb");
+    if (!file)
+    {
+        return false;
+    }
+
+    IndexFileHeader header;
+    bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+                 header.magic == KEYFRAME_INDEX_MAGIC && header.version == KEYFRAME_INDEX_VERSION &&
+                 header.inputSize == size && header.inputMtime == mtime &&
+                 (streamIndex < 0 || header.streamIndex == streamIndex) &&
+                 header.timeBaseNum > 0 && header.timeBaseDen > 0 && header.entryCount > 0;
+    if (!valid)
+    {
+        fclose(file);
+        std::cout << "关键帧索引: 缓存与输入文件不一致，需要重新扫描" << std::endl;
+        return false;
+    }
+
+    std::vector<unsigned char> buffer(static_cast<size_t>(header.entryCount) * ENTRY_BYTES);
+    bool complete = fread(buffer.data(), 1, buffer.size(), file) == buffer.size();
+    fclose(file);
+    if (!complete)
+    {
+        std::cerr << "关键帧索引: 索引文件不完整: " << indexFile << std::endl;
+        return false;
+    }
+
+    entries.resize(header.entryCount);
+    for (uint32_t i = 0; i < header.entryCount; i++)
+    {
+        unpackEntry(buffer.data() + i * ENTRY_BYTES, entries[i]);
+    }
+
+    this->streamIndex = header.streamIndex;
+    timeBaseNum = header.timeBaseNum;
+    timeBaseDen = header.timeBaseDen;
+    inputSize = size;
+    inputMtime = mtime;
+    fromCache = true;
+    return true;
+}
+
+// 保存到索引文件
+bool KeyframeIndex::save(const std::string &indexFile) const
+{
+    if (entries.empty())
+    {
+        return false;
+    }
+
+    std::string tempFile = indexFile + ".tmp";
+    FILE *file = fopen(tempFile.c_str(), "wb");
+    if (!file)
+    {
+        std::cerr << "关键帧索引: 无法创建索引文件: " << tempFile << " (" << strerror(errno) << ")" << std::endl;
+        return false;
+    }
+
+    IndexFileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = KEYFRAME_INDEX_MAGIC;
+    header.version = KEYFRAME_INDEX_VERSION;
+    header.inputSize = inputSize;
+    header.inputMtime = inputMtime;
+    header.streamIndex = streamIndex;
+    header.timeBaseNum = timeBaseNum;
+    header.timeBaseDen = timeBaseDen;
+    header.entryCount = static_cast<uint32_t>(entries.size());
+
+    std::vector<unsigned char> buffer(entries.size() * ENTRY_BYTES);
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        packEntry(entries[i], buffer.data() + i * ENTRY_BYTES);
+    }
+
+    bool success = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+    success = (fclose(file) == 0) && success;
+    if (!success || rename(tempFile.c_str(), indexFile.c_str()) != 0)
+    {
+        std::cerr << "关键帧索引: 写入索引文件失败: " << indexFile << std::endl;
+        remove(tempFile.c_str());
+        return false;
+    }
+    return true;
+}
+
+// 有可用的缓存就加载，否则扫描并保存
+bool KeyframeIndex::loadOrBuild(const std::string &inputFile, const std::string &indexFile, int streamIndex)
+{
+    std::string path = indexFile.empty() ? defaultIndexPath(inputFile) : indexFile;
+    if (load(inputFile, path, streamIndex))
+    {
+        return true;
+    }
+
+    if (!build(inputFile, streamIndex))
+    {
+        return false;
+    }
+
+    // 保存失败（例如输入所在目录只读）不影响本次使用
+    if (save(path))
+    {
+        std::cout << "关键帧索引: 已保存到 " << path << std::endl;
+    }
+    return true;
+}
+
+// 二分查找pts不大于给定时间戳的最后一个关键帧（关键帧按解码顺序排列，pts随之递增）
+int KeyframeIndex::findKeyframeBefore(int64_t pts) const
+{
+    int low = 0;
+    int high = static_cast<int>(entries.size()) - 1;
+    int found = -1;
+    while (low <= high)
+    {
+        int middle = low + (high - low) / 2;
+        int64_t keyPts = entries[middle].pts != AV_NOPTS_VALUE ? entries[middle].pts : entries[middle].dts;
+        if (keyPts != AV_NOPTS_VALUE && keyPts <= pts)
+        {
+            found = middle;
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle - 1;
+        }
+    }
+    return found;
+}
+
+const std::vector<KeyframeEntry> &KeyframeIndex::getEntries() const
+{
+    return entries;
+}
+
+int KeyframeIndex::getStreamIndex() const
+{
+    return streamIndex;
+}
+
+int KeyframeIndex::getTimeBaseNum() const
+{
+    return timeBaseNum;
+}
+
+int KeyframeIndex::getTimeBaseDen() const
+{
+    return timeBaseDen;
+}
+
+bool KeyframeIndex::isFromCache() const
+{
+    return fromCache;
+}
+
+// 打印索引摘要
+void KeyframeIndex::printSummary() const
+{
+    uint32_t maxGop = 0;
+    int64_t packetCount = 0;
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        packetCount += entries[i].gopLength;
+        if (entries[i].gopLength > maxGop)
+        {
+            maxGop = entries[i].gopLength;
+        }
+    }
+    double averageGop = entries.empty() ? 0.0 : static_cast<double>(packetCount) / entries.size();
+
+    std::cout << "关键帧索引: " << entries.size() << " 个关键帧，平均GOP " << averageGop << " 帧，最长GOP "
+              << maxGop << " 帧 (" << (fromCache ? "使用缓存" : "重新扫描") << ")" << std::endl;
+}
+
+// 默认索引文件路径
+std::string KeyframeIndex::defaultIndexPath(const std::string &inputFile)
+{
+    return inputFile + KEYFRAME_INDEX_SUFFIX;
+}
@@ -0,0 +1,214 @@
+#include "../include/MediaPool.h"
+#include <iostream>
+#include <vector>
+#include <mutex>
+#include <atomic>
+
+// 引入FFmpeg头文件
+extern "C"
+{
+#include "ffmpeg/include_ffmpeg/libavcodec/avcodec.h"
+#include "ffmpeg/include_ffmpeg/libavutil/frame.h"
+}
+
+// 每个线程本地缓存的外壳数上限，超过后批量归还到全局池
+#define MEDIA_POOL_LOCAL_MAX 64
+// 本地缓存与全局池之间每次搬运的数量
+#define MEDIA_POOL_BATCH 32
+// 全局池最多保留的空闲外壳数，超出部分直接释放
+#define MEDIA_POOL_SHARED_MAX 4096
+
+namespace
+{
+    // 单一类型外壳的对象池，alloc/reset/free 由具体类型提供
+    template <typename T>
+    class ShellPool
+    {
+    public:
+        typedef T *(*AllocFunc)();
+        typedef void (*ResetFunc)(T *);
+        typedef void (*FreeFunc)(T **);
+
+        ShellPool(AllocFunc allocFunc, ResetFunc resetFunc, FreeFunc freeFunc)
+            : allocFunc(allocFunc), resetFunc(resetFunc), freeFunc(freeFunc), hits(0), misses(0)
+        {
+        }
+
+        T *acquire()
+        {
+            LocalCache &cache = localCache();
+            if (cache.items.empty())
+            {
+                refill(cache.items);
+            }
+
+            if (!cache.items.empty())
+            {
+                T *item = cache.items.back();
+                cache.items.pop_back();
+                hits.fetch_add(1, std::memory_order_relaxed);
+                return item;
+            }
+
+            misses.fetch_add(1, std::memory_order_relaxed);
+            return allocFunc();
+        }
+
+        void release(T *item)
+        {
+            if (!item)
+            {
+                return;
+            }
+
+            // 先释放引用的数据，池中只保留干净的外壳
+            resetFunc(item);
+
+            LocalCache &cache = localCache();
+            cache.items.push_back(item);
+            if (cache.items.size() > MEDIA_POOL_LOCAL_MAX)
+            {
+                spill(cache.items, MEDIA_POOL_BATCH);
+            }
+        }
+
+        uint64_t getHits() const { return hits.load(std::memory_order_relaxed); }
+        uint64_t getMisses() const { return misses.load(std::memory_order_relaxed); }
+
+        size_t getPooled()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return shared.size();
+        }
+
+    private:
+        // 线程本地缓存，线程退出时把剩余外壳归还到全局池
+        struct LocalCache
+        {
+            ShellPool *owner;
+            std::vector<T *> items;
+
+            explicit LocalCache(ShellPool *owner) : owner(owner)
+            {
+                items.reserve(MEDIA_POOL_LOCAL_MAX + 1);
+            }
+
+            ~LocalCache()
+            {
+                owner->spill(items, items.size());
+            }
+        };
+
+        LocalCache &localCache()
+        {
+            static thread_local LocalCache cache(this);
+            return cache;
+        }
+
+        // 从全局池批量取到本地缓存
+        void refill(std::vector<T *> &items)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            size_t count = shared.size() < MEDIA_POOL_BATCH ? shared.size() : MEDIA_POOL_BATCH;
+            items.insert(items.end(), shared.end() - count, shared.end());
+            shared.resize(shared.size() - count);
+        }
+
+        // 把本地缓存末尾的count个外壳归还到全局池，全局池已满的部分直接释放
+        void spill(std::vector<T *> &items, size_t count)
+        {
+            std::vector<T *> overflow;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (size_t i = 0; i < count; i++)
+                {
+                    T *item = items.back();
+                    items.pop_back();
+                    if (shared.size() < MEDIA_POOL_SHARED_MAX)
+                    {
+                        shared.push_back(item);
+                    }
+                    else
+                    {
+                        overflow.push_back(item);
+                    }
+                }
+            }
+
+            for (size_t i = 0; i < overflow.size(); i++)
+            {
+                freeFunc(&overflow[i]);
+            }
+        }
+
+        AllocFunc allocFunc;
+        ResetFunc resetFunc;
+        FreeFunc freeFunc;
+
+        std::mutex mutex;
+        std::vector<T *> shared;
+
+        std::atomic<uint64_t> hits;
+        std::atomic<uint64_t> misses;
+    };
+
+    // 池对象有意不析构：进程退出时可能仍有静态对象持有句柄并归还外壳
+    ShellPool<AVPacket> &packetPool()
+    {
+        static ShellPool<AVPacket> *pool = new ShellPool<AVPacket>(av_packet_alloc, av_packet_unref, av_packet_free);
+        return *pool;
+    }
+
+    ShellPool<AVFrame> &framePool()
+    {
+        static ShellPool<AVFrame> *pool = new ShellPool<AVFrame>(av_frame_alloc, av_frame_unref, av_frame_free);
+        return *pool;
+    }
+}
+
+// 获取空的AVPacket
+AVPacket *MediaPool::acquirePacket()
+{
+    return packetPool().acquire();
+}
+
+// 归还AVPacket
+void MediaPool::releasePacket(AVPacket *packet)
+{
+    packetPool().release(packet);
+}
+
+// 获取空的AVFrame
+AVFrame *MediaPool::acquireFrame()
+{
+    return framePool().acquire();
+}
+
+// 归还AVFrame
+void MediaPool::releaseFrame(AVFrame *frame)
+{
+    framePool().release(frame);
+}
+
+// 获取统计信息
+MediaPoolStats MediaPool::getStats()
+{
+    MediaPoolStats stats;
+    stats.packetHits = packetPool().getHits();
+    stats.packetMisses = packetPool().getMisses();
+    stats.frameHits = framePool().getHits();
+    stats.frameMisses = framePool().getMisses();
+    stats.pooledPackets = packetPool().getPooled();
+    stats.pooledFrames = framePool().getPooled();
+    return stats;
+}
+
+// 打印统计信息
+void MediaPool::printStats()
+{
+    MediaPoolStats stats = getStats();
+    std::cout << "对象池: AVPacket 复用 " << stats.packetHits << " 次，新分配 " << stats.packetMisses
+              << " 次，空闲 " << stats.pooledPackets << " 个" << std::endl;
+    std::cout << "对象池: AVFrame 复用 " << stats.frameHits << " 次，新分配 " << stats.frameMisses
+              << " 次，空闲 " << stats.pooledFrames << " 个" << std::endl;
+}
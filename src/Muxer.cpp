@@ -2,13 +2,14 @@
 #include <iostream>
 #include <chrono>
 #include <iomanip> // 用于格式化输出
-#include <cmath>   // 用于数学计算
+#include <cstring>
 
 // 引入FFmpeg头文件
 extern "C"
 {
 #include "../ffmpeg/include_ffmpeg/libavformat/avformat.h"
 #include "../ffmpeg/include_ffmpeg/libavcodec/avcodec.h"
+#include "../ffmpeg/include_ffmpeg/libavcodec/bsf.h"
 #include "../ffmpeg/include_ffmpeg/libavutil/avutil.h"
 #include "../ffmpeg/include_ffmpeg/libavutil/time.h"
 #include "../ffmpeg/include_ffmpeg/libavutil/mathematics.h"
@@ -21,19 +22,32 @@ Muxer::Muxer(VideoPacketQueue &videoQueue, AudioPacketQueue &audioQueue)
       videoCodecContext(nullptr),
       audioStream(nullptr),
       audioCodecContext(nullptr),
+      videoCopyContext(nullptr),
+      audioCopyContext(nullptr),
+      videoBsf(nullptr),
+      audioBsf(nullptr),
+      videoCopyStartTime(AV_NOPTS_VALUE),
+      audioCopyStartTime(AV_NOPTS_VALUE),
       videoPacketQueue(videoQueue),
       audioPacketQueue(audioQueue),
       isRunning(false),
       isPaused(false),
       outputFile(""),
+      defaultIoOpen(nullptr),
+      trailerPending(false),
       videoPacketCount(0),
       audioPacketCount(0),
       playbackSpeed(1.0),
-      lastVideoPts(AV_NOPTS_VALUE),
+      speedNum(1),
+      speedDen(1),
       lastVideoDts(AV_NOPTS_VALUE),
-      lastAudioPts(AV_NOPTS_VALUE),
-      lastAudioDts(AV_NOPTS_VALUE)
+      lastAudioDts(AV_NOPTS_VALUE),
+      timestampViolations(0),
+      interleaveSequence(0)
 {
+    // 同时等待音视频两个队列
+    videoPacketQueue.addNotifier(&queueNotifier);
+    audioPacketQueue.addNotifier(&queueNotifier);
 }
 
 // 析构函数
@@ -41,22 +55,129 @@ Muxer::~Muxer()
 {
     stop();
     closeMuxer();
+
+    avcodec_free_context(&videoCopyContext);
+    avcodec_free_context(&audioCopyContext);
+
+    videoPacketQueue.removeNotifier(&queueNotifier);
+    audioPacketQueue.removeNotifier(&queueNotifier);
 }
 
 // 初始化复用器
-bool Muxer::init(const std::string &outputFile, AVCodecContext *videoCodecCtx, AVCodecContext *audioCodecCtx)
+bool Muxer::init(const std::string &outputFile, AVCodecContext *videoCodecCtx, AVCodecContext *audioCodecCtx,
+                 const MuxerOptions &options)
 {
-    // 保存输出文件路径
+    // 保存输出文件路径和复用器参数
     this->outputFile = outputFile;
+    this->options = options;
 
-    // 保存编码器上下文
-    this->videoCodecContext = videoCodecCtx;
-    this->audioCodecContext = audioCodecCtx;
+    // 保存编码器上下文（流复制的流使用由源流参数构造的上下文）
+    this->videoCodecContext = videoCopyContext ? videoCopyContext : videoCodecCtx;
+    this->audioCodecContext = audioCopyContext ? audioCopyContext : audioCodecCtx;
 
     // 初始化复用器
     return initMuxer();
 }
 
+namespace
+{
+    // 流复制时目标容器需要的比特流滤镜，不需要时返回nullptr
+    const char *selectCopyBitstreamFilter(const AVCodecParameters *par, const AVOutputFormat *oformat)
+    {
+        const char *name = oformat ? oformat->name : "";
+
+        // avcC/hvcC（extradata首字节为1）是长度前缀格式，TS和裸流需要起始码格式
+        bool annexbOutput = strcmp(name, "mpegts") == 0 || strcmp(name, "h264") == 0 || strcmp(name, "hevc") == 0;
+        bool lengthPrefixed = par->extradata_size > 0 && par->extradata[0] == 1;
+        if (annexbOutput && lengthPrefixed)
+        {
+            if (par->codec_id == AV_CODEC_ID_H264)
+            {
+                return "h264_mp4toannexb";
+            }
+            if (par->codec_id == AV_CODEC_ID_HEVC)
+            {
+                return "hevc_mp4toannexb";
+            }
+        }
+
+        // 没有AudioSpecificConfig的AAC是ADTS流（例如来自TS），MP4/MOV/MKV/FLV需要去掉ADTS头
+        bool ascOutput = strcmp(name, "mp4") == 0 || strcmp(name, "mov") == 0 || strcmp(name, "ipod") == 0 ||
+                         strcmp(name, "matroska") == 0 || strcmp(name, "flv") == 0;
+        if (ascOutput && par->codec_id == AV_CODEC_ID_AAC && par->extradata_size == 0)
+        {
+            return "aac_adtstoasc";
+        }
+        return nullptr;
+    }
+}
+
+// 流复制：保存源流参数和时间基
+bool Muxer::setStreamCopy(bool isVideo, const AVCodecParameters *parameters, int timeBaseNum, int timeBaseDen,
+                          int64_t startTime)
+{
+    if (!parameters || timeBaseNum <= 0 || timeBaseDen <= 0)
+    {
+        std::cerr << "复用器: 流复制参数无效" << std::endl;
+        return false;
+    }
+
+    AVCodecContext *&copyContext = isVideo ? videoCopyContext : audioCopyContext;
+    avcodec_free_context(&copyContext);
+    copyContext = avcodec_alloc_context3(nullptr);
+    if (!copyContext || avcodec_parameters_to_context(copyContext, parameters) < 0)
+    {
+        std::cerr << "复用器: 无法复制" << (isVideo ? "视频" : "音频") << "流参数" << std::endl;
+        avcodec_free_context(&copyContext);
+        return false;
+    }
+    copyContext->time_base.num = timeBaseNum;
+    copyContext->time_base.den = timeBaseDen;
+    (isVideo ? videoCopyStartTime : audioCopyStartTime) = startTime;
+
+    std::cout << "复用器: " << (isVideo ? "视频" : "音频") << "流直接复制 (" << avcodec_get_name(parameters->codec_id)
+              << ", 时间基 " << timeBaseNum << "/" << timeBaseDen << ")" << std::endl;
+    return true;
+}
+
+// 为流复制的输出流插入容器需要的比特流滤镜，输出流参数取滤镜的输出参数
+bool Muxer::initCopyBitstreamFilter(bool isVideo)
+{
+    AVStream *stream = isVideo ? videoStream : audioStream;
+    AVCodecContext *copyContext = isVideo ? videoCopyContext : audioCopyContext;
+    AVBSFContext *&bsf = isVideo ? videoBsf : audioBsf;
+
+    // 源容器的codec_tag在目标容器中不一定有效，由复用器重新选择
+    stream->codecpar->codec_tag = 0;
+
+    const char *filterName = selectCopyBitstreamFilter(stream->codecpar, formatContext->oformat);
+    if (!filterName)
+    {
+        return true;
+    }
+
+    const AVBitStreamFilter *filter = av_bsf_get_by_name(filterName);
+    if (!filter || av_bsf_alloc(filter, &bsf) < 0)
+    {
+        std::cerr << "复用器: 找不到比特流滤镜 " << filterName << std::endl;
+        return false;
+    }
+
+    avcodec_parameters_copy(bsf->par_in, stream->codecpar);
+    bsf->time_base_in = copyContext->time_base;
+    if (av_bsf_init(bsf) < 0)
+    {
+        std::cerr << "复用器: 无法初始化比特流滤镜 " << filterName << std::endl;
+        av_bsf_free(&bsf);
+        return false;
+    }
+
+    avcodec_parameters_copy(stream->codecpar, bsf->par_out);
+    stream->codecpar->codec_tag = 0;
+    std::cout << "复用器: " << (isVideo ? "视频" : "音频") << "流复制使用比特流滤镜 " << filterName << std::endl;
+    return true;
+}
+
 // 私有方法：初始化复用器
 bool Muxer::initMuxer()
 {
@@ -70,20 +191,40 @@ bool Muxer::initMuxer()
         return false;
     }
 
-    // 对于MP4格式，设置movflags以优化文件结构
-    if (formatContext->oformat && strcmp(formatContext->oformat->name, "mp4") == 0)
+    // 写文件头时传给容器的选项
+    AVDictionary *muxOptions = nullptr;
+
+    // 对于MP4/MOV格式，设置movflags以优化文件结构
+    const char *formatName = formatContext->oformat ? formatContext->oformat->name : "";
+    bool isMovFamily = strcmp(formatName, "mp4") == 0 || strcmp(formatName, "mov") == 0;
+    if (options.fragmented && isMovFamily)
     {
-        // 设置faststart标志，将moov atom放在文件前面
-        av_dict_set(&formatContext->metadata, "movflags", "faststart", 0);
+        // 分片模式：空moov + 每个分片自带moof，分片在达到最短时长后的第一个关键帧处切开
+        int fragmentMs = options.fragmentDurationMs > 0 ? options.fragmentDurationMs : 2000;
+        av_dict_set(&muxOptions, "movflags", "frag_keyframe+empty_moov+default_base_moof", 0);
+        av_dict_set_int(&muxOptions, "min_frag_duration", (int64_t)fragmentMs * 1000, 0);
 
-        // 也可以通过AVOptions设置
-        AVDictionary *opts = nullptr;
-        av_dict_set(&opts, "movflags", "faststart", 0);
+        // 分片数据在写完整个分片前缓存在内存中，每个包后刷新输出缓冲的开销很小，
+        // 却能保证已完成的分片及时落盘
+        formatContext->flags |= AVFMT_FLAG_FLUSH_PACKETS;
+        std::cout << "复用器: 使用分片MP4输出，分片最短时长 " << fragmentMs << "ms" << std::endl;
+    }
+    else
+    {
+        if (options.fragmented)
+        {
+            std::cerr << "复用器: 输出格式 " << formatName << " 不支持分片模式，按普通文件输出" << std::endl;
+            this->options.fragmented = false;
+        }
+        if (strcmp(formatName, "mp4") == 0)
+        {
+            // 设置faststart标志，写文件尾时把moov atom移到文件前面
+            av_dict_set(&muxOptions, "movflags", "faststart", 0);
+        }
+    }
+    if (isMovFamily)
+    {
         formatContext->flags |= AVFMT_FLAG_GENPTS;
-
-        // 如果需要，可以在写入文件头时使用这些选项
-        // 保存选项以便在avformat_write_header中使用
-        av_dict_free(&opts);
     }
 
     // 添加视频流（如果有视频编码器）
@@ -106,6 +247,12 @@ bool Muxer::initMuxer()
             return false;
         }
 
+        if (videoCopyContext && !initCopyBitstreamFilter(true))
+        {
+            closeMuxer();
+            return false;
+        }
+
         // 设置时间基
         videoStream->time_base = videoCodecContext->time_base;
         std::cout << "视频流时间基: " << videoStream->time_base.num << "/" << videoStream->time_base.den << std::endl;
@@ -131,6 +278,12 @@ bool Muxer::initMuxer()
             return false;
         }
 
+        if (audioCopyContext && !initCopyBitstreamFilter(false))
+        {
+            closeMuxer();
+            return false;
+        }
+
         // 设置时间基
         audioStream->time_base = audioCodecContext->time_base;
         std::cout << "音频流时间基: " << audioStream->time_base.num << "/" << audioStream->time_base.den << std::endl;
@@ -142,28 +295,45 @@ bool Muxer::initMuxer()
     // 打开输出文件
     if (!(formatContext->oformat->flags & AVFMT_NOFILE))
     {
-        // 创建选项字典
-        AVDictionary *opts = nullptr;
-        av_dict_set(&opts, "movflags", "faststart", 0);
-
-        ret = avio_open(&formatContext->pb, outputFile.c_str(), AVIO_FLAG_WRITE);
+        ret = -1;
+        if (options.writeBehind)
+        {
+            // 后台写文件：自定义AVIOContext，由写线程合并成大块pwrite；打开失败时回退到avio_open
+            if (asyncWriter.open(outputFile, options.writeOptions))
+            {
+                formatContext->pb = asyncWriter.getIOContext();
+                formatContext->flags |= AVFMT_FLAG_CUSTOM_IO;
+                formatContext->opaque = this;
+                defaultIoOpen = formatContext->io_open;
+                formatContext->io_open = &Muxer::openNestedIO;
+                ret = 0;
+            }
+            else
+            {
+                std::cerr << "复用器: 无法使用后台写文件，改用普通输出" << std::endl;
+                this->options.writeBehind = false;
+            }
+        }
+        if (ret < 0)
+        {
+            ret = avio_open(&formatContext->pb, outputFile.c_str(), AVIO_FLAG_WRITE);
+        }
         if (ret < 0)
         {
             std::cerr << "无法打开输出文件: " << outputFile << std::endl;
-            av_dict_free(&opts);
+            av_dict_free(&muxOptions);
             closeMuxer();
             return false;
         }
-
-        // 写入文件头
-        ret = avformat_write_header(formatContext, &opts);
-        av_dict_free(&opts);
     }
-    else
+
+    // 写入文件头
+    ret = avformat_write_header(formatContext, &muxOptions);
+    if (av_dict_count(muxOptions) > 0)
     {
-        // 写入文件头
-        ret = avformat_write_header(formatContext, nullptr);
+        std::cerr << "复用器: 有 " << av_dict_count(muxOptions) << " 个容器选项未被识别" << std::endl;
     }
+    av_dict_free(&muxOptions);
 
     if (ret < 0)
     {
@@ -171,12 +341,12 @@ bool Muxer::initMuxer()
         closeMuxer();
         return false;
     }
+    trailerPending = true;
 
     // 重置时间戳跟踪变量
-    lastVideoPts = AV_NOPTS_VALUE;
     lastVideoDts = AV_NOPTS_VALUE;
-    lastAudioPts = AV_NOPTS_VALUE;
     lastAudioDts = AV_NOPTS_VALUE;
+    timestampViolations = 0;
 
     std::cout << "复用器初始化成功，输出文件: " << outputFile << std::endl;
     return true;
@@ -187,18 +357,25 @@ void Muxer::closeMuxer()
 {
     if (formatContext)
     {
-        // 写入文件尾（如果文件已经打开）
-        if (formatContext->pb)
+        // 复用线程没有正常结束时在这里补写文件尾，已经写过的不再重复写入
+        if (trailerPending && formatContext->pb)
         {
-            // 确保写入文件尾
             av_write_trailer(formatContext);
-
-            // 刷新缓冲区
             avio_flush(formatContext->pb);
         }
+        trailerPending = false;
 
-        // 关闭输出文件
-        if (formatContext->pb && !(formatContext->oformat->flags & AVFMT_NOFILE))
+        // 关闭输出文件（后台写文件时等写线程写完并按策略同步）
+        if (asyncWriter.isOpen())
+        {
+            if (!asyncWriter.close())
+            {
+                std::cerr << "复用器: 后台写文件未能完整写入: " << outputFile << std::endl;
+            }
+            asyncWriter.printStats();
+            formatContext->pb = nullptr;
+        }
+        else if (formatContext->pb && !(formatContext->oformat->flags & AVFMT_NOFILE))
         {
             avio_closep(&formatContext->pb);
         }
@@ -208,6 +385,10 @@ void Muxer::closeMuxer()
         formatContext = nullptr;
     }
 
+    // 比特流滤镜随输出流重建（流复制参数保留，重试初始化时仍然有效）
+    av_bsf_free(&videoBsf);
+    av_bsf_free(&audioBsf);
+
     // 重置流指针
     videoStream = nullptr;
     audioStream = nullptr;
@@ -229,6 +410,7 @@ void Muxer::start()
     isPaused = false;
 
     // 创建复用线程
+    completion.reset();
     muxThread = std::thread(&Muxer::muxThreadFunc, this);
 }
 
@@ -241,30 +423,12 @@ void Muxer::stop()
     }
 
     isRunning = false;
+    queueNotifier.notify();
 
-    // 等待线程结束
+    // 复用线程等待时会被通知器唤醒，随后检查isRunning退出，这里直接join
     if (muxThread.joinable())
     {
-        // 设置超时，防止无限等待
-        auto timeout = std::chrono::seconds(5);
-        auto start = std::chrono::steady_clock::now();
-
-        while (muxThread.joinable() &&
-               std::chrono::steady_clock::now() - start < timeout)
-        {
-            // 尝试等待一小段时间
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        }
-
-        // 如果线程仍在运行，强制结束
-        if (muxThread.joinable())
-        {
-            std::cerr << "警告: 复用线程未能在超时时间内结束，强制结束" << std::endl;
-            // 在实际生产环境中，这里应该使用更安全的方法来终止线程
-            // 但在C++中没有标准的安全方法来强制终止线程
-            // 这里我们仍然调用join()，但已经设置了isRunning为false，线程应该会退出
-            muxThread.join();
-        }
+        muxThread.join();
     }
 
     // 关闭复用器
@@ -275,267 +439,316 @@ void Muxer::stop()
 void Muxer::pause(bool pause)
 {
     isPaused = pause;
+    queueNotifier.notify();
 }
 
-// 复用线程函数
-void Muxer::muxThreadFunc()
+// 等待复用线程完成
+bool Muxer::waitForCompletion(std::chrono::milliseconds timeout)
 {
-    AVPacket *packet = nullptr;
-    bool videoFinished = !videoStream;
-    bool audioFinished = !audioStream;
+    return completion.waitFor(timeout);
+}
 
-    // 添加超时机制，防止无限等待
-    int emptyQueueCount = 0;
-    const int MAX_EMPTY_COUNT = 100; // 如果连续100次队列为空，则认为处理完成
+// 复用线程是否已完成
+bool Muxer::isCompleted() const
+{
+    return completion.isDone();
+}
 
-    // 记录上一个音频包的时间戳，用于检测不连续性
-    int64_t lastAudioPts = AV_NOPTS_VALUE;
-    int64_t lastVideoPts = AV_NOPTS_VALUE;
+// 包时间戳所在的时间基：编码器时间基，视频流再按播放速度缩放（时间基除以速度，
+// 即时间戳乘以 1/速度）。音频已由atempo滤镜按速度重采样，样本计数的时间戳本身就是
+// 倍速后的时间线，不再缩放
+AVRational Muxer::sourceTimeBase(bool isVideo) const
+{
+    AVRational timeBase = isVideo ? videoCodecContext->time_base : audioCodecContext->time_base;
+    if (isVideo && (speedNum != speedDen))
+    {
+        AVRational speed = {speedNum, speedDen};
+        timeBase = av_div_q(timeBase, speed);
+    }
+    return timeBase;
+}
 
-    // 记录最后一个音频包的时间（秒）
-    double lastAudioTimeSec = 0.0;
-    double lastVideoTimeSec = 0.0;
+// 交织器排序键：包的DTS（没有DTS时用PTS）换算到微秒
+int64_t Muxer::interleaveKey(const AVPacket *packet, MuxInput &input)
+{
+    int64_t timestamp = packet->dts != AV_NOPTS_VALUE ? packet->dts : packet->pts;
+    if (timestamp != AV_NOPTS_VALUE)
+    {
+        // 按输出时间线排序，倍速变换与写出时一致
+        input.lastKey = av_rescale_q(timestamp, sourceTimeBase(input.isVideo), AV_TIME_BASE_Q);
+    }
+    return input.lastKey;
+}
 
-    // 记录音频流中断的检测变量
-    int audioSilenceCount = 0;
-    const int MAX_AUDIO_SILENCE = 50; // 如果连续50次没有音频包，检查是否中断
-    bool audioStreamInterrupted = false;
+// 从各输入队列非阻塞地取包放入交织器，每条流最多预读MUXER_MAX_LOOKAHEAD个包
+void Muxer::pullPackets()
+{
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+        MuxInput &input = inputs[i];
+        while (!input.finished && input.buffered < MUXER_MAX_LOOKAHEAD)
+        {
+            AVPacketPtr packet;
+            if (!input.queue->tryPop(packet))
+            {
+                // 上游已关闭且没有剩余数据的流视为结束（例如编码器异常退出未发送EOF标记包）
+                if (input.queue->isDrained())
+                {
+                    drainBitstreamFilter(static_cast<int>(i), true);
+                    input.finished = true;
+                    std::cout << "【调试】" << input.name << "包队列已关闭，" << input.name << "流结束" << std::endl;
+                }
+                break;
+            }
 
-    // 交替处理视频和音频包的计数器
-    int packetCounter = 0;
+            if (!packet)
+            {
+                continue;
+            }
 
-    // 音视频同步相关变量
-    double audioVideoSyncThreshold = 0.5; // 音视频同步阈值（秒）
-    bool needSync = false;
+            // 空包表示该流结束
+            if (!packet->data)
+            {
+                drainBitstreamFilter(static_cast<int>(i), true);
+                input.finished = true;
+                std::cout << "【调试】" << input.name << "流结束标记已处理" << std::endl;
+                break;
+            }
 
-    // 调试信息：打印倍速设置
-    std::cout << "【调试】复用线程启动，当前播放速度: " << playbackSpeed << "倍速" << std::endl;
+            // 流复制的包先经过比特流滤镜，滤镜可能缓存或拆分包
+            if (input.bsf)
+            {
+                if (av_bsf_send_packet(input.bsf, packet.get()) < 0)
+                {
+                    std::cerr << "【调试-错误】" << input.name << "包送入比特流滤镜失败，丢弃" << std::endl;
+                    continue;
+                }
+                drainBitstreamFilter(static_cast<int>(i), false);
+                continue;
+            }
 
-    // 调试信息：记录处理速度
-    auto startTime = std::chrono::steady_clock::now();
-    int packetProcessedCount = 0;
-    const int REPORT_INTERVAL = 500; // 每处理500个包报告一次
+            queuePacket(packet, static_cast<int>(i));
+        }
+    }
+}
 
-    while (isRunning && (!videoFinished || !audioFinished))
+// 把一个包放入交织器（流复制的包先减去起始偏移）
+void Muxer::queuePacket(AVPacketPtr &packet, int index)
+{
+    MuxInput &input = inputs[index];
+    if (input.timestampOffset != 0)
     {
-        // 如果暂停，则等待
-        if (isPaused)
+        if (packet->pts != AV_NOPTS_VALUE)
         {
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
-            continue;
+            packet->pts -= input.timestampOffset;
         }
+        if (packet->dts != AV_NOPTS_VALUE)
+        {
+            packet->dts -= input.timestampOffset;
+        }
+    }
+
+    InterleaveEntry entry;
+    entry.key = interleaveKey(packet.get(), input);
+    entry.sequence = interleaveSequence++;
+    entry.input = index;
+    entry.packet = packet.release();
+    interleaveHeap.push(entry);
+    input.buffered++;
+}
+
+// 取出比特流滤镜中所有可用的包放入交织器；流结束时（flush）先冲刷滤镜
+void Muxer::drainBitstreamFilter(int index, bool flush)
+{
+    MuxInput &input = inputs[index];
+    if (!input.bsf)
+    {
+        return;
+    }
 
-        bool processedPacket = false;
-        packetCounter++;
+    if (flush)
+    {
+        av_bsf_send_packet(input.bsf, nullptr);
+    }
 
-        // 调试信息：定期打印队列状态
-        if (packetCounter % 1000 == 0)
+    while (true)
+    {
+        AVPacketPtr filtered = allocPacket();
+        if (!filtered || av_bsf_receive_packet(input.bsf, filtered.get()) < 0)
         {
-            std::cout << "【调试】队列状态 - 视频: " << videoPacketQueue.getSize()
-                      << " 包, 音频: " << audioPacketQueue.getSize() << " 包" << std::endl;
+            break;
         }
+        queuePacket(filtered, index);
+    }
+}
 
-        // 交替处理视频和音频包，确保音频包得到及时处理
-        // 在倍速播放时，优先处理音频包，以保持音频流畅
-        bool tryAudioFirst = (playbackSpeed != 1.0) || (packetCounter % 2 == 0);
-
-        // 音视频同步相关变量
-        // 根据播放速度调整同步阈值，倍速播放时允许更大的差异
-        double adjustedSyncThreshold = audioVideoSyncThreshold;
-        if (playbackSpeed > 1.0)
+// 堆顶的包能否写出：所有未结束的流都至少缓存了一个包时，堆顶就是全局DTS最小的包；
+// 某条流预读已满时不再等待最慢的流，避免快的一路反压到解复用器
+bool Muxer::canWriteHead(bool &forced) const
+{
+    forced = false;
+    bool starved = false;
+    bool lookaheadFull = false;
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+        const MuxInput &input = inputs[i];
+        if (!input.finished && input.buffered == 0)
+        {
+            starved = true;
+        }
+        if (input.buffered >= MUXER_MAX_LOOKAHEAD)
         {
-            // 倍速播放时，增加同步阈值，避免过度调整
-            // 使用改进的阈值计算方法，更加平滑
-            adjustedSyncThreshold = audioVideoSyncThreshold * sqrt(playbackSpeed);
+            lookaheadFull = true;
+        }
+    }
 
-            // 在高速播放时，额外增加阈值容忍度
-            if (playbackSpeed > 4.0)
-            {
-                adjustedSyncThreshold *= 1.5;
-            }
+    if (!starved)
+    {
+        return true;
+    }
+    forced = lookaheadFull;
+    return lookaheadFull;
+}
 
-            // 打印更详细的同步阈值信息
-            if (packetCounter % 500 == 0)
-            {
-                std::cout << "【调试】当前音视频同步阈值: " << adjustedSyncThreshold
-                          << " 秒 (基准值: " << audioVideoSyncThreshold
-                          << "，播放速度: " << playbackSpeed << ")" << std::endl;
-            }
-        }
+// 释放交织器中尚未写出的包
+void Muxer::clearInterleaver()
+{
+    while (!interleaveHeap.empty())
+    {
+        AVPacketPtr packet(interleaveHeap.top().packet);
+        interleaveHeap.pop();
+    }
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+        inputs[i].buffered = 0;
+    }
+}
 
-        // 检查音视频同步
-        if (lastVideoTimeSec > 0 && lastAudioTimeSec > 0 &&
-            fabs(lastAudioTimeSec - lastVideoTimeSec) > adjustedSyncThreshold)
+// 复用线程函数：按DTS交织多路输入流，每次写出全局DTS最小的包
+void Muxer::muxThreadFunc()
+{
+    // 线程函数退出时（包括提前返回）发布完成信号
+    CompletionGuard completionGuard(completion);
+
+    // 建立输入流列表
+    inputs.clear();
+    if (videoStream)
+    {
+        int64_t offset = 0;
+        if (videoCopyContext && videoCopyStartTime != AV_NOPTS_VALUE)
+        {
+            offset = av_rescale_q(videoCopyStartTime, AV_TIME_BASE_Q, videoCopyContext->time_base);
+        }
+        MuxInput input = {&videoPacketQueue, videoStream, videoCodecContext, true, "视频", 0, AV_NOPTS_VALUE, false,
+                          videoBsf, offset};
+        inputs.push_back(input);
+    }
+    if (audioStream)
+    {
+        int64_t offset = 0;
+        if (audioCopyContext && audioCopyStartTime != AV_NOPTS_VALUE)
         {
-            std::cout << "【调试】音视频不同步，视频时间: " << lastVideoTimeSec
-                      << "秒, 音频时间: " << lastAudioTimeSec << "秒, 差值: "
-                      << (lastAudioTimeSec - lastVideoTimeSec) << "秒, 调整阈值: "
-                      << adjustedSyncThreshold << "秒" << std::endl;
+            offset = av_rescale_q(audioCopyStartTime, AV_TIME_BASE_Q, audioCopyContext->time_base);
+        }
+        MuxInput input = {&audioPacketQueue, audioStream, audioCodecContext, false, "音频", 0, AV_NOPTS_VALUE, false,
+                          audioBsf, offset};
+        inputs.push_back(input);
+    }
+    interleaveSequence = 0;
 
-            // 根据差值大小调整处理策略
-            if (lastAudioTimeSec > lastVideoTimeSec + adjustedSyncThreshold)
-            {
-                // 音频时间超前，优先处理视频包
-                tryAudioFirst = false;
-            }
-            else if (lastVideoTimeSec > lastAudioTimeSec + adjustedSyncThreshold)
-            {
-                // 视频时间超前，优先处理音频包
-                tryAudioFirst = true;
-            }
+    // 调试信息：打印倍速设置
+    std::cout << "【调试】复用线程启动，当前播放速度: " << playbackSpeed << "倍速" << std::endl;
 
-            needSync = true;
+    // 调试信息：记录处理速度
+    auto startTime = std::chrono::steady_clock::now();
+    int packetProcessedCount = 0;
+    int forcedWriteCount = 0;
+    const int REPORT_INTERVAL = 500; // 每处理500个包报告一次
+
+    while (isRunning)
+    {
+        // 暂停时等待恢复（pause和stop会唤醒通知器）
+        if (isPaused)
+        {
+            queueNotifier.waitFor(std::chrono::milliseconds(100), [&]
+                                  { return !isPaused || !isRunning; });
+            continue;
         }
 
-        // 尝试处理音频包（如果应该先处理音频）
-        if (tryAudioFirst && !audioFinished && !audioPacketQueue.isEmpty())
+        pullPackets();
+
+        // 写出所有可以确定顺序的包
+        bool forced = false;
+        while (!interleaveHeap.empty() && canWriteHead(forced))
         {
-            packet = static_cast<AVPacket *>(audioPacketQueue.pop());
-            if (packet)
+            InterleaveEntry entry = interleaveHeap.top();
+            interleaveHeap.pop();
+            AVPacketPtr packet(entry.packet);
+            MuxInput &input = inputs[entry.input];
+            input.buffered--;
+            if (forced)
             {
-                if (packet->data)
-                {
-                    // 重置音频静默计数
-                    audioSilenceCount = 0;
-
-                    // 更新最后一个音频包的时间（秒）
-                    if (audioCodecContext && packet->pts != AV_NOPTS_VALUE)
-                    {
-                        double currentAudioTimeSec = packet->pts * av_q2d(audioCodecContext->time_base);
-
-                        // 调试信息：打印音频时间戳跳跃
-                        if (lastAudioTimeSec > 0 && fabs(currentAudioTimeSec - lastAudioTimeSec) > 0.1)
-                        {
-                            std::cout << "【调试】音频时间戳跳跃: " << lastAudioTimeSec
-                                      << " -> " << currentAudioTimeSec
-                                      << " (差值: " << (currentAudioTimeSec - lastAudioTimeSec) << "秒)"
-                                      << std::endl;
-                        }
-
-                        lastAudioTimeSec = currentAudioTimeSec;
-
-                        // 检查音视频同步
-                        if (lastVideoTimeSec > 0 && fabs(lastAudioTimeSec - lastVideoTimeSec) > audioVideoSyncThreshold)
-                        {
-                            std::cout << "【调试】音视频不同步，音频时间: " << lastAudioTimeSec
-                                      << "秒, 视频时间: " << lastVideoTimeSec << "秒, 差值: "
-                                      << (lastAudioTimeSec - lastVideoTimeSec) << "秒" << std::endl;
-                            needSync = true;
-                        }
-                    }
-
-                    // 写入音频包
-                    if (writePacket(packet, false))
-                    {
-                        audioPacketCount++;
-                        packetProcessedCount++;
-                    }
-                    processedPacket = true;
-                }
-                else
-                {
-                    // 空包表示音频流结束
-                    audioFinished = true;
-                    std::cout << "【调试】音频流结束标记已处理" << std::endl;
-                }
-                av_packet_free(&packet);
+                forcedWriteCount++;
             }
-        }
-        // 处理视频包
-        else if (!videoFinished && !videoPacketQueue.isEmpty())
-        {
-            packet = static_cast<AVPacket *>(videoPacketQueue.pop());
-            if (packet)
+
+            if (writePacket(packet.get(), input.isVideo))
             {
-                if (packet->data)
-                {
-                    // 如果有音频流但长时间没有音频包，增加计数
-                    if (!audioFinished && audioStream)
-                    {
-                        audioSilenceCount++;
-
-                        // 检测音频流是否中断
-                        if (audioSilenceCount >= MAX_AUDIO_SILENCE && !audioStreamInterrupted)
-                        {
-                            audioStreamInterrupted = true;
-                            std::cout << "【调试】检测到音频流中断！已处理 " << audioSilenceCount
-                                      << " 个视频包但没有音频包" << std::endl;
-                        }
-                    }
-
-                    // 更新最后一个视频包的时间（秒）
-                    if (videoCodecContext && packet->pts != AV_NOPTS_VALUE)
-                    {
-                        double currentVideoTimeSec = packet->pts * av_q2d(videoCodecContext->time_base);
-
-                        // 调试信息：打印视频时间戳跳跃
-                        if (lastVideoTimeSec > 0 && fabs(currentVideoTimeSec - lastVideoTimeSec) > 0.1)
-                        {
-                            std::cout << "【调试】视频时间戳跳跃: " << lastVideoTimeSec
-                                      << " -> " << currentVideoTimeSec
-                                      << " (差值: " << (currentVideoTimeSec - lastVideoTimeSec) << "秒)"
-                                      << std::endl;
-                        }
-
-                        lastVideoTimeSec = currentVideoTimeSec;
-
-                        // 检查音视频同步
-                        if (lastAudioTimeSec > 0 && fabs(lastVideoTimeSec - lastAudioTimeSec) > audioVideoSyncThreshold)
-                        {
-                            std::cout << "【调试】音视频不同步，视频时间: " << lastVideoTimeSec
-                                      << "秒, 音频时间: " << lastAudioTimeSec << "秒, 差值: "
-                                      << (lastVideoTimeSec - lastAudioTimeSec) << "秒" << std::endl;
-                            needSync = true;
-                        }
-                    }
-
-                    // 写入视频包
-                    if (writePacket(packet, true))
-                    {
-                        videoPacketCount++;
-                        packetProcessedCount++;
-                    }
-                    processedPacket = true;
-                }
-                else
+                int &count = input.isVideo ? videoPacketCount : audioPacketCount;
+                count++;
+                packetProcessedCount++;
+
+                // 调试信息：定期报告处理速度
+                if (packetProcessedCount % REPORT_INTERVAL == 0)
                 {
-                    // 空包表示视频流结束
-                    videoFinished = true;
-                    std::cout << "【调试】视频流结束标记已处理" << std::endl;
+                    auto currentTime = std::chrono::steady_clock::now();
+                    auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(currentTime - startTime).count();
+                    double packetsPerSecond = (packetProcessedCount * 1000.0) / (elapsedMs > 0 ? elapsedMs : 1);
+
+                    std::cout << "【调试】处理速度: " << std::fixed << std::setprecision(2)
+                              << packetsPerSecond << " 包/秒, 已处理 " << packetProcessedCount
+                              << " 个包，用时 " << (elapsedMs / 1000.0) << " 秒" << std::endl;
                 }
-                av_packet_free(&packet);
             }
-        }
-        // 如果两个队列都为空，等待一段时间
-        else
-        {
-            emptyQueueCount++;
-            if (emptyQueueCount >= MAX_EMPTY_COUNT)
+
+            // 写出一个包后该流可能缺包，先补充再继续
+            if (input.buffered == 0 && !input.finished)
             {
-                std::cout << "【调试】复用器: 队列长时间为空，可能已处理完所有数据" << std::endl;
-                break;
+                pullPackets();
             }
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
         }
 
-        // 如果处理了数据包，重置空队列计数
-        if (processedPacket)
+        // 所有流都已结束且交织器已清空
+        bool allFinished = true;
+        for (size_t i = 0; i < inputs.size(); i++)
         {
-            emptyQueueCount = 0;
-
-            // 调试信息：定期报告处理速度
-            if (packetProcessedCount % REPORT_INTERVAL == 0)
-            {
-                auto currentTime = std::chrono::steady_clock::now();
-                auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(currentTime - startTime).count();
-                double packetsPerSecond = (packetProcessedCount * 1000.0) / elapsedMs;
-
-                std::cout << "【调试】处理速度: " << std::fixed << std::setprecision(2)
-                          << packetsPerSecond << " 包/秒, 已处理 " << packetProcessedCount
-                          << " 个包，用时 " << (elapsedMs / 1000.0) << " 秒" << std::endl;
-            }
+            allFinished = allFinished && inputs[i].finished;
+        }
+        if (allFinished && interleaveHeap.empty())
+        {
+            break;
         }
-    }
+
+        // 阻塞等待缺包的流（最慢的流）有新数据或被关闭
+        queueNotifier.waitFor(std::chrono::milliseconds(100), [&]
+                              {
+                                  if (!isRunning || isPaused)
+                                  {
+                                      return true;
+                                  }
+                                  for (size_t i = 0; i < inputs.size(); i++)
+                                  {
+                                      const MuxInput &input = inputs[i];
+                                      if (!input.finished && input.buffered == 0 &&
+                                          (!input.queue->isEmpty() || input.queue->isClosed()))
+                                      {
+                                          return true;
+                                      }
+                                  }
+                                  return false; });
+    }
+
+    // 提前停止时交织器中可能还有包
+    clearInterleaver();
 
     // 完成复用
     finalizeFile();
@@ -543,15 +756,21 @@ void Muxer::muxThreadFunc()
     // 调试信息：打印最终统计
     auto endTime = std::chrono::steady_clock::now();
     auto totalElapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count();
-    double avgPacketsPerSecond = ((videoPacketCount + audioPacketCount) * 1000.0) / totalElapsedMs;
+    double avgPacketsPerSecond = ((videoPacketCount + audioPacketCount) * 1000.0) / (totalElapsedMs > 0 ? totalElapsedMs : 1);
 
     std::cout << "【调试】复用线程结束，共处理 " << videoPacketCount << " 个视频包和 "
               << audioPacketCount << " 个音频包，平均处理速度: " << std::fixed
               << std::setprecision(2) << avgPacketsPerSecond << " 包/秒" << std::endl;
 
-    if (needSync)
+    if (timestampViolations > 0)
     {
-        std::cout << "【调试】警告：在处理过程中检测到音视频同步问题，这可能导致播放卡顿" << std::endl;
+        std::cout << "【调试】警告：共有 " << timestampViolations << " 个包的DTS不单调递增（上游时间戳有误）" << std::endl;
+    }
+
+    if (forcedWriteCount > 0)
+    {
+        std::cout << "【调试】警告：有 " << forcedWriteCount << " 个包因预读已满未等待最慢的流直接写出，"
+                  << "输出交织可能不够紧密" << std::endl;
     }
 }
 
@@ -572,206 +791,42 @@ bool Muxer::writePacket(AVPacket *packet, bool isVideo)
     // 设置流索引
     packet->stream_index = stream->index;
 
-    // 转换时间戳
-    AVRational srcTimeBase = isVideo ? videoCodecContext->time_base : audioCodecContext->time_base;
+    // 倍速变换已并入源时间基，与时间基转换合成一次整数有理数换算
+    AVRational srcTimeBase = sourceTimeBase(isVideo);
     AVRational dstTimeBase = stream->time_base;
+    const int rounding = AV_ROUND_NEAR_INF | AV_ROUND_PASS_MINMAX; // PASS_MINMAX 保留 AV_NOPTS_VALUE
 
     // 保存原始时间戳用于调试
     int64_t origPts = packet->pts;
     int64_t origDts = packet->dts;
-    int64_t origDuration = packet->duration;
-
-    // 调试信息：详细记录时间戳处理过程（每500个包记录一次）
-    bool detailedLog = (isVideo && videoPacketCount % 500 == 0) || (!isVideo && audioPacketCount % 500 == 0);
-
-    if (detailedLog)
-    {
-        std::cout << "【调试-详细】" << (isVideo ? "视频" : "音频") << "包 #"
-                  << (isVideo ? videoPacketCount : audioPacketCount)
-                  << " 时间戳处理开始: PTS=" << packet->pts
-                  << ", DTS=" << packet->dts
-                  << ", 持续时间=" << packet->duration
-                  << ", 源时间基=" << srcTimeBase.num << "/" << srcTimeBase.den
-                  << ", 目标时间基=" << dstTimeBase.num << "/" << dstTimeBase.den
-                  << ", 播放速度=" << playbackSpeed
-                  << std::endl;
-    }
-
-    // 处理播放速度 - 在时间基转换前应用
-    if (playbackSpeed != 1.0)
-    {
-        // 修改：对视频和音频包都应用时间戳调整
-        // 注释：音频内容通过atempo滤镜处理了速度，但时间戳也需要调整以保持同步
-
-        // 对PTS进行调整 - 使用改进的计算方法
-        if (packet->pts != AV_NOPTS_VALUE)
-        {
-            // 注意：这里需要与VideoFilter中的setpts滤镜保持一致
-            // 在VideoFilter中，对于playbackSpeed > 1.0，使用setpts=PTS/TB/playbackSpeed*TB
-            // 对于playbackSpeed < 1.0，使用setpts=PTS/TB*(1.0/playbackSpeed)*TB
-            double adjustedPts;
-            if (playbackSpeed > 1.0)
-            {
-                // 快速播放：缩短时间戳
-                adjustedPts = static_cast<double>(packet->pts) / playbackSpeed;
-            }
-            else
-            {
-                // 慢速播放：延长时间戳
-                adjustedPts = static_cast<double>(packet->pts) * (1.0 / playbackSpeed);
-            }
-
-            // 避免四舍五入导致的时间戳跳跃
-            packet->pts = static_cast<int64_t>(adjustedPts);
-
-            if (detailedLog)
-            {
-                std::cout << "【调试-详细】应用播放速度后 PTS: " << origPts << " -> " << packet->pts << std::endl;
-            }
-        }
-
-        // 对DTS进行调整 - 使用改进的计算方法
-        if (packet->dts != AV_NOPTS_VALUE)
-        {
-            // 使用更精确的计算方法
-            double adjustedDts;
-            if (playbackSpeed > 1.0)
-            {
-                // 快速播放：缩短时间戳
-                adjustedDts = static_cast<double>(packet->dts) / playbackSpeed;
-            }
-            else
-            {
-                // 慢速播放：延长时间戳
-                adjustedDts = static_cast<double>(packet->dts) * (1.0 / playbackSpeed);
-            }
 
-            // 避免四舍五入导致的时间戳跳跃
-            packet->dts = static_cast<int64_t>(adjustedDts);
-
-            if (detailedLog)
-            {
-                std::cout << "【调试-详细】应用播放速度后 DTS: " << origDts << " -> " << packet->dts << std::endl;
-            }
-        }
-
-        // 调整持续时间 - 使用更精确的计算
-        if (packet->duration > 0)
-        {
-            double adjustedDuration;
-            if (playbackSpeed > 1.0)
-            {
-                // 快速播放：缩短持续时间
-                adjustedDuration = static_cast<double>(packet->duration) / playbackSpeed;
-            }
-            else
-            {
-                // 慢速播放：延长持续时间
-                adjustedDuration = static_cast<double>(packet->duration) * (1.0 / playbackSpeed);
-            }
-            packet->duration = static_cast<int64_t>(adjustedDuration);
-
-            if (detailedLog)
-            {
-                std::cout << "【调试-详细】应用播放速度后持续时间: " << origDuration
-                          << " -> " << packet->duration << std::endl;
-            }
-        }
-    }
-
-    // 时间基转换
-    if (packet->pts != AV_NOPTS_VALUE)
+    packet->pts = av_rescale_q_rnd(packet->pts, srcTimeBase, dstTimeBase, (AVRounding)rounding);
+    packet->dts = av_rescale_q_rnd(packet->dts, srcTimeBase, dstTimeBase, (AVRounding)rounding);
+    if (packet->duration > 0)
     {
-        int64_t ptsBeforeRescale = packet->pts;
-        packet->pts = rescaleTimestamp(packet->pts, srcTimeBase, dstTimeBase, isVideo);
-
-        if (detailedLog)
-        {
-            std::cout << "【调试-详细】时间基转换后 PTS: " << ptsBeforeRescale << " -> " << packet->pts << std::endl;
-        }
+        packet->duration = av_rescale_q_rnd(packet->duration, srcTimeBase, dstTimeBase, (AVRounding)rounding);
     }
 
-    if (packet->dts != AV_NOPTS_VALUE)
+    // 如果DTS无效，使用PTS
+    if (packet->dts == AV_NOPTS_VALUE)
     {
-        int64_t dtsBeforeRescale = packet->dts;
-        packet->dts = rescaleTimestamp(packet->dts, srcTimeBase, dstTimeBase, isVideo);
-
-        if (detailedLog)
-        {
-            std::cout << "【调试-详细】时间基转换后 DTS: " << dtsBeforeRescale << " -> " << packet->dts << std::endl;
-        }
-    }
-    else
-    {
-        // 如果DTS无效，使用PTS
         packet->dts = packet->pts;
-
-        if (detailedLog)
-        {
-            std::cout << "【调试-详细】DTS无效，使用PTS: " << packet->pts << std::endl;
-        }
     }
 
-    // 确保时间戳单调递增
-    int64_t &lastPts = isVideo ? lastVideoPts : lastAudioPts;
+    // 换算是单调的，上游DTS单调时输出DTS也单调；这里只统计违反的情况，不再逐包+1修补
     int64_t &lastDts = isVideo ? lastVideoDts : lastAudioDts;
-
-    // 检查并修正PTS
-    if (lastPts != AV_NOPTS_VALUE && packet->pts <= lastPts)
+    if (lastDts != AV_NOPTS_VALUE && packet->dts != AV_NOPTS_VALUE && packet->dts <= lastDts)
     {
-        int64_t ptsBeforeCorrection = packet->pts;
-        packet->pts = lastPts + 1;
-
-        if (detailedLog || ptsBeforeCorrection < lastPts - 1000) // 如果差距很大，总是记录
-        {
-            std::cout << "【调试-警告】" << (isVideo ? "视频" : "音频") << "PTS不单调递增: "
-                      << ptsBeforeCorrection << " <= " << lastPts
-                      << "，已修正为: " << packet->pts << std::endl;
-        }
-    }
-
-    // 检查并修正DTS
-    if (lastDts != AV_NOPTS_VALUE && packet->dts <= lastDts)
-    {
-        int64_t dtsBeforeCorrection = packet->dts;
-        packet->dts = lastDts + 1;
-
-        if (detailedLog || dtsBeforeCorrection < lastDts - 1000) // 如果差距很大，总是记录
+        timestampViolations++;
+        if (timestampViolations <= 10)
         {
             std::cout << "【调试-警告】" << (isVideo ? "视频" : "音频") << "DTS不单调递增: "
-                      << dtsBeforeCorrection << " <= " << lastDts
-                      << "，已修正为: " << packet->dts << std::endl;
-        }
-    }
-
-    // 确保DTS不大于PTS（这是MP4容器的要求）
-    if (packet->dts > packet->pts)
-    {
-        int64_t dtsBeforeCorrection = packet->dts;
-        packet->dts = packet->pts;
-
-        if (detailedLog)
-        {
-            std::cout << "【调试-详细】DTS大于PTS，已修正: " << dtsBeforeCorrection
-                      << " -> " << packet->dts << std::endl;
+                      << packet->dts << " <= " << lastDts << " (原始DTS=" << origDts << ")" << std::endl;
         }
     }
-
-    // 更新上一个时间戳
-    lastPts = packet->pts;
-    lastDts = packet->dts;
-
-    // 转换持续时间
-    if (packet->duration > 0)
+    if (packet->dts != AV_NOPTS_VALUE)
     {
-        int64_t durationBeforeRescale = packet->duration;
-        packet->duration = rescaleTimestamp(packet->duration, srcTimeBase, dstTimeBase, isVideo);
-
-        if (detailedLog)
-        {
-            std::cout << "【调试-详细】时间基转换后持续时间: " << durationBeforeRescale
-                      << " -> " << packet->duration << std::endl;
-        }
+        lastDts = packet->dts;
     }
 
     // 打印调试信息（每100个包打印一次）
@@ -782,12 +837,13 @@ bool Muxer::writePacket(AVPacket *packet, bool isVideo)
                   << ", DTS=" << packet->dts
                   << ", 原始PTS=" << origPts
                   << ", 原始DTS=" << origDts
-                  << ", 播放速度=" << playbackSpeed
+                  << ", 时间基=" << srcTimeBase.num << "/" << srcTimeBase.den
+                  << " -> " << dstTimeBase.num << "/" << dstTimeBase.den
                   << std::endl;
     }
 
-    // 写入数据包
-    int ret = av_interleaved_write_frame(formatContext, packet);
+    // 写入数据包（包已按DTS交织，不再经过libavformat的交织缓冲）
+    int ret = av_write_frame(formatContext, packet);
     if (ret < 0)
     {
         char errBuf[AV_ERROR_MAX_STRING_SIZE] = {0};
@@ -797,16 +853,6 @@ bool Muxer::writePacket(AVPacket *packet, bool isVideo)
         return false;
     }
 
-    if (detailedLog)
-    {
-        std::cout << "【调试-详细】" << (isVideo ? "视频" : "音频") << "包 #"
-                  << (isVideo ? videoPacketCount : audioPacketCount)
-                  << " 成功写入，最终时间戳: PTS=" << packet->pts
-                  << ", DTS=" << packet->dts
-                  << ", 持续时间=" << packet->duration
-                  << std::endl;
-    }
-
     return true;
 }
 
@@ -820,8 +866,14 @@ bool Muxer::finalizeFile()
 
     std::cout << "正在完成文件..." << std::endl;
 
+    if (!trailerPending)
+    {
+        return true;
+    }
+
     // 写入文件尾
     int ret = av_write_trailer(formatContext);
+    trailerPending = false;
     if (ret < 0)
     {
         char errBuf[AV_ERROR_MAX_STRING_SIZE] = {0};
@@ -842,46 +894,6 @@ bool Muxer::finalizeFile()
     return true;
 }
 
-// 时间基转换
-int64_t Muxer::rescaleTimestamp(int64_t timestamp, const AVRational &srcTimeBase, const AVRational &dstTimeBase, bool isVideo)
-{
-    // 添加对播放速度的支持，对视频和音频时间戳都进行调整
-    if (playbackSpeed != 1.0 && timestamp != AV_NOPTS_VALUE)
-    {
-        // 对于倍速播放，需要调整时间戳
-        // 注意：这里需要与VideoFilter中的setpts滤镜保持一致
-        // 在VideoFilter中，对于playbackSpeed > 1.0，使用setpts=PTS/TB/playbackSpeed*TB
-        // 对于playbackSpeed < 1.0，使用setpts=PTS/TB*(1.0/playbackSpeed)*TB
-        double adjustedTimestamp;
-        if (playbackSpeed > 1.0)
-        {
-            // 快速播放：缩短时间戳
-            adjustedTimestamp = static_cast<double>(timestamp) / playbackSpeed;
-        }
-        else
-        {
-            // 慢速播放：延长时间戳
-            adjustedTimestamp = static_cast<double>(timestamp) * (1.0 / playbackSpeed);
-        }
-
-        // 避免四舍五入导致的时间戳跳跃
-        timestamp = static_cast<int64_t>(adjustedTimestamp);
-
-        // 在调试模式下额外增加的日志
-        static int rescaleCount = 0;
-        if (++rescaleCount % 1000 == 0)
-        {
-            std::cout << "【调试】rescaleTimestamp: 原始值=" << (playbackSpeed > 1.0 ? timestamp * playbackSpeed : timestamp / playbackSpeed)
-                      << "，调整后=" << timestamp
-                      << "，播放速度=" << playbackSpeed
-                      << "，类型=" << (isVideo ? "视频" : "音频") << std::endl;
-        }
-    }
-
-    // 使用FFmpeg的时间基转换函数
-    return av_rescale_q(timestamp, srcTimeBase, dstTimeBase);
-}
-
 // 获取视频包数量
 int Muxer::getVideoPacketCount() const
 {
@@ -919,12 +931,16 @@ void Muxer::setPlaybackSpeed(double speed)
     double oldSpeed = playbackSpeed;
     playbackSpeed = speed;
 
-    std::cout << "【调试】复用器: 已设置播放速度从 " << oldSpeed << " 变为 " << playbackSpeed << "倍速" << std::endl;
+    // 速度表示为有理数（例如1.5为3/2），时间戳换算全部使用整数运算
+    AVRational speedQ = av_d2q(speed, 1000);
+    speedNum = speedQ.num;
+    speedDen = speedQ.den;
+
+    std::cout << "【调试】复用器: 已设置播放速度从 " << oldSpeed << " 变为 " << playbackSpeed
+              << "倍速 (" << speedNum << "/" << speedDen << ")" << std::endl;
 
     // 重置时间戳跟踪变量，确保在速度变化后能够正确处理时间戳
-    lastVideoPts = AV_NOPTS_VALUE;
     lastVideoDts = AV_NOPTS_VALUE;
-    lastAudioPts = AV_NOPTS_VALUE;
     lastAudioDts = AV_NOPTS_VALUE;
 }
 
@@ -933,3 +949,20 @@ double Muxer::getPlaybackSpeed() const
 {
     return playbackSpeed;
 }
+
+// 打开附加IO前先让后台写线程写完已提交的数据，保证回读输出文件时内容完整
+int Muxer::openNestedIO(AVFormatContext *s, AVIOContext **pb, const char *url, int flags, AVDictionary **options)
+{
+    Muxer *muxer = static_cast<Muxer *>(s->opaque);
+    if (muxer->asyncWriter.isOpen())
+    {
+        muxer->asyncWriter.drain();
+    }
+    return muxer->defaultIoOpen(s, pb, url, flags, options);
+}
+
+// 是否以分片MP4模式输出
+bool Muxer::isFragmented() const
+{
+    return options.fragmented;
+}
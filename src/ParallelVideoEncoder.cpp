@@ -0,0 +1,544 @@
+#include "../include/ParallelVideoEncoder.h"
+#include <iostream>
+#include <sstream>
+
+// 引入FFmpeg头文件
+extern "C"
+{
+#include "ffmpeg/include_ffmpeg/libavcodec/avcodec.h"
+#include "ffmpeg/include_ffmpeg/libavutil/frame.h"
+}
+
+// 默认分段时长（秒），与单编码器的默认GOP时长一致
+#define PARALLEL_ENCODER_DEFAULT_SEGMENT_SECONDS 2
+// 编码器EOF标记包的自定义标志
+#define PARALLEL_ENCODER_EOF_FLAG 0x100
+
+// 构造函数
+ParallelVideoEncoder::ParallelVideoEncoder(VideoFrameQueue &frameQueue, VideoPacketQueue &packetQueue)
+    : frameQueue(frameQueue),
+      packetQueue(packetQueue),
+      referenceFrames(1),
+      referencePackets(1),
+      referenceEncoder(referenceFrames, referencePackets),
+      width(0),
+      height(0),
+      frameRate(0),
+      bitRate(0),
+      codecName(""),
+      workers(1),
+      segmentFrames(0),
+      useFilter(false),
+      videoFilter(nullptr),
+      encodeCallback(nullptr),
+      isRunning(false),
+      isPaused(false),
+      activeSegments(0),
+      dispatchFinished(false),
+      frameCount(0),
+      segmentCount(0)
+{
+    std::cout << "并行视频编码器: 创建实例" << std::endl;
+}
+
+// 析构函数
+ParallelVideoEncoder::~ParallelVideoEncoder()
+{
+    stop();
+}
+
+// 初始化
+bool ParallelVideoEncoder::init(int width, int height, int frameRate, int bitRate, const std::string &codecName,
+                                const EncoderOptions &options, const ParallelEncodeOptions &parallelOptions)
+{
+    this->width = width;
+    this->height = height;
+    this->frameRate = frameRate;
+    this->bitRate = bitRate;
+    this->codecName = codecName;
+
+    workers = parallelOptions.workers > 0 ? parallelOptions.workers : 1;
+    segmentFrames = parallelOptions.segmentFrames > 0 ? parallelOptions.segmentFrames
+                                                       : frameRate * PARALLEL_ENCODER_DEFAULT_SEGMENT_SECONDS;
+    if (segmentFrames <= 0)
+    {
+        segmentFrames = 1;
+    }
+
+    // 多个编码器同时运行，未指定线程数时按CPU核数平分，避免线程数成倍超订
+    segmentOptions = options;
+    if (segmentOptions.find("threads") == segmentOptions.end())
+    {
+        unsigned int cores = std::thread::hardware_concurrency();
+        int threadsPerSegment = cores > 0 ? static_cast<int>(cores) / workers : 1;
+        std::ostringstream value;
+        value << (threadsPerSegment > 0 ? threadsPerSegment : 1);
+        segmentOptions["threads"] = value.str();
+    }
+
+    // 参考编码器与各分段参数完全相同，复用器从它获取时基和全局头（SPS/PPS）
+    if (!referenceEncoder.init(width, height, frameRate, bitRate, codecName, segmentOptions))
+    {
+        std::cerr << "并行视频编码器: 参考编码器初始化失败，编码器: " << codecName << std::endl;
+        return false;
+    }
+
+    std::cout << "并行视频编码器: 初始化成功，编码器: " << codecName << "，并行分段数: " << workers
+              << "，分段最少 " << segmentFrames << " 帧，每个分段编码线程: "
+              << referenceEncoder.getThreadCount() << std::endl;
+    return true;
+}
+
+// 设置视频滤镜
+bool ParallelVideoEncoder::setVideoFilter(VideoFilter *filter)
+{
+    if (!filter)
+    {
+        std::cerr << "并行视频编码器: 无效的滤镜指针" << std::endl;
+        return false;
+    }
+
+    videoFilter = filter;
+    useFilter = true;
+    std::cout << "并行视频编码器: 已设置视频滤镜" << std::endl;
+    return true;
+}
+
+// 设置编码回调
+void ParallelVideoEncoder::setEncodeCallback(VideoEncodeCallback callback)
+{
+    encodeCallback = callback;
+}
+
+// 启动分发和收集线程
+void ParallelVideoEncoder::start()
+{
+    if (isRunning)
+    {
+        return;
+    }
+
+    if (!referenceEncoder.getCodecContext())
+    {
+        std::cerr << "并行视频编码器: 未初始化，无法启动" << std::endl;
+        return;
+    }
+
+    isRunning = true;
+    isPaused = false;
+    activeSegments = 0;
+    dispatchFinished = false;
+
+    completion.reset();
+    dispatchThread = std::thread(&ParallelVideoEncoder::dispatchThreadFunc, this);
+    collectThread = std::thread(&ParallelVideoEncoder::collectThreadFunc, this);
+}
+
+// 停止编码（未编码完的分段被中断）
+void ParallelVideoEncoder::stop()
+{
+    if (!isRunning)
+    {
+        return;
+    }
+
+    isRunning = false;
+
+    // 唤醒等待空闲分段的分发线程
+    {
+        std::lock_guard<std::mutex> lock(segmentMutex);
+    }
+    segmentCond.notify_all();
+
+    if (dispatchThread.joinable())
+    {
+        dispatchThread.join();
+    }
+    if (collectThread.joinable())
+    {
+        collectThread.join();
+    }
+}
+
+// 暂停/恢复（暂停分发，已在编码的帧继续编码）
+void ParallelVideoEncoder::pause(bool pause)
+{
+    isPaused = pause;
+}
+
+// 等待所有分段编码完成
+bool ParallelVideoEncoder::waitForCompletion(std::chrono::milliseconds timeout)
+{
+    return completion.waitFor(timeout);
+}
+
+// 所有分段是否已编码完成
+bool ParallelVideoEncoder::isCompleted() const
+{
+    return completion.isDone();
+}
+
+// 新建一个分段并启动其编码器，失败返回nullptr
+ParallelVideoEncoder::EncodeSegment *ParallelVideoEncoder::openSegment(int index, int64_t frameOffset)
+{
+    // 队列能容纳整个分段（最多两倍最少帧数），分发线程不会因某个分段编码慢而阻塞
+    size_t capacity = static_cast<size_t>(segmentFrames) * 2 + 2;
+    std::unique_ptr<EncodeSegment> segment(new EncodeSegment(index, frameOffset, capacity));
+
+    if (!segment->encoder.init(width, height, frameRate, bitRate, codecName, segmentOptions))
+    {
+        std::cerr << "并行视频编码器: 分段 #" << index << " 的编码器初始化失败" << std::endl;
+        return nullptr;
+    }
+    segment->encoder.start();
+
+    // 立即交给收集线程，编码出的包可以边编码边输出
+    EncodeSegment *raw = segment.get();
+    {
+        std::lock_guard<std::mutex> lock(segmentMutex);
+        pendingSegments.push_back(std::move(segment));
+    }
+    segmentCond.notify_all();
+
+    segmentCount++;
+    return raw;
+}
+
+// 结束当前分段：关闭帧队列让编码器刷新，此后分发线程不再访问该分段
+void ParallelVideoEncoder::sealSegment(EncodeSegment *segment)
+{
+    if (!segment)
+    {
+        return;
+    }
+
+    segment->frames.close();
+    {
+        std::lock_guard<std::mutex> lock(segmentMutex);
+        segment->sealed = true;
+    }
+    segmentCond.notify_all();
+}
+
+// 分发线程：按切分点把帧分配到各个分段
+void ParallelVideoEncoder::dispatchThreadFunc()
+{
+    std::cout << "并行视频编码器: 分发线程开始" << std::endl;
+
+    EncodeSegment *segment = nullptr;
+    int segmentIndex = 0;
+    int64_t frameOffset = 0;
+    // 当前分段已分配的帧数（分段编码器初始化失败时这些帧被丢弃，但仍计入时间戳偏移）
+    int segmentFrameCount = 0;
+    int filterFailCount = 0;
+
+    while (isRunning)
+    {
+        if (isPaused)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+
+        AVFramePtr frame;
+        if (!frameQueue.popFor(frame, std::chrono::milliseconds(100)))
+        {
+            if (frameQueue.isDrained())
+            {
+                break;
+            }
+            continue;
+        }
+
+        if (!frame)
+        {
+            continue;
+        }
+
+        // EOF标记帧
+        if (frame->format == -1 || frame->width == 0 || frame->height == 0 || frame->data[0] == nullptr)
+        {
+            std::cout << "并行视频编码器: 收到EOF标记帧" << std::endl;
+            break;
+        }
+
+        // 切分点：达到最少帧数后的第一个源关键帧，或超过两倍最少帧数
+        bool keyFrame = frame->key_frame || frame->pict_type == AV_PICTURE_TYPE_I;
+        if (segmentFrameCount > 0 &&
+            ((segmentFrameCount >= segmentFrames && keyFrame) || segmentFrameCount >= segmentFrames * 2))
+        {
+            sealSegment(segment);
+            segment = nullptr;
+            frameOffset += segmentFrameCount;
+            segmentFrameCount = 0;
+        }
+
+        // 新分段：等待有空闲的编码器
+        if (segmentFrameCount == 0)
+        {
+            {
+                std::unique_lock<std::mutex> lock(segmentMutex);
+                segmentCond.wait(lock, [this]
+                                 { return activeSegments < workers || !isRunning; });
+                if (!isRunning)
+                {
+                    break;
+                }
+                activeSegments++;
+            }
+
+            segment = openSegment(segmentIndex++, frameOffset);
+            if (!segment)
+            {
+                std::lock_guard<std::mutex> lock(segmentMutex);
+                activeSegments--;
+            }
+        }
+
+        segmentFrameCount++;
+        frameCount++;
+
+        if (!segment)
+        {
+            continue;
+        }
+
+        // 滤镜有状态，必须按顺序在切分之前应用
+        AVFramePtr frameToEncode = std::move(frame);
+        if (useFilter && videoFilter)
+        {
+            AVFramePtr filteredFrame = allocFrame();
+            if (filteredFrame && videoFilter->processFrame(frameToEncode.get(), filteredFrame.get()))
+            {
+                frameToEncode = std::move(filteredFrame);
+                filterFailCount = 0;
+            }
+            else
+            {
+                filterFailCount++;
+                std::cerr << "并行视频编码器: 滤镜处理失败 (" << filterFailCount << " 次)，使用原始帧" << std::endl;
+                if (filterFailCount > 10)
+                {
+                    std::cerr << "并行视频编码器: 滤镜连续失败次数过多，禁用滤镜" << std::endl;
+                    useFilter = false;
+                }
+            }
+        }
+
+        if (segment->frames.push(std::move(frameToEncode)))
+        {
+            segment->frameCount++;
+        }
+    }
+
+    sealSegment(segment);
+
+    {
+        std::lock_guard<std::mutex> lock(segmentMutex);
+        dispatchFinished = true;
+    }
+    segmentCond.notify_all();
+
+    std::cout << "并行视频编码器: 分发线程结束，共 " << frameCount << " 帧，" << segmentCount << " 个分段" << std::endl;
+}
+
+// 输出一个分段的所有编码包，返回输出的包数
+int ParallelVideoEncoder::collectSegment(EncodeSegment &segment)
+{
+    int packets = 0;
+    bool stopped = false;
+
+    while (true)
+    {
+        AVPacketPtr packet;
+        if (!segment.packets.popFor(packet, std::chrono::milliseconds(100)))
+        {
+            if (segment.packets.isDrained())
+            {
+                break;
+            }
+
+            // 中断时停止该分段的编码器，编码线程退出时会关闭包队列
+            if (!isRunning && !stopped)
+            {
+                segment.encoder.stop();
+                stopped = true;
+            }
+            continue;
+        }
+
+        // 分段编码器各自发送的EOF标记包不向下游传递，全部分段结束后统一发送一个
+        if (!packet || !packet->data || (packet->flags & PARALLEL_ENCODER_EOF_FLAG))
+        {
+            continue;
+        }
+
+        // 分段内时间戳从0开始（时基为1/帧率），加上此前所有分段的帧数即为全局时间戳；
+        // 各分段编码参数相同，B帧造成的DTS延迟也相同，拼接后的DTS保持单调
+        if (packet->pts != AV_NOPTS_VALUE)
+        {
+            packet->pts += segment.frameOffset;
+        }
+        if (packet->dts != AV_NOPTS_VALUE)
+        {
+            packet->dts += segment.frameOffset;
+        }
+
+        if (encodeCallback)
+        {
+            encodeCallback(packet.get());
+        }
+
+        size_t bytes = packet->size > 0 ? static_cast<size_t>(packet->size) : 0;
+        if (packetQueue.push(std::move(packet), bytes))
+        {
+            packets++;
+        }
+    }
+
+    return packets;
+}
+
+// 收集线程：按分段顺序输出编码包
+void ParallelVideoEncoder::collectThreadFunc()
+{
+    // 线程函数退出时发布完成信号
+    CompletionGuard completionGuard(completion);
+
+    std::cout << "并行视频编码器: 收集线程开始" << std::endl;
+
+    auto startTime = std::chrono::steady_clock::now();
+    int64_t totalPackets = 0;
+
+    while (true)
+    {
+        std::unique_ptr<EncodeSegment> segment;
+        {
+            std::unique_lock<std::mutex> lock(segmentMutex);
+            segmentCond.wait(lock, [this]
+                             { return !pendingSegments.empty() || dispatchFinished; });
+            if (pendingSegments.empty())
+            {
+                break;
+            }
+            segment = std::move(pendingSegments.front());
+            pendingSegments.pop_front();
+        }
+
+        int packets = collectSegment(*segment);
+        totalPackets += packets;
+
+        // 编码线程已退出，回收线程；等分发线程完全放手后再销毁分段
+        segment->encoder.stop();
+        {
+            std::unique_lock<std::mutex> lock(segmentMutex);
+            EncodeSegment *raw = segment.get();
+            segmentCond.wait(lock, [raw]
+                             { return raw->sealed; });
+        }
+
+        std::cout << "并行视频编码器: 分段 #" << segment->index << " 完成，起始帧 " << segment->frameOffset
+                  << "，" << segment->frameCount << " 帧，" << packets << " 个包" << std::endl;
+        segment.reset();
+
+        {
+            std::lock_guard<std::mutex> lock(segmentMutex);
+            activeSegments--;
+        }
+        segmentCond.notify_all();
+    }
+
+    sendEOF();
+
+    double totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    std::cout << "并行视频编码器: 收集线程结束，共 " << segmentCount << " 个分段，" << totalPackets
+              << " 个包，耗时 " << totalSeconds << " 秒";
+    if (totalSeconds > 0)
+    {
+        std::cout << "，平均编码速度: " << frameCount / totalSeconds << " fps";
+    }
+    std::cout << std::endl;
+}
+
+// 向复用器发送EOF标记包并关闭输出队列
+void ParallelVideoEncoder::sendEOF()
+{
+    AVPacketPtr eofPacket = allocPacket();
+    if (eofPacket)
+    {
+        eofPacket->data = nullptr;
+        eofPacket->size = 0;
+        eofPacket->flags |= PARALLEL_ENCODER_EOF_FLAG;
+        packetQueue.push(std::move(eofPacket));
+    }
+    packetQueue.close();
+    std::cout << "并行视频编码器: 已发送EOF标记" << std::endl;
+}
+
+// 获取编码器信息
+int ParallelVideoEncoder::getWidth() const
+{
+    return width;
+}
+
+int ParallelVideoEncoder::getHeight() const
+{
+    return height;
+}
+
+int ParallelVideoEncoder::getFrameRate() const
+{
+    return frameRate;
+}
+
+int ParallelVideoEncoder::getBitRate() const
+{
+    return bitRate;
+}
+
+const char *ParallelVideoEncoder::getCodecName() const
+{
+    return referenceEncoder.getCodecName();
+}
+
+int ParallelVideoEncoder::getThreadCount() const
+{
+    return referenceEncoder.getThreadCount();
+}
+
+int ParallelVideoEncoder::getGopSize() const
+{
+    return referenceEncoder.getGopSize();
+}
+
+int ParallelVideoEncoder::getMaxBFrames() const
+{
+    return referenceEncoder.getMaxBFrames();
+}
+
+int ParallelVideoEncoder::getWorkers() const
+{
+    return workers;
+}
+
+int ParallelVideoEncoder::getSegmentFrames() const
+{
+    return segmentFrames;
+}
+
+// 获取已分发的帧数和分段数
+int ParallelVideoEncoder::getFrameCount() const
+{
+    return frameCount;
+}
+
+int ParallelVideoEncoder::getSegmentCount() const
+{
+    return segmentCount;
+}
+
+// 获取编解码器上下文
+AVCodecContext *ParallelVideoEncoder::getCodecContext() const
+{
+    return referenceEncoder.getCodecContext();
+}
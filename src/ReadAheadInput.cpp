@@ -0,0 +1,482 @@
+#include "../include/ReadAheadInput.h"
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// 引入FFmpeg头文件
+extern "C"
+{
+#include "ffmpeg/include_ffmpeg/libavformat/avio.h"
+#include "ffmpeg/include_ffmpeg/libavutil/error.h"
+#include "ffmpeg/include_ffmpeg/libavutil/mem.h"
+}
+
+// AVIOContext自身的缓冲区大小（读回调每次最多请求的字节数）
+#define READ_AHEAD_AVIO_BUFFER_SIZE (64 * 1024)
+
+namespace
+{
+    // 解析 "-"、"pipe:"、"pipe:N"，返回对应的文件描述符，不是管道写法时返回-1
+    int parsePipePath(const std::string &path)
+    {
+        if (path == "-" || path == "pipe:")
+        {
+            return STDIN_FILENO;
+        }
+        if (path.compare(0, 5, "pipe:") == 0)
+        {
+            char *end = nullptr;
+            long value = strtol(path.c_str() + 5, &end, 10);
+            if (end && *end == '\0' && value >= 0)
+            {
+                return static_cast<int>(value);
+            }
+        }
+        return -1;
+    }
+}
+
+// 构造函数
+ReadAheadInput::ReadAheadInput()
+    : ioContext(nullptr),
+      activeMode(INPUT_READ_DEFAULT),
+      fd(-1),
+      ownsFd(false),
+      seekable(false),
+      fileSize(-1),
+      position(0),
+      mapped(nullptr),
+      mappedSize(0),
+      advisedUntil(0),
+      stopping(false),
+      endOfFile(false),
+      readError(0),
+      generation(0),
+      fetchOffset(0),
+      bytesRead(0),
+      readCalls(0),
+      starvedWaits(0),
+      starvedMicros(0),
+      seekCount(0)
+{
+}
+
+// 析构函数
+ReadAheadInput::~ReadAheadInput()
+{
+    close();
+}
+
+// 打开输入，按读取方式建立映射或启动预读线程，再创建AVIOContext
+bool ReadAheadInput::open(const std::string &path, const InputReadOptions &options)
+{
+    if (options.mode == INPUT_READ_DEFAULT)
+    {
+        return false;
+    }
+    if (isOpen())
+    {
+        std::cerr << "预读输入: 输入已打开" << std::endl;
+        return false;
+    }
+
+    this->options = options;
+    if (this->options.readAheadBytes < READ_AHEAD_AVIO_BUFFER_SIZE)
+    {
+        this->options.readAheadBytes = READ_AHEAD_AVIO_BUFFER_SIZE;
+    }
+    if (this->options.chunkSize == 0 || this->options.chunkSize > this->options.readAheadBytes)
+    {
+        this->options.chunkSize = this->options.readAheadBytes;
+    }
+
+    fd = parsePipePath(path);
+    ownsFd = (fd < 0);
+    if (ownsFd)
+    {
+        fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            std::cerr << "预读输入: 无法打开输入文件: " << path << " (" << strerror(errno) << ")" << std::endl;
+            return false;
+        }
+    }
+
+    struct stat fileStat;
+    seekable = fstat(fd, &fileStat) == 0 && S_ISREG(fileStat.st_mode);
+    fileSize = seekable ? static_cast<int64_t>(fileStat.st_size) : -1;
+    position = 0;
+
+    // 普通文件优先mmap，空文件或映射失败时回退到预读线程
+    bool opened = false;
+    if (this->options.mode != INPUT_READ_PREFETCH && seekable && fileSize > 0)
+    {
+        opened = openMapped();
+    }
+    else if (this->options.mode == INPUT_READ_MMAP)
+    {
+        std::cerr << "预读输入: 输入不是可映射的普通文件，改用预读线程" << std::endl;
+    }
+    if (!opened)
+    {
+        opened = openPrefetch();
+    }
+    if (!opened)
+    {
+        close();
+        return false;
+    }
+
+    unsigned char *avioBuffer = static_cast<unsigned char *>(av_malloc(READ_AHEAD_AVIO_BUFFER_SIZE));
+    if (!avioBuffer)
+    {
+        std::cerr << "预读输入: 无法分配AVIO缓冲区" << std::endl;
+        close();
+        return false;
+    }
+
+    ioContext = avio_alloc_context(avioBuffer, READ_AHEAD_AVIO_BUFFER_SIZE, 0, this,
+                                   &ReadAheadInput::readPacket, nullptr, &ReadAheadInput::seekPacket);
+    if (!ioContext)
+    {
+        std::cerr << "预读输入: 无法创建AVIOContext" << std::endl;
+        av_free(avioBuffer);
+        close();
+        return false;
+    }
+    // 管道不能任意seek，由avio自己通过读取跳过实现前向seek
+    ioContext->seekable = seekable ? AVIO_SEEKABLE_NORMAL : 0;
+
+    std::cout << "预读输入: " << (activeMode == INPUT_READ_MMAP ? "mmap" : "预读线程") << "，预读窗口 "
+              << (this->options.readAheadBytes / 1024) << "KB" << (seekable ? "" : "，不可seek的输入") << std::endl;
+    return true;
+}
+
+// 整个文件只读映射，顺序访问建议
+bool ReadAheadInput::openMapped()
+{
+    void *memory = mmap(nullptr, static_cast<size_t>(fileSize), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (memory == MAP_FAILED)
+    {
+        std::cerr << "预读输入: mmap失败，改用预读线程 (" << strerror(errno) << ")" << std::endl;
+        return false;
+    }
+
+    mapped = static_cast<unsigned char *>(memory);
+    mappedSize = static_cast<size_t>(fileSize);
+    madvise(mapped, mappedSize, MADV_SEQUENTIAL);
+    advisedUntil = 0;
+    activeMode = INPUT_READ_MMAP;
+    return true;
+}
+
+// 分配环形缓冲区并启动预读线程
+bool ReadAheadInput::openPrefetch()
+{
+    ring.reset(new RingBuffer<unsigned char>(options.readAheadBytes, false, true));
+    stopping = false;
+    endOfFile = false;
+    readError = 0;
+    generation = 0;
+    fetchOffset = 0;
+    activeMode = INPUT_READ_PREFETCH;
+    prefetchThread = std::thread(&ReadAheadInput::prefetchThreadFunc, this);
+    return true;
+}
+
+// AVIOContext读回调
+int ReadAheadInput::readPacket(void *opaque, uint8_t *buf, int bufSize)
+{
+    return static_cast<ReadAheadInput *>(opaque)->read(buf, bufSize);
+}
+
+// AVIOContext定位回调
+int64_t ReadAheadInput::seekPacket(void *opaque, int64_t offset, int whence)
+{
+    return static_cast<ReadAheadInput *>(opaque)->seek(offset, whence);
+}
+
+// 读取（只在解复用线程中调用）
+int ReadAheadInput::read(uint8_t *buf, int size)
+{
+    if (size <= 0)
+    {
+        return 0;
+    }
+    return activeMode == INPUT_READ_MMAP ? readMapped(buf, size) : readPrefetched(buf, size);
+}
+
+// mmap模式：从映射区域拷贝，并让已建议预读的范围始终领先当前位置一个窗口
+int ReadAheadInput::readMapped(uint8_t *buf, int size)
+{
+    if (position >= static_cast<int64_t>(mappedSize))
+    {
+        return AVERROR_EOF;
+    }
+
+    // 剩余窗口不足一半时再建议下一段，madvise的起点需要按页对齐
+    int64_t window = static_cast<int64_t>(options.readAheadBytes);
+    if (advisedUntil < static_cast<int64_t>(mappedSize) && advisedUntil - position < window / 2)
+    {
+        static const int64_t pageSize = sysconf(_SC_PAGESIZE);
+        int64_t start = (advisedUntil > position ? advisedUntil : position) / pageSize * pageSize;
+        int64_t end = position + window;
+        if (end > static_cast<int64_t>(mappedSize))
+        {
+            end = static_cast<int64_t>(mappedSize);
+        }
+        madvise(mapped + start, static_cast<size_t>(end - start), MADV_WILLNEED);
+        advisedUntil = end;
+    }
+
+    int64_t count = static_cast<int64_t>(mappedSize) - position;
+    if (count > size)
+    {
+        count = size;
+    }
+    memcpy(buf, mapped + position, static_cast<size_t>(count));
+    position += count;
+    bytesRead += static_cast<uint64_t>(count);
+    return static_cast<int>(count);
+}
+
+// 预读线程模式：从环形缓冲区拷贝，缓冲区空了才等待预读线程
+int ReadAheadInput::readPrefetched(uint8_t *buf, int size)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (ring->isEmpty() && !endOfFile && readError == 0)
+    {
+        auto waitStart = std::chrono::steady_clock::now();
+        dataCond.wait(lock, [this]() { return !ring->isEmpty() || endOfFile || readError != 0 || stopping; });
+        starvedWaits++;
+        starvedMicros += std::chrono::duration_cast<std::chrono::microseconds>(
+                             std::chrono::steady_clock::now() - waitStart)
+                             .count();
+    }
+
+    if (ring->isEmpty())
+    {
+        return readError != 0 ? readError : AVERROR_EOF;
+    }
+
+    RingBufferSpans spans = ring->peekRead(static_cast<size_t>(size));
+    memcpy(buf, spans.first.data, spans.first.size);
+    if (spans.second.size > 0)
+    {
+        memcpy(buf + spans.first.size, spans.second.data, spans.second.size);
+    }
+    size_t count = ring->consumeRead(spans.totalSize());
+    position += static_cast<int64_t>(count);
+    bytesRead += count;
+    lock.unlock();
+
+    spaceCond.notify_one();
+    return static_cast<int>(count);
+}
+
+// 定位：mmap直接改位置；预读线程模式下缓冲区内的前向seek直接丢弃数据，否则清空缓冲区从新位置预读
+int64_t ReadAheadInput::seek(int64_t offset, int whence)
+{
+    if (whence & AVSEEK_SIZE)
+    {
+        return seekable ? fileSize : AVERROR(ENOSYS);
+    }
+
+    int64_t target;
+    switch (whence & ~AVSEEK_FORCE)
+    {
+    case SEEK_SET:
+        target = offset;
+        break;
+    case SEEK_CUR:
+        target = position + offset;
+        break;
+    case SEEK_END:
+        if (!seekable)
+        {
+            return AVERROR(ENOSYS);
+        }
+        target = fileSize + offset;
+        break;
+    default:
+        return AVERROR(EINVAL);
+    }
+
+    if (target < 0)
+    {
+        return AVERROR(EINVAL);
+    }
+
+    if (activeMode == INPUT_READ_MMAP)
+    {
+        if (target != position)
+        {
+            seekCount++;
+            position = target;
+            // 跳转后从新位置重新建立预读窗口
+            advisedUntil = target;
+        }
+        return target;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (target == position)
+        {
+            return target;
+        }
+
+        if (target > position && target - position <= static_cast<int64_t>(ring->getSize()))
+        {
+            ring->consumeRead(static_cast<size_t>(target - position));
+        }
+        else
+        {
+            if (!seekable)
+            {
+                return AVERROR(ESPIPE);
+            }
+            ring->clear();
+            generation++;
+            fetchOffset = target;
+            endOfFile = false;
+            readError = 0;
+        }
+        position = target;
+        seekCount++;
+    }
+    spaceCond.notify_one();
+    return target;
+}
+
+// 预读线程：缓冲区有一个chunk的空闲空间时读入一块，直到文件结束或出错
+void ReadAheadInput::prefetchThreadFunc()
+{
+    while (true)
+    {
+        uint64_t readGeneration;
+        int64_t offset;
+        RingBufferSpans spans;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            spaceCond.wait(lock, [this]() {
+                return stopping || (!endOfFile && readError == 0 && ring->getAvailableSpace() >= options.chunkSize);
+            });
+            if (stopping)
+            {
+                break;
+            }
+
+            readGeneration = generation;
+            offset = fetchOffset;
+            // 预留区域只包含空闲空间，解复用线程只会继续释放空间，解锁后可以安全写入
+            spans = ring->reserveWrite(options.chunkSize);
+        }
+
+        ssize_t count;
+        do
+        {
+            count = seekable ? pread(fd, spans.first.data, spans.first.size, offset)
+                             : ::read(fd, spans.first.data, spans.first.size);
+        } while (count < 0 && errno == EINTR);
+        int error = errno;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            readCalls++;
+            if (readGeneration != generation)
+            {
+                // 读取期间发生了seek，结果作废
+                continue;
+            }
+
+            if (count < 0)
+            {
+                std::cerr << "预读输入: 读取失败，偏移 " << offset << " (" << strerror(error) << ")" << std::endl;
+                readError = AVERROR(error);
+            }
+            else if (count == 0)
+            {
+                endOfFile = true;
+            }
+            else
+            {
+                ring->commitWrite(static_cast<size_t>(count));
+                fetchOffset += count;
+            }
+        }
+        dataCond.notify_one();
+    }
+}
+
+// 交给解复用器使用的AVIOContext
+AVIOContext *ReadAheadInput::getIOContext() const
+{
+    return ioContext;
+}
+
+// 停止预读线程，解除映射，关闭文件并释放AVIOContext
+void ReadAheadInput::close()
+{
+    if (prefetchThread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        spaceCond.notify_all();
+        dataCond.notify_all();
+        prefetchThread.join();
+    }
+    ring.reset();
+
+    if (mapped)
+    {
+        munmap(mapped, mappedSize);
+        mapped = nullptr;
+        mappedSize = 0;
+    }
+
+    if (fd >= 0 && ownsFd)
+    {
+        ::close(fd);
+    }
+    fd = -1;
+    ownsFd = false;
+
+    if (ioContext)
+    {
+        av_freep(&ioContext->buffer);
+        avio_context_free(&ioContext);
+    }
+    activeMode = INPUT_READ_DEFAULT;
+}
+
+// 输入是否已打开
+bool ReadAheadInput::isOpen() const
+{
+    return ioContext != nullptr;
+}
+
+// 获取实际使用的读取方式
+InputReadMode ReadAheadInput::getActiveMode() const
+{
+    return activeMode;
+}
+
+// 打印统计信息
+void ReadAheadInput::printStats() const
+{
+    std::cout << "预读输入: 共读取 " << (bytesRead / (1024 * 1024)) << "MB，seek " << seekCount << " 次";
+    if (readCalls > 0)
+    {
+        std::cout << "，预读线程read " << readCalls << " 次";
+    }
+    std::cout << "，解复用等待数据 " << starvedWaits << " 次共 " << (starvedMicros / 1000) << "ms" << std::endl;
+}
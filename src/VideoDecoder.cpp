@@ -12,6 +12,11 @@ extern "C"
 #include "ffmpeg/include_ffmpeg/libswscale/swscale.h"
 }
 
+// 除帧队列中的帧外，解码器自身持有的参考帧和帧线程在途帧的余量
+#define VIDEO_DECODER_EXTRA_FRAMES 8
+// 解码线程本地攒批的帧数，攒满或一个包的帧取完后一次移入帧队列
+#define VIDEO_DECODER_PUSH_BATCH 8
+
 // 构造函数
 VideoDecoder::VideoDecoder(VideoPacketQueue &packetQueue, VideoFrameQueue &decodedFrameQueue)
     : codecContext(nullptr),
@@ -21,7 +26,12 @@ VideoDecoder::VideoDecoder(VideoPacketQueue &packetQueue, VideoFrameQueue &decod
       isRunning(false),
       isPaused(false),
       frameCallback(nullptr),
-      saveToFile(false)
+      saveToFile(false),
+      useFrameBufferPool(true),
+      useHugePages(false),
+      rangeStartPts(AV_NOPTS_VALUE),
+      rangeEndPts(AV_NOPTS_VALUE),
+      rangeDiscardedFrames(0)
 {
     std::cout << "视频解码器: 创建实例" << std::endl;
 }
@@ -36,7 +46,7 @@ VideoDecoder::~VideoDecoder()
 }
 
 // 初始化解码器
-bool VideoDecoder::init(AVCodecParameters *codecPar)
+bool VideoDecoder::init(AVCodecParameters *codecPar, const DecoderThreadOptions &options)
 {
     if (!codecPar)
     {
@@ -44,10 +54,25 @@ bool VideoDecoder::init(AVCodecParameters *codecPar)
         return false;
     }
 
+    threadOptions = options;
+
     std::cout << "视频解码器: 开始初始化" << std::endl;
     return initDecoder(codecPar);
 }
 
+// 设置帧缓冲池选项
+void VideoDecoder::setFrameBufferPool(bool enable, bool hugePages)
+{
+    if (codecContext)
+    {
+        std::cerr << "视频解码器: 帧缓冲池选项必须在初始化之前设置" << std::endl;
+        return;
+    }
+
+    useFrameBufferPool = enable;
+    useHugePages = hugePages;
+}
+
 // 内部初始化解码器方法
 bool VideoDecoder::initDecoder(AVCodecParameters *codecPar)
 {
@@ -81,6 +106,35 @@ bool VideoDecoder::initDecoder(AVCodecParameters *codecPar)
 
     std::cout << "视频解码器: 已复制编解码器参数到上下文" << std::endl;
 
+    // 帧从项目自有的缓冲池分配：预分配帧队列容量加上解码器参考帧和本地批次的余量
+    if (useFrameBufferPool)
+    {
+        int prefillFrames = static_cast<int>(decodedFrameQueue.getCapacity()) + VIDEO_DECODER_EXTRA_FRAMES +
+                            VIDEO_DECODER_PUSH_BATCH;
+        frameBufferPool.attach(codecContext, prefillFrames, useHugePages);
+    }
+
+    // 设置解码线程：thread_count为0时由FFmpeg按CPU核数自动选择
+    codecContext->thread_count = threadOptions.threadCount > 0 ? threadOptions.threadCount : 0;
+    if (threadOptions.lowDelay)
+    {
+        // 帧级多线程每个线程都会延迟一帧输出，低延迟模式只使用片级多线程
+        codecContext->thread_type = FF_THREAD_SLICE;
+        codecContext->flags |= AV_CODEC_FLAG_LOW_DELAY;
+    }
+    else if (threadOptions.threadType == DECODER_THREAD_FRAME)
+    {
+        codecContext->thread_type = FF_THREAD_FRAME;
+    }
+    else if (threadOptions.threadType == DECODER_THREAD_SLICE)
+    {
+        codecContext->thread_type = FF_THREAD_SLICE;
+    }
+    else
+    {
+        codecContext->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+    }
+
     // 打开解码器
     if (avcodec_open2(codecContext, codec, nullptr) < 0)
     {
@@ -89,6 +143,14 @@ bool VideoDecoder::initDecoder(AVCodecParameters *codecPar)
         return false;
     }
 
+    // 帧级多线程时每个工作线程还各自持有一帧，补充到帧缓冲池的预分配中
+    if (useFrameBufferPool && (codecContext->active_thread_type & FF_THREAD_FRAME))
+    {
+        frameBufferPool.setPrefillFrames(static_cast<int>(decodedFrameQueue.getCapacity()) +
+                                         VIDEO_DECODER_EXTRA_FRAMES + VIDEO_DECODER_PUSH_BATCH +
+                                         codecContext->thread_count);
+    }
+
     std::cout << "视频解码器: 初始化成功" << std::endl;
     std::cout << "  解码器: " << codec->name << std::endl;
     std::cout << "  分辨率: " << codecContext->width << "x" << codecContext->height << std::endl;
@@ -98,6 +160,8 @@ bool VideoDecoder::initDecoder(AVCodecParameters *codecPar)
         std::cout << "  帧率: " << codecContext->framerate.num / codecContext->framerate.den << " fps" << std::endl;
     }
     std::cout << "  比特率: " << codecContext->bit_rate / 1000 << " kbps" << std::endl;
+    std::cout << "  解码线程: " << codecContext->thread_count << " (" << getThreadTypeName() << ")"
+              << (threadOptions.lowDelay ? "，低延迟模式" : "") << std::endl;
 
     return true;
 }
@@ -128,6 +192,7 @@ void VideoDecoder::start()
 
     std::cout << "视频解码器: 启动解码线程" << std::endl;
     // 创建解码线程
+    completion.reset();
     decodeThread = std::thread(&VideoDecoder::decodeThreadFunc, this);
 }
 
@@ -159,12 +224,46 @@ void VideoDecoder::pause(bool pause)
     std::cout << "视频解码器: " << (pause ? "暂停" : "继续") << std::endl;
 }
 
+// 等待视频解码线程完成
+bool VideoDecoder::waitForCompletion(std::chrono::milliseconds timeout)
+{
+    return completion.waitFor(timeout);
+}
+
+// 视频解码线程是否已完成
+bool VideoDecoder::isCompleted() const
+{
+    return completion.isDone();
+}
+
 // 设置帧回调
 void VideoDecoder::setFrameCallback(VideoFrameCallback callback)
 {
     frameCallback = callback;
 }
 
+// 设置时间段
+void VideoDecoder::setTimeRange(int64_t startPts, int64_t endPts)
+{
+    rangeStartPts = startPts;
+    rangeEndPts = endPts;
+}
+
+// 帧是否在时间段内：定位只能落在起点之前的关键帧上，从关键帧到起点之间的帧需要解码（作为参考帧）但不输出
+bool VideoDecoder::isFrameInRange(const AVFrame *frame) const
+{
+    int64_t pts = frame->best_effort_timestamp != AV_NOPTS_VALUE ? frame->best_effort_timestamp : frame->pts;
+    if (pts == AV_NOPTS_VALUE)
+    {
+        return true;
+    }
+    if (rangeStartPts != AV_NOPTS_VALUE && pts < rangeStartPts)
+    {
+        return false;
+    }
+    return rangeEndPts == AV_NOPTS_VALUE || pts < rangeEndPts;
+}
+
 // 设置YUV文件输出
 bool VideoDecoder::setYUVOutput(const std::string &filePath)
 {
@@ -290,29 +389,50 @@ const char *VideoDecoder::getCodecName() const
     return codec->name;
 }
 
-// 解码线程函数
-void VideoDecoder::decodeThreadFunc()
+// 获取实际解码线程数
+int VideoDecoder::getThreadCount() const
+{
+    return codecContext ? codecContext->thread_count : 0;
+}
+
+// 获取实际生效的线程类型
+const char *VideoDecoder::getThreadTypeName() const
 {
     if (!codecContext)
     {
-        std::cerr << "视频解码线程: 解码器上下文为空" << std::endl;
-        return;
+        return "unknown";
     }
 
-    // 分配AVPacket
-    AVPacket *packet = av_packet_alloc();
-    if (!packet)
+    if (codecContext->active_thread_type & FF_THREAD_FRAME)
+    {
+        return "frame";
+    }
+    if (codecContext->active_thread_type & FF_THREAD_SLICE)
     {
-        std::cerr << "视频解码线程: 无法分配AVPacket" << std::endl;
+        return "slice";
+    }
+    return "none";
+}
+
+// 解码线程函数
+void VideoDecoder::decodeThreadFunc()
+{
+    // 线程函数退出时（包括提前返回）发布完成信号
+    CompletionGuard completionGuard(completion);
+
+    if (!codecContext)
+    {
+        std::cerr << "视频解码线程: 解码器上下文为空" << std::endl;
+        decodedFrameQueue.close();
         return;
     }
 
-    // 分配AVFrame
-    AVFrame *frame = av_frame_alloc();
+    // 分配AVFrame，解码出的帧整体移入帧队列后再分配新的帧
+    AVFramePtr frame = allocFrame();
     if (!frame)
     {
         std::cerr << "视频解码线程: 无法分配AVFrame" << std::endl;
-        av_packet_free(&packet);
+        decodedFrameQueue.close();
         return;
     }
 
@@ -323,6 +443,33 @@ void VideoDecoder::decodeThreadFunc()
     int frameDecoded = 0;
     int emptyPacketCount = 0;
     int queuedFrameCount = 0;
+
+    // 本地帧批次：一次移入帧队列，只发布一次写入位置、唤醒一次编码线程
+    AVFramePtr frameBatch[VIDEO_DECODER_PUSH_BATCH];
+    size_t batchCount = 0;
+    auto flushFrameBatch = [&]()
+    {
+        if (batchCount == 0)
+        {
+            return;
+        }
+
+        int previousCount = queuedFrameCount;
+        size_t pushed = decodedFrameQueue.pushMultiple(frameBatch, nullptr, batchCount);
+        // 下游不消费帧（没有编码器时帧队列被提前关闭），丢弃剩余帧后继续解码，回调和YUV输出不受影响
+        for (size_t i = pushed; i < batchCount; i++)
+        {
+            frameBatch[i].reset();
+        }
+        batchCount = 0;
+        queuedFrameCount += static_cast<int>(pushed);
+
+        // 每10帧打印一次
+        if (queuedFrameCount / 10 != previousCount / 10)
+        {
+            std::cout << "视频解码线程: 将解码帧 #" << queuedFrameCount << " 放入队列" << std::endl;
+        }
+    };
     auto startTime = std::chrono::high_resolution_clock::now();
     bool receivedEOF = false;
 
@@ -351,25 +498,28 @@ void VideoDecoder::decodeThreadFunc()
             continue;
         }
 
-        // 从队列中获取数据包
-        void *packetData = nullptr;
-        if (!packetQueue.tryPop(packetData))
+        // 从队列中获取数据包，队列为空时阻塞等待，数据到达即被唤醒
+        AVPacketPtr pkt;
+        if (!packetQueue.popFor(pkt, std::chrono::milliseconds(100)))
         {
-            // 队列为空，等待一段时间
+            // 上游已关闭且没有剩余数据，说明不会再有EOF标记包
+            if (packetQueue.isDrained())
+            {
+                std::cout << "视频解码线程: 输入队列已关闭，结束解码" << std::endl;
+                break;
+            }
+
             emptyPacketCount++;
             if (emptyPacketCount % 20 == 0)
             {
                 std::cout << "视频解码线程: 队列持续为空 " << emptyPacketCount / 10 << " 秒" << std::endl;
             }
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
             continue;
         }
 
         // 重置空队列计数
         emptyPacketCount = 0;
 
-        // 转换为AVPacket
-        AVPacket *pkt = static_cast<AVPacket *>(packetData);
         packetCount++;
 
         // 检查是否为EOF标志包
@@ -383,9 +533,9 @@ void VideoDecoder::decodeThreadFunc()
 
             // 继续接收所有缓冲的帧
             int ret = 0;
-            while (ret >= 0)
+            while (ret >= 0 && frame)
             {
-                ret = avcodec_receive_frame(codecContext, frame);
+                ret = avcodec_receive_frame(codecContext, frame.get());
                 if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
                 {
                     break;
@@ -398,44 +548,48 @@ void VideoDecoder::decodeThreadFunc()
 
                 frameDecoded++;
 
+                // 时间段之外的帧不输出，复用该AVFrame接收下一帧
+                if (!isFrameInRange(frame.get()))
+                {
+                    rangeDiscardedFrames++;
+                    continue;
+                }
+
                 // 保存帧到YUV文件
                 if (saveToFile)
                 {
-                    saveFrameToYUV(frame);
+                    saveFrameToYUV(frame.get());
                 }
 
                 // 保存到直接YUV输出文件
                 if (directYuvFile)
                 {
-                    writeFrameToYUVFile(frame, directYuvFile);
-                }
-
-                // 将解码后的帧放入帧缓冲队列
-                AVFrame *frameCopy = av_frame_alloc();
-                if (frameCopy)
-                {
-                    av_frame_ref(frameCopy, frame);
-                    decodedFrameQueue.push(frameCopy);
-                    queuedFrameCount++;
-                    std::cout << "视频解码线程: 将解码帧 #" << queuedFrameCount << " 放入队列 (刷新阶段)" << std::endl;
+                    writeFrameToYUVFile(frame.get(), directYuvFile);
                 }
 
                 // 处理解码后的帧
                 if (frameCallback)
                 {
                     // 调用回调函数处理帧
-                    frameCallback(frame);
+                    frameCallback(frame.get());
                 }
 
-                // 重置帧以便重用
-                av_frame_unref(frame);
+                // 将解码后的帧整体放入本地批次，再为下一帧分配新的AVFrame
+                frameBatch[batchCount++] = std::move(frame);
+                if (batchCount == VIDEO_DECODER_PUSH_BATCH)
+                {
+                    flushFrameBatch();
+                }
+                frame = allocFrame();
             }
+            flushFrameBatch();
+            std::cout << "视频解码线程: 刷新阶段结束，共将 " << queuedFrameCount << " 帧放入队列" << std::endl;
 
             // 释放数据包
-            av_packet_free(&pkt);
+            pkt.reset();
 
             // 向帧队列发送EOF标记
-            AVFrame *eofFrame = av_frame_alloc();
+            AVFramePtr eofFrame = allocFrame();
             if (eofFrame)
             {
                 eofFrame->data[0] = nullptr;
@@ -447,7 +601,7 @@ void VideoDecoder::decodeThreadFunc()
                 eofFrame->key_frame = 0;
                 eofFrame->pict_type = AV_PICTURE_TYPE_NONE;
                 eofFrame->format = -1;
-                decodedFrameQueue.push(eofFrame);
+                decodedFrameQueue.push(std::move(eofFrame));
                 std::cout << "视频解码线程: 已向帧队列发送EOF标记" << std::endl;
             }
 
@@ -468,10 +622,10 @@ void VideoDecoder::decodeThreadFunc()
         }
 
         // 发送数据包到解码器
-        int ret = avcodec_send_packet(codecContext, pkt);
+        int ret = avcodec_send_packet(codecContext, pkt.get());
 
         // 释放数据包
-        av_packet_free(&pkt);
+        pkt.reset();
 
         if (ret < 0)
         {
@@ -485,7 +639,18 @@ void VideoDecoder::decodeThreadFunc()
         bool frameReceived = false;
         while (ret >= 0)
         {
-            ret = avcodec_receive_frame(codecContext, frame);
+            // 上一帧已移入队列，分配新的AVFrame
+            if (!frame)
+            {
+                frame = allocFrame();
+                if (!frame)
+                {
+                    std::cerr << "视频解码线程: 无法分配AVFrame" << std::endl;
+                    break;
+                }
+            }
+
+            ret = avcodec_receive_frame(codecContext, frame.get());
             if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
             {
                 // 需要更多数据包或者到达文件末尾
@@ -502,44 +667,43 @@ void VideoDecoder::decodeThreadFunc()
             frameReceived = true;
             frameDecoded++;
 
+            // 时间段之外的帧不输出，复用该AVFrame接收下一帧
+            if (!isFrameInRange(frame.get()))
+            {
+                rangeDiscardedFrames++;
+                continue;
+            }
+
             // 保存帧到YUV文件
             if (saveToFile)
             {
-                saveFrameToYUV(frame);
+                saveFrameToYUV(frame.get());
             }
 
             // 保存到直接YUV输出文件
             if (directYuvFile)
             {
-                writeFrameToYUVFile(frame, directYuvFile);
-            }
-
-            // 将解码后的帧放入帧缓冲队列
-            AVFrame *frameCopy = av_frame_alloc();
-            if (frameCopy)
-            {
-                av_frame_ref(frameCopy, frame);
-                decodedFrameQueue.push(frameCopy);
-                queuedFrameCount++;
-
-                // 每10帧打印一次
-                if (queuedFrameCount % 10 == 0)
-                {
-                    std::cout << "视频解码线程: 将解码帧 #" << queuedFrameCount << " 放入队列" << std::endl;
-                }
+                writeFrameToYUVFile(frame.get(), directYuvFile);
             }
 
             // 处理解码后的帧
             if (frameCallback)
             {
                 // 调用回调函数处理帧
-                frameCallback(frame);
+                frameCallback(frame.get());
             }
 
-            // 重置帧以便重用
-            av_frame_unref(frame);
+            // 将解码后的帧整体放入本地批次（不复制引用），攒满后移入帧缓冲队列
+            frameBatch[batchCount++] = std::move(frame);
+            if (batchCount == VIDEO_DECODER_PUSH_BATCH)
+            {
+                flushFrameBatch();
+            }
         }
 
+        // 本包解码出的帧已全部取出，移入帧缓冲队列
+        flushFrameBatch();
+
         // 如果没有收到帧但解码了很多包，可能是解码过程有问题
         if (!frameReceived && packetCount % 300 == 0 && packetCount > 0)
         {
@@ -555,9 +719,17 @@ void VideoDecoder::decodeThreadFunc()
         std::cout << "视频解码线程: 已关闭直接YUV输出文件: " << directYuvOutput << std::endl;
     }
 
+    // 不会再产出新帧，移入剩余的批次后关闭帧队列唤醒下游
+    flushFrameBatch();
+    decodedFrameQueue.close();
+
     // 清理
-    av_frame_free(&frame);
-    av_packet_free(&packet);
+    frame.reset();
+
+    if (useFrameBufferPool)
+    {
+        frameBufferPool.printStats();
+    }
 
     auto endTime = std::chrono::high_resolution_clock::now();
     double totalSeconds = std::chrono::duration<double>(endTime - startTime).count();
@@ -571,6 +743,11 @@ void VideoDecoder::decodeThreadFunc()
 
     std::cout << "，总共将 " << queuedFrameCount << " 帧放入队列";
 
+    if (rangeDiscardedFrames > 0)
+    {
+        std::cout << "，丢弃时间段之外的 " << rangeDiscardedFrames << " 帧";
+    }
+
     if (receivedEOF)
     {
         std::cout << "，正常收到EOF标记";
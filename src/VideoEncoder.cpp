@@ -10,8 +10,14 @@ extern "C"
 #include "ffmpeg/include_ffmpeg/libavutil/frame.h"
 #include "ffmpeg/include_ffmpeg/libavutil/error.h"
 #include "ffmpeg/include_ffmpeg/libavutil/mathematics.h"
+#include "ffmpeg/include_ffmpeg/libavutil/dict.h"
 }
 
+// 默认GOP时长（秒），GOP大小 = 帧率 * 该值
+#define VIDEO_ENCODER_DEFAULT_GOP_SECONDS 2
+// 编码线程一次从帧队列批量取出的最大帧数
+#define VIDEO_ENCODER_POP_BATCH 8
+
 // 构造函数
 VideoEncoder::VideoEncoder(VideoFrameQueue &frameQueue, VideoPacketQueue &packetQueue)
     : codecContext(nullptr),
@@ -42,7 +48,8 @@ VideoEncoder::~VideoEncoder()
 }
 
 // 初始化编码器
-bool VideoEncoder::init(int width, int height, int frameRate, int bitRate, const std::string &codecName)
+bool VideoEncoder::init(int width, int height, int frameRate, int bitRate, const std::string &codecName,
+                        const EncoderOptions &options)
 {
     // 保存参数
     this->width = width;
@@ -50,6 +57,7 @@ bool VideoEncoder::init(int width, int height, int frameRate, int bitRate, const
     this->frameRate = frameRate;
     this->bitRate = bitRate;
     this->codecName = codecName;
+    this->options = options;
 
     std::cout << "视频编码器: 开始初始化 " << width << "x" << height << " @ " << frameRate << "fps, " << bitRate / 1000 << "kbps, 编码器: " << codecName << std::endl;
 
@@ -169,11 +177,12 @@ bool VideoEncoder::initEncoder()
     std::cout << "视频编码器: 设置时基 " << den << "/" << num
               << " = " << (double)den / num << " 秒" << std::endl;
 
-    // 使用最基本的编码器设置
+    // 使用最基本的编码器设置，GOP/B帧/线程可被编码器选项覆盖
     codecContext->pix_fmt = AV_PIX_FMT_YUV420P; // 最常用的像素格式
     codecContext->bit_rate = bitRate;
-    codecContext->gop_size = 10;    // 较小的GOP大小
-    codecContext->max_b_frames = 0; // 不使用B帧
+    codecContext->gop_size = frameRate * VIDEO_ENCODER_DEFAULT_GOP_SECONDS; // 约2秒一个关键帧
+    codecContext->max_b_frames = 0;                                          // 默认不使用B帧，可用bframes选项开启
+    codecContext->thread_count = 0;                                          // 自动按CPU核数选择线程数
     codecContext->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
 
     std::cout << "视频编码器: 已设置基本编码参数" << std::endl;
@@ -232,8 +241,9 @@ bool VideoEncoder::initEncoder()
         }
     }
 
-    // 尝试打开编码器
-    int ret = avcodec_open2(codecContext, codec, nullptr);
+    // 尝试打开编码器，用户选项在此时应用并覆盖上面的默认值
+    AVDictionary *openOptions = buildOptionDictionary();
+    int ret = avcodec_open2(codecContext, codec, &openOptions);
     if (ret < 0)
     {
         char errBuff[AV_ERROR_MAX_STRING_SIZE] = {0};
@@ -256,12 +266,15 @@ bool VideoEncoder::initEncoder()
             std::cout << "视频编码器: 调整像素格式为 " << av_get_pix_fmt_name(codecContext->pix_fmt) << std::endl;
         }
 
-        // 重试打开编码器
-        ret = avcodec_open2(codecContext, codec, nullptr);
+        // 重试打开编码器（选项字典已被上一次调用消耗，重新构建）
+        av_dict_free(&openOptions);
+        openOptions = buildOptionDictionary();
+        ret = avcodec_open2(codecContext, codec, &openOptions);
         if (ret < 0)
         {
             av_strerror(ret, errBuff, AV_ERROR_MAX_STRING_SIZE);
             std::cerr << "视频编码器: 调整参数后仍然无法打开编码器 (" << errBuff << ")" << std::endl;
+            av_dict_free(&openOptions);
             closeEncoder();
             return false;
         }
@@ -273,6 +286,10 @@ bool VideoEncoder::initEncoder()
         std::cout << "视频编码器: 成功打开编码器" << std::endl;
     }
 
+    // 编码器没有识别的选项
+    reportUnusedOptions(openOptions);
+    av_dict_free(&openOptions);
+
     std::cout << "视频编码器: 初始化成功" << std::endl;
     std::cout << "  编码器: " << codec->name << std::endl;
     std::cout << "  分辨率: " << width << "x" << height << std::endl;
@@ -281,10 +298,46 @@ bool VideoEncoder::initEncoder()
     std::cout << "  像素格式: " << av_get_pix_fmt_name(codecContext->pix_fmt) << std::endl;
     std::cout << "  GOP大小: " << codecContext->gop_size << std::endl;
     std::cout << "  B帧数量: " << codecContext->max_b_frames << std::endl;
+    std::cout << "  编码线程: " << codecContext->thread_count << std::endl;
 
     return true;
 }
 
+// 把编码器选项转换为AVDictionary，常用别名映射为FFmpeg的选项名
+AVDictionary *VideoEncoder::buildOptionDictionary() const
+{
+    AVDictionary *dict = nullptr;
+    for (EncoderOptions::const_iterator it = options.begin(); it != options.end(); ++it)
+    {
+        std::string key = it->first;
+        if (key == "gop")
+        {
+            key = "g";
+        }
+        else if (key == "bframes")
+        {
+            key = "bf";
+        }
+        else if (key == "lookahead")
+        {
+            key = "rc-lookahead";
+        }
+        av_dict_set(&dict, key.c_str(), it->second.c_str(), 0);
+    }
+    return dict;
+}
+
+// 打印编码器未识别的选项
+void VideoEncoder::reportUnusedOptions(AVDictionary *unused) const
+{
+    AVDictionaryEntry *entry = nullptr;
+    while ((entry = av_dict_get(unused, "", entry, AV_DICT_IGNORE_SUFFIX)))
+    {
+        std::cerr << "视频编码器: 编码器 " << codec->name << " 不支持选项 " << entry->key << "=" << entry->value
+                  << "，已忽略" << std::endl;
+    }
+}
+
 // 关闭编码器
 void VideoEncoder::closeEncoder()
 {
@@ -317,6 +370,7 @@ void VideoEncoder::start()
 
     std::cout << "视频编码器: 启动编码线程" << std::endl;
     // 创建编码线程
+    completion.reset();
     encodeThread = std::thread(&VideoEncoder::encodeThreadFunc, this);
 }
 
@@ -348,6 +402,18 @@ void VideoEncoder::pause(bool pause)
     std::cout << "视频编码器: " << (pause ? "暂停" : "继续") << std::endl;
 }
 
+// 等待视频编码线程完成
+bool VideoEncoder::waitForCompletion(std::chrono::milliseconds timeout)
+{
+    return completion.waitFor(timeout);
+}
+
+// 视频编码线程是否已完成
+bool VideoEncoder::isCompleted() const
+{
+    return completion.isDone();
+}
+
 // 编码单帧
 bool VideoEncoder::encode(AVFrame *frame)
 {
@@ -376,11 +442,12 @@ bool VideoEncoder::encodeFrame(AVFrame *frame)
     {
         frame->pts = frameCount++;
 
-        // 如果是MPEG4编码器，确保不使用B帧
-        if (codecName == "mpeg4")
+        // 如果是MPEG4编码器且未开启B帧，强制只输出I/P帧
+        if (codecName == "mpeg4" && codecContext->max_b_frames == 0)
         {
-            // 强制设置为P帧或I帧（每15帧一个I帧）
-            if (frameCount % 15 == 0)
+            // 强制设置为P帧或I帧（每个GOP一个I帧）
+            int gopSize = codecContext->gop_size > 0 ? codecContext->gop_size : 15;
+            if (frameCount % gopSize == 0)
             {
                 frame->pict_type = AV_PICTURE_TYPE_I;
                 frame->key_frame = 1;
@@ -439,18 +506,17 @@ bool VideoEncoder::encodeFrame(AVFrame *frame)
     while (ret >= 0)
     {
         // 分配AVPacket
-        AVPacket *packet = av_packet_alloc();
+        AVPacketPtr packet = allocPacket();
         if (!packet)
         {
             std::cerr << "视频编码器: 无法分配AVPacket" << std::endl;
             return false;
         }
 
-        ret = avcodec_receive_packet(codecContext, packet);
+        ret = avcodec_receive_packet(codecContext, packet.get());
         if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
         {
             // 需要更多输入或已到达文件末尾
-            av_packet_free(&packet);
             if (ret == AVERROR_EOF)
             {
                 std::cout << "视频编码器: 已到达编码器EOF" << std::endl;
@@ -462,7 +528,6 @@ bool VideoEncoder::encodeFrame(AVFrame *frame)
             char errBuff[AV_ERROR_MAX_STRING_SIZE] = {0};
             av_strerror(ret, errBuff, AV_ERROR_MAX_STRING_SIZE);
             std::cerr << "视频编码器: 接收包失败 (" << errBuff << ")" << std::endl;
-            av_packet_free(&packet);
             return false;
         }
 
@@ -473,7 +538,7 @@ bool VideoEncoder::encodeFrame(AVFrame *frame)
         {
             try
             {
-                encodeCallback(packet);
+                encodeCallback(packet.get());
             }
             catch (const std::exception &e)
             {
@@ -485,9 +550,15 @@ bool VideoEncoder::encodeFrame(AVFrame *frame)
             }
         }
 
-        // 将包添加到队列
-        packetQueue.push(packet);
-        std::cout << "视频编码器: 将编码包放入队列 (pts=" << packet->pts << ", dts=" << packet->dts << ", size=" << packet->size << " bytes)" << std::endl;
+        // 将包移入队列，入队后句柄为空，先记录日志信息
+        int64_t pts = packet->pts;
+        int64_t dts = packet->dts;
+        int size = packet->size;
+        if (!packetQueue.push(std::move(packet), static_cast<size_t>(size)))
+        {
+            continue;
+        }
+        std::cout << "视频编码器: 将编码包放入队列 (pts=" << pts << ", dts=" << dts << ", size=" << size << " bytes)" << std::endl;
     }
 
     return packetReceived;
@@ -501,15 +572,16 @@ void VideoEncoder::sendEOF()
         std::cerr << "视频编码器: 无效的编码器上下文，无法发送EOF标记" << std::endl;
 
         // 即使编码器上下文无效，也创建一个EOF包并添加到队列中，确保复用器能够正确结束
-        AVPacket *eofPacket = av_packet_alloc();
+        AVPacketPtr eofPacket = allocPacket();
         if (eofPacket)
         {
             eofPacket->data = nullptr;
             eofPacket->size = 0;
             eofPacket->flags |= 0x100; // 自定义EOF标志
-            packetQueue.push(eofPacket);
+            packetQueue.push(std::move(eofPacket));
             std::cout << "视频编码器: 已发送EOF标记（无编码器上下文）" << std::endl;
         }
+        packetQueue.close();
         return;
     }
 
@@ -530,18 +602,21 @@ void VideoEncoder::sendEOF()
     }
 
     // 创建一个特殊的EOF包
-    AVPacket *eofPacket = av_packet_alloc();
+    AVPacketPtr eofPacket = allocPacket();
     if (eofPacket)
     {
         eofPacket->data = nullptr;
         eofPacket->size = 0;
         eofPacket->flags |= 0x100; // 自定义EOF标志
 
-        // 将EOF包添加到队列
-        packetQueue.push(eofPacket);
+        // 将EOF包移入队列
+        packetQueue.push(std::move(eofPacket));
 
         std::cout << "视频编码器: 已发送EOF标记" << std::endl;
     }
+
+    // 编码输出到此结束，关闭包队列唤醒复用器
+    packetQueue.close();
 }
 
 // 刷新编码器
@@ -578,6 +653,9 @@ void VideoEncoder::flush()
 // 编码线程函数
 void VideoEncoder::encodeThreadFunc()
 {
+    // 线程函数退出时（包括提前返回）发布完成信号
+    CompletionGuard completionGuard(completion);
+
     std::cout << "视频编码线程: 开始" << std::endl;
 
     // 分配输出帧（用于滤镜处理后的帧）
@@ -588,6 +666,7 @@ void VideoEncoder::encodeThreadFunc()
         if (!filteredFrame)
         {
             std::cerr << "视频编码线程: 无法分配滤镜输出帧" << std::endl;
+            packetQueue.close();
             return;
         }
         std::cout << "视频编码线程: 已分配滤镜输出帧" << std::endl;
@@ -602,6 +681,11 @@ void VideoEncoder::encodeThreadFunc()
 
     std::cout << "视频编码线程: " << (useFilter ? "使用" : "不使用") << "滤镜处理" << std::endl;
 
+    // 本地帧批次：一次取走帧队列中已有的多帧，只发布一次读取位置、唤醒一次解码线程
+    AVFramePtr frameBatch[VIDEO_ENCODER_POP_BATCH];
+    size_t batchCount = 0;
+    size_t batchIndex = 0;
+
     // 线程主循环
     while (isRunning && !receivedEOF)
     {
@@ -612,25 +696,38 @@ void VideoEncoder::encodeThreadFunc()
             continue;
         }
 
-        // 从帧队列中获取解码后的帧
-        void *frameData = nullptr;
-        if (!frameQueue.tryPop(frameData))
+        // 本地批次取完后再从帧队列批量获取，队列为空时阻塞等待，数据到达即被唤醒
+        if (batchIndex == batchCount)
+        {
+            batchIndex = 0;
+            batchCount = frameQueue.popMultipleFor(frameBatch, VIDEO_ENCODER_POP_BATCH, std::chrono::milliseconds(100));
+        }
+
+        if (batchIndex == batchCount)
         {
-            // 队列为空，等待一段时间
+            // 上游已关闭且没有剩余数据，按收到EOF处理
+            if (frameQueue.isDrained())
+            {
+                std::cout << "视频编码线程: 帧队列已关闭，执行最终编码刷新" << std::endl;
+                receivedEOF = true;
+                flush();
+                break;
+            }
+
             emptyQueueCount++;
-            if (emptyQueueCount % 100 == 0)
+            if (emptyQueueCount % 10 == 0)
             {
-                std::cout << "视频编码线程: 帧队列持续为空 " << emptyQueueCount / 100 << " 秒" << std::endl;
+                std::cout << "视频编码线程: 帧队列持续为空 " << emptyQueueCount / 10 << " 秒" << std::endl;
             }
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
             continue;
         }
 
         // 重置空队列计数
         emptyQueueCount = 0;
 
-        // 转换为AVFrame
-        AVFrame *frame = static_cast<AVFrame *>(frameData);
+        // 帧由句柄持有，本轮循环结束时自动释放
+        AVFramePtr frameHandle = std::move(frameBatch[batchIndex++]);
+        AVFrame *frame = frameHandle.get();
         if (!frame)
         {
             std::cerr << "视频编码线程: 从队列获取的帧为空" << std::endl;
@@ -644,7 +741,7 @@ void VideoEncoder::encodeThreadFunc()
             receivedEOF = true;
 
             // 释放EOF标记帧
-            av_frame_free(&frame);
+            frameHandle.reset();
 
             // 刷新编码器
             try
@@ -727,9 +824,6 @@ void VideoEncoder::encodeThreadFunc()
             std::cout << "视频编码线程: 已处理 " << processedFrames << " 帧，编码 "
                       << encodedPackets << " 个包，编码速度: " << fps << " fps" << std::endl;
         }
-
-        // 释放原始帧
-        av_frame_free(&frame);
     }
 
     // 释放滤镜输出帧
@@ -739,6 +833,12 @@ void VideoEncoder::encodeThreadFunc()
         std::cout << "视频编码线程: 已释放滤镜输出帧" << std::endl;
     }
 
+    // 被stop()中断而没有收到EOF时也关闭输出队列，复用器不会一直等待
+    if (!receivedEOF)
+    {
+        packetQueue.close();
+    }
+
     auto endTime = std::chrono::high_resolution_clock::now();
     double totalSeconds = std::chrono::duration<double>(endTime - startTime).count();
 
@@ -805,6 +905,24 @@ const char *VideoEncoder::getCodecName() const
     return codec ? codec->name : "unknown";
 }
 
+// 获取实际编码线程数
+int VideoEncoder::getThreadCount() const
+{
+    return codecContext ? codecContext->thread_count : 0;
+}
+
+// 获取实际GOP大小
+int VideoEncoder::getGopSize() const
+{
+    return codecContext ? codecContext->gop_size : 0;
+}
+
+// 获取实际最大B帧数
+int VideoEncoder::getMaxBFrames() const
+{
+    return codecContext ? codecContext->max_b_frames : 0;
+}
+
 // 获取编码帧数
 int VideoEncoder::getFrameCount() const
 {